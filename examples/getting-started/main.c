@@ -10,10 +10,19 @@ vga_config_t display_conf = {
   .pio                    = pio0,
   .base_resolution        = RES_800x600,
   .scaled_resolution      = RES_SCALED_400x300,
+  .scaled_width           = 0,
+  .scaled_height          = 0,
   .render_queue           = render_queue,
   .render_queue_len       = RENDER_QUEUE_LEN,
   .auto_render            = true,
   .antialiasing           = false,
+  .double_buffered        = false,
+  .dual_core_render       = false,
+  .binned_render          = false,
+  .dma_render             = false,
+  .playfield_width        = 0,
+  .playfield_height       = 0,
+  .pixel_clock_div        = 0,
   .num_interpolated_lines = 0,
   .color_delay_cycles     = 0
 };
@@ -0,0 +1,231 @@
+#include "hardware/clocks.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+#include "pico-vga.h"
+#include "pico/stdlib.h"
+#include "vga/render.h"
+#include <stdio.h>
+
+// Times every render2d_* rasterizer at every scaled resolution of the base resolution and prints cycles per call and
+// cycles per pixel over USB serial. The rasterizers are called straight from core 0, core 1 only does the scanout.
+// The host build (host/bench) runs every resolution once and prints nanoseconds on the PC instead of cycles.
+
+#define RENDER_QUEUE_LEN (1)
+vga_render_item_t render_queue[RENDER_QUEUE_LEN]; // Unused, nothing is drawn through the render queue
+
+vga_config_t display_conf = {
+  .pio                    = pio0,
+  .base_resolution        = RES_800x600,
+  .scaled_resolution      = RES_SCALED_400x300,
+  .scaled_width           = 0,
+  .scaled_height          = 0,
+  .render_queue           = render_queue,
+  .render_queue_len       = RENDER_QUEUE_LEN,
+  .auto_render            = false, // Keep the renderer out of the way
+  .antialiasing           = false,
+  .double_buffered        = false,
+  .dual_core_render       = false,
+  .binned_render          = false,
+  .dma_render             = false,
+  .playfield_width        = 0,
+  .playfield_height       = 0,
+  .pixel_clock_div        = 0,
+  .num_interpolated_lines = 0,
+  .color_delay_cycles     = 0
+};
+
+#if PICO_ON_DEVICE
+#define BENCHMARK_MIN_US (200000) // Repeat each benchmark for at least this long
+#else
+#define BENCHMARK_MIN_US (20000)
+#endif
+#define SPRITE_SIZE      (32)
+
+static vga_color_t sprite[SPRITE_SIZE * SPRITE_SIZE];
+static char string[] = "The quick brown fox jumps over the lazy dog";
+
+// Screen size the benchmarks are running at
+static uint16_t width;
+static uint16_t height;
+
+typedef struct {
+  const char * name;
+  void (*run)(uint8_t param);        // Draw the primitive once
+  uint32_t (*pixels)(uint8_t param); // Number of pixels it covers
+  uint8_t param;
+} benchmark_t;
+
+// Line directions, one per octant: x and y lengths in quarters of the line length
+static const int8_t octants[8][2] = { { 4, 2 }, { 2, 4 }, { -2, 4 }, { -4, 2 }, { -4, -2 }, { -2, -4 }, { 2, -4 }, { 4, -2 } };
+
+static uint16_t radius() {
+  return (width < height ? width : height) / 2 - 1;
+}
+
+static void line(uint8_t octant) {
+  uint16_t len = radius();
+  render2d_line(width / 2, height / 2, width / 2 + octants[octant][0] * len / 4, height / 2 + octants[octant][1] * len / 4, COLOR_WHITE);
+}
+
+static uint32_t line_pixels(uint8_t octant) {
+  return radius() + 1; // The long axis is always the whole length
+}
+
+static void circle(uint8_t param) {
+  render2d_circle(width / 2, height / 2, radius(), COLOR_WHITE);
+}
+
+static uint32_t circle_pixels(uint8_t param) {
+  return radius() * 44 / 7; // 2 * pi * r
+}
+
+static void circle_filled(uint8_t param) {
+  render2d_circle_filled(width / 2, height / 2, radius(), COLOR_WHITE);
+}
+
+static uint32_t circle_filled_pixels(uint8_t param) {
+  return (uint32_t) radius() * radius() * 22 / 7; // pi * r^2
+}
+
+static void triangle_filled(uint8_t param) {
+  render2d_triangle_filled(0, height - 1, width / 2, 0, width - 1, height - 1, COLOR_WHITE);
+}
+
+static uint32_t triangle_filled_pixels(uint8_t param) {
+  return (uint32_t) width * height / 2;
+}
+
+static void string_render(uint8_t param) {
+  render2d_string(string, 0, 0, width - 1, true, COLOR_WHITE);
+}
+
+static uint32_t string_pixels(uint8_t param) {
+  return (sizeof(string) - 1) * FONT_WIDTH * FONT_HEIGHT;
+}
+
+// param: use a null color (transparent pixels) or not
+static void sprite_render(uint8_t null_color) {
+  render2d_sprite(sprite, 0, 0, SPRITE_SIZE, SPRITE_SIZE, null_color ? COLOR_BLACK : COLOR_WHITE);
+}
+
+static uint32_t sprite_pixels(uint8_t param) {
+  return SPRITE_SIZE * SPRITE_SIZE;
+}
+
+// Hexagon that fills the screen
+static uint16_t hexagon[6][2];
+
+static void build_hexagon() {
+  uint16_t r              = radius();
+  const int8_t shape[][2] = { { 4, 0 }, { 2, 4 }, { -2, 4 }, { -4, 0 }, { -2, -4 }, { 2, -4 } };
+  for (int i = 0; i < 6; i++) {
+    hexagon[i][0] = width / 2 + shape[i][0] * r / 4;
+    hexagon[i][1] = height / 2 + shape[i][1] * r / 4;
+  }
+}
+
+static void polygon(uint8_t param) {
+  render2d_polygon(hexagon, 6, COLOR_WHITE);
+}
+
+static uint32_t polygon_pixels(uint8_t param) {
+  return 6 * radius(); // Each edge is r long along its long axis
+}
+
+static void polygon_filled(uint8_t param) {
+  render2d_polygon_filled(hexagon, 6, COLOR_WHITE);
+}
+
+static uint32_t polygon_filled_pixels(uint8_t param) {
+  return (uint32_t) radius() * radius() * 3; // 2r * 2r, minus 4 corners of (r/2 * r)/2
+}
+
+static void fill(uint8_t param) {
+  render2d_fill(COLOR_BLACK);
+}
+
+static uint32_t fill_pixels(uint8_t param) {
+  return (uint32_t) width * height;
+}
+
+static const benchmark_t benchmarks[] = {
+  { "line (octant 0)", line, line_pixels, 0 },
+  { "line (octant 1)", line, line_pixels, 1 },
+  { "line (octant 2)", line, line_pixels, 2 },
+  { "line (octant 3)", line, line_pixels, 3 },
+  { "line (octant 4)", line, line_pixels, 4 },
+  { "line (octant 5)", line, line_pixels, 5 },
+  { "line (octant 6)", line, line_pixels, 6 },
+  { "line (octant 7)", line, line_pixels, 7 },
+  { "circle", circle, circle_pixels, 0 },
+  { "circle filled", circle_filled, circle_filled_pixels, 0 },
+  { "triangle filled", triangle_filled, triangle_filled_pixels, 0 },
+  { "string", string_render, string_pixels, 0 },
+  { "sprite", sprite_render, sprite_pixels, 0 },
+  { "sprite (null color)", sprite_render, sprite_pixels, 1 },
+  { "polygon", polygon, polygon_pixels, 0 },
+  { "polygon filled", polygon_filled, polygon_filled_pixels, 0 },
+  { "fill", fill, fill_pixels, 0 },
+};
+
+static void run_benchmarks() {
+#if PICO_ON_DEVICE
+  uint32_t ticks_per_us = clock_get_hz(clk_sys) / 1000000;
+  const char * unit     = "cycles";
+#else
+  uint32_t ticks_per_us = 1000; // time_us_32() is the PC's clock, not the emulated one
+  const char * unit     = "ns";
+#endif
+  width  = vga_get_width();
+  height = vga_get_height();
+  build_hexagon();
+
+  printf("\n%ux%u, %lu MHz system clock\n", width, height, (unsigned long) (clock_get_hz(clk_sys) / 1000000));
+  for (int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+    const benchmark_t * b = &benchmarks[i];
+    uint32_t calls        = 0;
+    uint32_t start        = time_us_32();
+    uint32_t elapsed;
+    do {
+      b->run(b->param);
+      calls++;
+      elapsed = time_us_32() - start;
+    } while (elapsed < BENCHMARK_MIN_US);
+
+    uint64_t ticks          = (uint64_t) elapsed * ticks_per_us;
+    uint32_t per_call       = ticks / calls;
+    uint32_t pixels         = b->pixels(b->param);
+    uint32_t per_pixel_x100 = pixels ? (uint64_t) per_call * 100 / pixels : 0;
+    printf("%-20s %10lu %s/call %6lu.%02lu %s/pixel\n", b->name, (unsigned long) per_call, unit,
+           (unsigned long) (per_pixel_x100 / 100), (unsigned long) (per_pixel_x100 % 100), unit);
+  }
+}
+
+int main() {
+  // DEBUG ONLY: The debugger pausing at the start of main() causes it to read all
+  // spinlock regs, "claiming" all spinlocks. This should be fixed in future SDK revs,
+  // see https://github.com/raspberrypi/pico-examples/issues/363. For now, this.
+  spin_locks_reset();
+
+  for (int i = 0; i < SPRITE_SIZE * SPRITE_SIZE; i++) {
+    sprite[i] = i % 3 ? COLOR_RED : COLOR_BLACK; // A third of the pixels are transparent with a null color
+  }
+
+  if (vga_init(&display_conf)) return 1;
+  stdio_init_all(); // After vga_init(), it changes the system clock
+#if PICO_ON_DEVICE
+  sleep_ms(2000); // Give the USB serial port time to show up
+#endif
+
+  const vga_resolution_scaled_t scales[] = { 1, 2, 4, 8 };
+  do {
+    for (int i = 0; i < sizeof(scales) / sizeof(scales[0]); i++) {
+      if (vga_set_resolution(display_conf.base_resolution, scales[i])) {
+        printf("\nScale %u doesn't fit, skipped\n", scales[i]);
+        continue;
+      }
+      run_benchmarks();
+    }
+  } while (PICO_ON_DEVICE);
+  return vga_deinit(&display_conf);
+}
@@ -0,0 +1,114 @@
+// Pixels written per frame: the scanline renderer against clearing the framebuffer and drawing every item over it
+// (fill-then-overdraw), on the same scene. Counted with vga_render_profile_t.pixels_written, so it's the real
+// rasterizers either way.
+//
+// Three numbers, all for one full screen:
+// - fill-then-overdraw: the screen cleared, then every item drawn in full (each item measured on its own)
+// - framebuffer: a full vga_refresh() pass of render(), which skips whatever the opaque items cover
+// - scanline: one frame of the scanline renderer, which skips everything under the last item covering each row
+
+#include "test.h"
+
+#define RENDER_QUEUE_LEN 32
+#define FRAMES           16
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+vga_config_t display_conf = {
+  .pio                    = pio0,
+  .base_resolution        = RES_640x480,
+  .scaled_resolution      = RES_SCALED_320x240,
+  .render_queue           = render_queue,
+  .render_queue_len       = RENDER_QUEUE_LEN,
+  .num_interpolated_lines = 0,
+};
+
+static uint16_t num_items = 0;
+
+// A background (item 0, covering the whole screen), overlapping windows, some circles and lines on top, the sort of thing a UI draws
+static void build_scene() {
+  vga_render_item_t * rq = render_queue;
+  num_items              = 0;
+
+  draw2d_rectangle_filled(&rq[num_items++], 0, 0, 319, 239, COLOR_NAVY);
+  for (uint16_t i = 0; i < 8; i++) {
+    uint16_t x = 10 + i * 30, y = 10 + i * 20;
+    draw2d_rectangle_filled(&rq[num_items++], x, y, x + 99, y + 69, COLOR_GRAY);
+    draw2d_rectangle_filled(&rq[num_items++], x, y, x + 99, y + 9, COLOR_BLUE);
+  }
+  for (uint16_t i = 0; i < 6; i++) {
+    draw2d_circle_filled(&rq[num_items++], 40 + i * 48, 200, 20, COLOR_RED);
+  }
+  for (uint16_t i = 0; i < 8; i++) {
+    draw2d_line(&rq[num_items++], 0, i * 30, 319, 239 - i * 30, COLOR_WHITE);
+  }
+}
+
+static uint32_t pixels_written() {
+  vga_render_profile_t profile;
+  vga_get_render_profile(&profile);
+  return profile.pixels_written;
+}
+
+// Pixels one full redraw of the framebuffer writes
+static uint32_t framebuffer_pass() {
+  host_wait_idle(1);
+  uint32_t before = pixels_written();
+  vga_refresh();
+  CHECK_EQ(host_wait_idle(1), 0);
+  return pixels_written() - before;
+}
+
+int main() {
+  uint32_t screen = 0;
+
+  // Framebuffer renderer
+  display_conf.auto_render = true;
+  CHECK_EQ(vga_init(&display_conf), 0);
+  screen = (uint32_t) vga_get_width() * vga_get_height();
+  build_scene();
+  uint32_t framebuffer = framebuffer_pass();
+
+  // Each item on top of just the background: the background covers the screen either way, so nothing gets cleared
+  // and the difference is the item
+  for (uint16_t j = 1; j < num_items; j++) {
+    render_queue[j].header.flags.shown = false;
+  }
+  uint32_t background = framebuffer_pass();
+  uint32_t overdraw   = screen + background;
+  for (uint16_t i = 1; i < num_items; i++) {
+    render_queue[i].header.flags.shown = true;
+    overdraw += framebuffer_pass() - background;
+    render_queue[i].header.flags.shown = false;
+  }
+  CHECK_EQ(vga_deinit(&display_conf), 0);
+
+  // Scanline renderer, rendering every frame
+  display_conf.auto_render            = false;
+  display_conf.scanline_render        = true;
+  display_conf.num_interpolated_lines = 4;
+  CHECK_EQ(vga_init(&display_conf), 0);
+  build_scene();
+  CHECK_EQ(host_wait_frames(2), 0);
+
+  host_stats_t stats;
+  host_get_stats(&stats);
+  uint32_t first_frame = stats.frames;
+  uint32_t before      = pixels_written();
+  CHECK_EQ(host_wait_frames(FRAMES), 0);
+  uint32_t after = pixels_written();
+  host_get_stats(&stats);
+  uint32_t scanline = (after - before) / MAX(stats.frames - first_frame, 1u);
+  CHECK_EQ(vga_deinit(&display_conf), 0);
+
+  printf("%u items, %u pixels on screen\n", num_items, screen);
+  printf("%-20s %10s %8s\n", "renderer", "pixels", "x screen");
+  printf("%-20s %10u %8.2f\n", "fill-then-overdraw", overdraw, (double) overdraw / screen);
+  printf("%-20s %10u %8.2f\n", "framebuffer", framebuffer, (double) framebuffer / screen);
+  printf("%-20s %10u %8.2f\n", "scanline", scanline, (double) scanline / screen);
+
+  // Every pixel gets written at least once a full screen
+  CHECK(overdraw >= screen);
+  CHECK(framebuffer >= screen);
+  CHECK(scanline >= screen);
+  return TEST_RESULT();
+}
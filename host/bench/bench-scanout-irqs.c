@@ -0,0 +1,66 @@
+// Scanout IRQs per frame, measured on the emulated hardware, against the chain that raised DMA_IRQ_0 every line.
+// Only line interpolation (the scanline renderer, tile mode, framebuffers that don't fit) still needs an IRQ every
+// visible line. Everything else gets one a frame, for the frame counter and the vblank work.
+
+#include "test.h"
+
+#include <string.h>
+
+#define RENDER_QUEUE_LEN 4
+#define FRAMES           30
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+typedef struct {
+  const char * name;
+  vga_resolution_base_t base;
+  vga_resolution_scaled_t scaled;
+  bool scanline;
+} bench_mode_t;
+
+static const bench_mode_t modes[] = {
+  { "640x480/2 buffered", RES_640x480, RES_SCALED_320x240, false },
+  { "1024x768/2 buffered", RES_1024x768, RES_SCALED_512x384, false },
+  { "800x600 interpolated", RES_800x600, RES_SCALED_800x600, false },
+  { "640x480/2 scanline", RES_640x480, RES_SCALED_320x240, true },
+};
+
+int main() {
+  printf("%-22s %12s %12s %10s\n", "mode", "every line", "now", "IRQs/s now");
+  for (int m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+    vga_config_t config = {
+      .pio                    = pio0,
+      .base_resolution        = modes[m].base,
+      .scaled_resolution      = modes[m].scaled,
+      .render_queue           = render_queue,
+      .render_queue_len       = RENDER_QUEUE_LEN,
+      .auto_render            = !modes[m].scanline,
+      .scanline_render        = modes[m].scanline,
+      .num_interpolated_lines = 4,
+    };
+    memset(render_queue, 0, sizeof(render_queue));
+    CHECK_EQ(vga_init(&config), 0);
+    draw2d_rectangle_filled(&render_queue[0], 10, 20, 99, 59, COLOR_RED);
+    CHECK_EQ(host_wait_frames(2), 0);
+
+    host_stats_t stats;
+    host_reset_stats();
+    CHECK_EQ(host_wait_frames(FRAMES), 0);
+    host_get_stats(&stats);
+    uint32_t frames = MAX(stats.frames, 1u);
+    double irqs     = (double) (stats.irqs[0][DMA_IRQ_0] + stats.irqs[1][DMA_IRQ_0]) / frames;
+
+    // The old chain: one IRQ for every line of the frame, blanking included
+    uint16_t lines         = __vga_get_frame_read_addr_len();
+    uint16_t visible_lines = __vga_get_row_line(vga_get_height());
+    printf("%-22s %12u %12.1f %10.0f\n", modes[m].name, lines, irqs, irqs * 1000000 / __vga_get_frame_period_us());
+
+    if (__vga_get_interp_ring()) {
+      CHECK(irqs <= visible_lines + 1.5); // A line IRQ every visible line, and the frame IRQ
+    } else {
+      CHECK(irqs >= 0.5 && irqs <= 1.5); // Just the frame IRQ
+    }
+    CHECK_EQ(stats.lockstep_timeouts, 0);
+    CHECK_EQ(vga_deinit(&config), 0);
+  }
+  return TEST_RESULT();
+}
@@ -0,0 +1,74 @@
+# Stand-in for pioasm's c-sdk output, for the host build: cmake -DINPUT=x.pio -DOUTPUT=x.pio.h -P pioasm.cmake
+# Only what the C side of a program uses is generated (program length, wrap, public labels and the % c-sdk blocks).
+# The instructions are left as zeros, host/sdk/pio.c models color.pio instead of running PIO code.
+
+file(READ ${INPUT} source)
+get_filename_component(input_name ${INPUT} NAME)
+# One list element per line. Semicolons (comments, C code) and brackets would split or merge list elements.
+string(REPLACE ";" "@SEMI@" source "${source}")
+string(REPLACE "[" "@LBR@" source "${source}")
+string(REPLACE "]" "@RBR@" source "${source}")
+string(REPLACE "\n" ";" lines "${source}")
+
+set(header "// Generated by host/cmake/pioasm.cmake from ${input_name}, do not edit\n\n#pragma once\n\n#include \"hardware/pio.h\"\n")
+set(program "")
+set(passthrough FALSE)
+
+macro(finish_program)
+  if(program)
+    string(APPEND header "\n#define ${program}_wrap_target ${wrap_target}\n#define ${program}_wrap ${wrap}\n")
+    string(APPEND header "${labels}")
+    string(APPEND header "\nstatic const uint16_t ${program}_program_instructions[${length}] = { 0 };\n")
+    string(APPEND header "\nstatic const struct pio_program ${program}_program = {\n    .instructions = ${program}_program_instructions,\n    .length = ${length},\n    .origin = -1,\n};\n")
+    string(APPEND header "\nstatic inline pio_sm_config ${program}_program_get_default_config(uint offset) {\n    pio_sm_config c = pio_get_default_sm_config();\n    sm_config_set_wrap(&c, offset + ${program}_wrap_target, offset + ${program}_wrap);\n    return c;\n}\n")
+    string(APPEND header "${c_sdk}")
+  endif()
+endmacro()
+
+foreach(line IN LISTS lines)
+  if(passthrough)
+    if(line MATCHES "^%}")
+      set(passthrough FALSE)
+    else()
+      string(APPEND c_sdk "${line}\n")
+    endif()
+    continue()
+  endif()
+
+  string(REGEX REPLACE "@SEMI@.*" "" line "${line}") # Comment
+  string(STRIP "${line}" line)
+  if(line STREQUAL "")
+    continue()
+  elseif(line MATCHES "^% *c-sdk *{")
+    set(passthrough TRUE)
+  elseif(line MATCHES "^\\.program +([A-Za-z0-9_]+)")
+    finish_program()
+    set(program ${CMAKE_MATCH_1})
+    set(length 0)
+    set(wrap_target 0)
+    set(wrap -1)
+    set(labels "")
+    set(c_sdk "")
+  elseif(line STREQUAL ".wrap_target")
+    set(wrap_target ${length})
+  elseif(line STREQUAL ".wrap")
+    math(EXPR wrap "${length} - 1")
+  elseif(line MATCHES "^\\.")
+    # Other directives don't change anything the C side sees
+  elseif(line MATCHES "^(public +)?([A-Za-z0-9_]+):$")
+    if(CMAKE_MATCH_1)
+      string(APPEND labels "#define ${program}_offset_${CMAKE_MATCH_2} ${length}u\n")
+    endif()
+  else()
+    math(EXPR length "${length} + 1")
+  endif()
+endforeach()
+if(program AND wrap EQUAL -1)
+  math(EXPR wrap "${length} - 1")
+endif()
+finish_program()
+
+string(REPLACE "@SEMI@" ";" header "${header}")
+string(REPLACE "@LBR@" "[" header "${header}")
+string(REPLACE "@RBR@" "]" header "${header}")
+file(WRITE ${OUTPUT} "${header}")
@@ -0,0 +1,637 @@
+// Host build: the two cores, their IRQs and everything they use to talk to each other.
+//
+// Core 0 is the main thread, core 1 is the thread multicore_launch_core1() starts. Every core has its own IRQ enables,
+// priorities and pending bits like the NVIC does. IRQs are delivered to a core by sending its thread IRQ_SIGNAL, and the
+// signal handler runs the highest priority pending IRQ that beats whatever the core is running now (priorities nest
+// like they do on the M0+). save_and_disable_interrupts() holds them off until restore_interrupts().
+
+#include "emu.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define IRQ_SIGNAL         SIGUSR1
+#define THREAD_MODE        0x100 // Priority of code that isn't in an IRQ handler, below every IRQ
+#define MAX_SHARED         4     // irq_add_shared_handler() handlers per IRQ
+#define FIFO_DEPTH         8
+#define WFE_SLEEP_NS       1000000 // __wfe()/__wfi() can return early, so they don't sleep longer than this
+#define CORE1_RESET_WAIT_S 5
+
+typedef struct {
+  pthread_t thread;
+  atomic_bool running;
+  atomic_uint pending;
+  atomic_uint enabled;
+  atomic_uint active;
+  uint8_t priority[NUM_IRQS];
+  atomic_bool event;    // Event register, see __sev()/__wfe()
+  atomic_bool sleeping; // In __wfe()/__wfi() outside of an IRQ
+  uint32_t user_irqs_claimed;
+} core_t;
+
+typedef struct {
+  uint32_t data[FIFO_DEPTH];
+  atomic_uint head; // Written by the pushing core
+  atomic_uint tail; // Written by the popping core
+} fifo_t;
+
+struct i2c_inst {
+  int unused;
+};
+
+i2c_inst_t i2c0_inst;
+i2c_inst_t i2c1_inst;
+
+static core_t cores[2];
+static irq_handler_t handlers[NUM_IRQS][MAX_SHARED]; // Shared by both cores, like the default vector table
+static fifo_t fifos[2];                                // fifos[n] is read by core n
+static atomic_uint spin_locks[NUM_SPIN_LOCKS];
+static atomic_uint spin_locks_claimed;
+
+static void (*core1_entry)(void);
+static atomic_bool core1_reset;
+static struct timespec start_time;
+
+static __thread int this_core                 = -1; // -1: not a core (the emulator thread, or threads the program started)
+static __thread uint32_t primask              = 0;  // save_and_disable_interrupts()
+static __thread uint32_t current_priority     = THREAD_MODE;
+static __thread int current_irq               = -1;
+
+/************************************
+ * STATIC FUNCTIONS
+ ************************************/
+
+static uint64_t real_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) (t.tv_sec - start_time.tv_sec) * 1000000000u + t.tv_nsec - start_time.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns) {
+  struct timespec t = { .tv_sec = ns / 1000000000u, .tv_nsec = ns % 1000000000u };
+  nanosleep(&t, NULL); // A signal (IRQ or __sev()) cuts it short, which is what __wfe()/__wfi() want
+}
+
+static void core_reset_state(core_t * core) {
+  atomic_store(&core->pending, 0);
+  atomic_store(&core->enabled, 0);
+  atomic_store(&core->active, 0);
+  atomic_store(&core->event, false);
+  atomic_store(&core->sleeping, false);
+  for (int i = 0; i < NUM_IRQS; i++) {
+    core->priority[i] = PICO_DEFAULT_IRQ_PRIORITY;
+  }
+  core->user_irqs_claimed = 0;
+}
+
+static void core_signal(int c) {
+  if (atomic_load(&cores[c].running)) {
+    pthread_kill(cores[c].thread, IRQ_SIGNAL);
+  }
+}
+
+// Pend an IRQ on a core. Returns true if the core has to go run it (it's enabled there and wasn't pending yet).
+static bool core_pend(int c, uint num) {
+  uint32_t bit = 1u << num;
+  if (atomic_fetch_or(&cores[c].pending, bit) & bit) return false;
+  if (!(atomic_load(&cores[c].enabled) & bit)) return false;
+  core_signal(c);
+  return true;
+}
+
+// Level IRQs (the DMA's) pend again if the handler didn't clear them
+static void irq_refresh() {
+  primask = 1;
+  bus_enter();
+  bus_leave();
+  primask = 0;
+}
+
+// Run pending IRQs on this core that beat the current priority, highest first. Called from the signal handler and
+// whenever IRQs get unmasked.
+static void dispatch() {
+  if (this_core < 0 || primask) return;
+  core_t * core = &cores[this_core];
+
+  while (true) {
+    uint32_t ready = atomic_load(&core->pending) & atomic_load(&core->enabled);
+    int best       = -1;
+    for (uint32_t m = ready; m; m &= m - 1) {
+      int num = __builtin_ctz(m);
+      if (best < 0 || (core->priority[num] & 0xc0) < (core->priority[best] & 0xc0)) best = num;
+    }
+    if (best < 0 || (core->priority[best] & 0xc0) >= current_priority) return;
+
+    atomic_fetch_or(&core->active, 1u << best); // Active first, or the emulator could pend it again in between
+    atomic_fetch_and(&core->pending, ~(1u << best));
+    uint32_t saved_priority = current_priority;
+    int saved_irq           = current_irq;
+    current_priority        = core->priority[best] & 0xc0;
+    current_irq             = best;
+    emu_stats.irqs[this_core][best]++;
+
+    // The emulator can raise an IRQ before it mirrors the registers out, make sure the handler sees why it's running
+    bus_enter();
+    bus_leave();
+
+    for (int i = 0; i < MAX_SHARED && handlers[best][i]; i++) {
+      handlers[best][i]();
+    }
+
+    current_priority = saved_priority;
+    current_irq      = saved_irq;
+    atomic_fetch_and(&core->active, ~(1u << best));
+    irq_refresh();
+  }
+}
+
+static void irq_signal_handler(int sig) {
+  int saved_errno = errno;
+  dispatch();
+  errno = saved_errno;
+}
+
+static void * core1_main(void * arg) {
+  this_core = 1;
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, IRQ_SIGNAL);
+  pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+
+  core1_entry();
+  atomic_store(&cores[1].running, false); // Returned, nothing left for core 1 to do
+  return NULL;
+}
+
+static bool fifo_push(fifo_t * fifo, uint32_t data) {
+  uint head = atomic_load(&fifo->head);
+  if (head - atomic_load(&fifo->tail) >= FIFO_DEPTH) return false;
+  fifo->data[head % FIFO_DEPTH] = data;
+  atomic_store(&fifo->head, head + 1);
+  return true;
+}
+
+static bool fifo_pop(fifo_t * fifo, uint32_t * data) {
+  uint tail = atomic_load(&fifo->tail);
+  if (tail == atomic_load(&fifo->head)) return false;
+  *data = fifo->data[tail % FIFO_DEPTH];
+  atomic_store(&fifo->tail, tail + 1);
+  return true;
+}
+
+__attribute__((constructor)) static void core0_init() {
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+  this_core = 0;
+  for (int c = 0; c < 2; c++) {
+    core_reset_state(&cores[c]);
+  }
+  cores[0].thread = pthread_self();
+  atomic_store(&cores[0].running, true);
+
+  struct sigaction action = { 0 };
+  action.sa_handler       = irq_signal_handler;
+  action.sa_flags         = SA_NODEFER | SA_RESTART; // Higher priority IRQs can come in while a handler runs
+  sigemptyset(&action.sa_mask);
+  sigaction(IRQ_SIGNAL, &action, NULL);
+}
+
+/************************************
+ * EMULATOR FUNCTIONS
+ ************************************/
+
+int core_this(void) {
+  return this_core;
+}
+
+void core_yield(void) {
+  if (this_core == 1 && atomic_load(&core1_reset) && !primask && current_irq < 0) {
+    atomic_store(&cores[1].running, false);
+    pthread_exit(NULL);
+  }
+}
+
+bool cores_idle(void) {
+  for (int c = 0; c < 2; c++) {
+    if (!atomic_load(&cores[c].running)) continue;
+    if ((atomic_load(&cores[c].pending) & atomic_load(&cores[c].enabled)) || atomic_load(&cores[c].active)) return false;
+  }
+  return true;
+}
+
+bool irq_update_levels(void) {
+  uint32_t levels = dma_irq_levels();
+  bool raised     = false;
+  for (uint32_t m = levels; m; m &= m - 1) {
+    uint num = __builtin_ctz(m);
+    for (int c = 0; c < 2; c++) {
+      if (atomic_load(&cores[c].running) && !(atomic_load(&cores[c].active) & (1u << num))) {
+        raised |= core_pend(c, num);
+      }
+    }
+  }
+  return raised;
+}
+
+/************************************
+ * HOST API
+ ************************************/
+
+int host_wait_idle(uint core) {
+  uint64_t deadline = real_ns() + 5000000000u;
+  while (real_ns() < deadline) {
+    core_t * c = &cores[core];
+    if (!atomic_load(&c->running)) return 0;
+    if (atomic_load(&c->sleeping) && !atomic_load(&c->event) && !(atomic_load(&c->pending) & atomic_load(&c->enabled)) && !atomic_load(&c->active)) {
+      return 0;
+    }
+    sleep_ns(100000);
+  }
+  return 1;
+}
+
+/************************************
+ * PICO-SDK FUNCTIONS
+ ************************************/
+
+uint get_core_num(void) {
+  return this_core == 1 ? 1 : 0;
+}
+
+uint __get_current_exception(void) {
+  return current_irq < 0 ? 0 : 16 + current_irq;
+}
+
+void tight_loop_contents(void) {
+  core_yield();
+  sched_yield();
+}
+
+void panic(const char * fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+  abort();
+}
+
+bool stdio_init_all(void) {
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  return true;
+}
+
+uint64_t time_us_64(void) {
+  return real_ns() / 1000;
+}
+
+uint32_t time_us_32(void) {
+  return (uint32_t) time_us_64();
+}
+
+void sleep_us(uint64_t us) {
+  uint64_t end = real_ns() + us * 1000;
+  for (uint64_t now = real_ns(); now < end; now = real_ns()) {
+    core_yield();
+    sleep_ns(end - now);
+  }
+}
+
+void sleep_ms(uint32_t ms) {
+  sleep_us((uint64_t) ms * 1000);
+}
+
+void busy_wait_us_32(uint32_t us) {
+  sleep_us(us);
+}
+
+// hardware/sync.h
+
+void __sev(void) {
+  for (int c = 0; c < 2; c++) {
+    atomic_store(&cores[c].event, true);
+    if (c != this_core) core_signal(c);
+  }
+}
+
+void __wfe(void) {
+  core_yield();
+  if (this_core < 0) {
+    sched_yield();
+    return;
+  }
+  core_t * core = &cores[this_core];
+  if (!atomic_exchange(&core->event, false)) {
+    atomic_store(&core->sleeping, current_irq < 0);
+    if (!atomic_load(&core->event)) sleep_ns(WFE_SLEEP_NS);
+    atomic_store(&core->sleeping, false);
+    atomic_store(&core->event, false);
+  }
+  core_yield();
+}
+
+void __wfi(void) {
+  core_yield();
+  if (this_core < 0) {
+    sched_yield();
+    return;
+  }
+  atomic_store(&cores[this_core].sleeping, current_irq < 0);
+  sleep_ns(WFE_SLEEP_NS);
+  atomic_store(&cores[this_core].sleeping, false);
+  core_yield();
+}
+
+uint32_t save_and_disable_interrupts(void) {
+  uint32_t status = primask;
+  primask         = 1;
+  return status;
+}
+
+void restore_interrupts(uint32_t status) {
+  primask = status;
+  if (!status) dispatch();
+}
+
+spin_lock_t * spin_lock_instance(uint lock_num) {
+  return (spin_lock_t *) &spin_locks[lock_num];
+}
+
+uint spin_lock_get_num(spin_lock_t * lock) {
+  return (atomic_uint *) lock - spin_locks;
+}
+
+void spin_lock_claim(uint lock_num) {
+  if (atomic_fetch_or(&spin_locks_claimed, 1u << lock_num) & (1u << lock_num)) {
+    panic("Spin lock %u already claimed", lock_num);
+  }
+}
+
+int spin_lock_claim_unused(bool required) {
+  for (uint i = PICO_SPINLOCK_ID_CLAIM_FREE_FIRST; i < NUM_SPIN_LOCKS; i++) {
+    if (!(atomic_fetch_or(&spin_locks_claimed, 1u << i) & (1u << i))) return i;
+  }
+  if (required) panic("No spin locks are available");
+  return -1;
+}
+
+void spin_lock_unclaim(uint lock_num) {
+  atomic_store(&spin_locks[lock_num], 0);
+  atomic_fetch_and(&spin_locks_claimed, ~(1u << lock_num));
+}
+
+spin_lock_t * spin_lock_init(uint lock_num) {
+  atomic_store(&spin_locks[lock_num], 0);
+  return spin_lock_instance(lock_num);
+}
+
+void spin_locks_reset(void) {
+  for (int i = 0; i < NUM_SPIN_LOCKS; i++) {
+    atomic_store(&spin_locks[i], 0);
+  }
+}
+
+void spin_lock_unsafe_blocking(spin_lock_t * lock) {
+  while (atomic_exchange((atomic_uint *) lock, 1)) {
+    sched_yield();
+  }
+}
+
+void spin_unlock_unsafe(spin_lock_t * lock) {
+  atomic_store((atomic_uint *) lock, 0);
+}
+
+uint32_t spin_lock_blocking(spin_lock_t * lock) {
+  uint32_t save = save_and_disable_interrupts();
+  spin_lock_unsafe_blocking(lock);
+  return save;
+}
+
+void spin_unlock(spin_lock_t * lock, uint32_t saved_irq) {
+  spin_unlock_unsafe(lock);
+  restore_interrupts(saved_irq);
+}
+
+bool is_spin_locked(spin_lock_t * lock) {
+  return atomic_load((atomic_uint *) lock) != 0;
+}
+
+// hardware/irq.h. Enables, priorities and pending bits belong to the calling core.
+
+void irq_set_priority(uint num, uint8_t hardware_priority) {
+  cores[get_core_num()].priority[num] = hardware_priority;
+}
+
+uint irq_get_priority(uint num) {
+  return cores[get_core_num()].priority[num];
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+  irq_set_mask_enabled(1u << num, enabled);
+}
+
+bool irq_is_enabled(uint num) {
+  return atomic_load(&cores[get_core_num()].enabled) & (1u << num);
+}
+
+void irq_set_mask_enabled(uint32_t mask, bool enabled) {
+  core_t * core = &cores[get_core_num()];
+  if (enabled) {
+    atomic_fetch_and(&core->pending, ~mask); // The SDK clears anything pending first
+    atomic_fetch_or(&core->enabled, mask);
+    irq_refresh(); // Already asserted (DMA IRQs are level triggered)
+    dispatch();
+  } else {
+    atomic_fetch_and(&core->enabled, ~mask);
+  }
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+  if (handlers[num][0] && handlers[num][0] != handler) panic("IRQ %u already has a handler", num);
+  handlers[num][0] = handler;
+}
+
+irq_handler_t irq_get_exclusive_handler(uint num) {
+  return handlers[num][0];
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+  for (int i = 0; i < MAX_SHARED; i++) {
+    if (!handlers[num][i]) {
+      handlers[num][i] = handler;
+      return;
+    }
+  }
+  panic("Too many shared handlers on IRQ %u", num);
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler) {
+  for (int i = 0; i < MAX_SHARED; i++) {
+    if (handlers[num][i] == handler) {
+      for (; i < MAX_SHARED - 1; i++) {
+        handlers[num][i] = handlers[num][i + 1];
+      }
+      handlers[num][MAX_SHARED - 1] = NULL;
+      return;
+    }
+  }
+}
+
+void irq_set_pending(uint num) {
+  atomic_fetch_or(&cores[get_core_num()].pending, 1u << num);
+  dispatch();
+}
+
+void irq_clear(uint num) {
+  atomic_fetch_and(&cores[get_core_num()].pending, ~(1u << num));
+}
+
+void user_irq_claim(uint irq_num) {
+  core_t * core = &cores[get_core_num()];
+  if (core->user_irqs_claimed & (1u << irq_num)) panic("User IRQ %u already claimed", irq_num);
+  core->user_irqs_claimed |= 1u << irq_num;
+}
+
+int user_irq_claim_unused(bool required) {
+  core_t * core = &cores[get_core_num()];
+  for (uint i = FIRST_USER_IRQ; i < FIRST_USER_IRQ + NUM_USER_IRQS; i++) {
+    if (!(core->user_irqs_claimed & (1u << i))) {
+      core->user_irqs_claimed |= 1u << i;
+      return i;
+    }
+  }
+  if (required) panic("No user IRQs are available");
+  return -1;
+}
+
+void user_irq_unclaim(uint irq_num) {
+  cores[get_core_num()].user_irqs_claimed &= ~(1u << irq_num);
+}
+
+bool user_irq_is_claimed(uint irq_num) {
+  return cores[get_core_num()].user_irqs_claimed & (1u << irq_num);
+}
+
+// pico/multicore.h
+
+void multicore_launch_core1(void (*entry)(void)) {
+  if (atomic_load(&cores[1].running)) panic("Core 1 is already running");
+  core_reset_state(&cores[1]);
+  core1_entry = entry;
+  atomic_store(&core1_reset, false);
+  atomic_store(&cores[1].running, true);
+  if (pthread_create(&cores[1].thread, NULL, core1_main, NULL)) panic("Couldn't start core 1");
+}
+
+void multicore_reset_core1(void) {
+  if (core1_entry) {
+    atomic_store(&core1_reset, true);
+    uint64_t deadline = real_ns() + CORE1_RESET_WAIT_S * 1000000000ull;
+    while (atomic_load(&cores[1].running)) {
+      if (real_ns() > deadline) panic("Core 1 didn't stop, it has to reach __wfe(), __wfi() or tight_loop_contents()");
+      core_signal(1);
+      sleep_ns(100000);
+    }
+    pthread_join(cores[1].thread, NULL);
+    core1_entry = NULL;
+  }
+  core_reset_state(&cores[1]);
+  atomic_store(&fifos[0].tail, atomic_load(&fifos[0].head));
+  atomic_store(&fifos[1].tail, atomic_load(&fifos[1].head));
+}
+
+bool multicore_fifo_rvalid(void) {
+  fifo_t * fifo = &fifos[get_core_num()];
+  return atomic_load(&fifo->tail) != atomic_load(&fifo->head);
+}
+
+bool multicore_fifo_wready(void) {
+  fifo_t * fifo = &fifos[!get_core_num()];
+  return atomic_load(&fifo->head) - atomic_load(&fifo->tail) < FIFO_DEPTH;
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+  while (!fifo_push(&fifos[!get_core_num()], data)) {
+    tight_loop_contents();
+  }
+  __sev();
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+  uint32_t data;
+  while (!fifo_pop(&fifos[get_core_num()], &data)) {
+    __wfe();
+  }
+  return data;
+}
+
+void multicore_fifo_drain(void) {
+  uint32_t data;
+  while (fifo_pop(&fifos[get_core_num()], &data));
+}
+
+// hardware/clocks.h
+
+void clocks_init(void) {
+}
+
+void set_sys_clock_pll(uint32_t vco_freq, uint post_div1, uint post_div2) {
+  emu_stats.pll_changes++;
+  emu_set_sys_hz(vco_freq / (post_div1 * post_div2));
+}
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required) {
+  emu_stats.pll_changes++;
+  emu_set_sys_hz(freq_khz * 1000);
+  return true;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+  switch (clk_index) {
+    case clk_sys:
+    case clk_peri:
+      return emu_sys_hz();
+    case clk_usb:
+    case clk_adc:
+      return 48000000;
+    default:
+      return 12000000;
+  }
+}
+
+// hardware/gpio.h. No pins.
+
+void gpio_init(uint gpio) {
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+  if (gpio >= NUM_BANK0_GPIOS) panic("GPIO %u doesn't exist", gpio);
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+}
+
+void gpio_put(uint gpio, bool value) {
+}
+
+bool gpio_get(uint gpio) {
+  return false;
+}
+
+void gpio_pull_up(uint gpio) {
+}
+
+void gpio_pull_down(uint gpio) {
+}
@@ -0,0 +1,428 @@
+// Host build: the DMA.
+//
+// Channels run whenever their DREQ lets them: unpaced ones (DREQ_FORCE) all the way through, right away, on whichever
+// thread started them; PIO TX ones while the FIFO has room; PWM wrap ones once a wrap. Writes into dma_hw (chained
+// control blocks) and into a PIO TX FIFO do what they would on the RP2040, everything else is host memory. Addresses
+// are 32 bits like the real registers, see host/CMakeLists.txt.
+
+#include "emu.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "pico/platform.h"
+
+#include <string.h>
+
+#define INTR_MARKER (1u << 31) // Published in intr, so a CPU write to it (write 1 to clear) shows up
+
+enum {
+  REG_READ,
+  REG_WRITE,
+  REG_COUNT,
+  REG_CTRL,
+};
+
+// Register each word of a channel's 4 aliases maps to. The last one of every alias is a trigger.
+static const uint8_t alias_reg[16] = { REG_READ, REG_WRITE, REG_COUNT, REG_CTRL, REG_CTRL, REG_READ, REG_WRITE, REG_COUNT,
+                                       REG_CTRL, REG_COUNT, REG_READ, REG_WRITE, REG_CTRL, REG_WRITE, REG_COUNT, REG_READ };
+
+#define CHANNEL_WORDS (sizeof(dma_channel_hw_t) / 4)
+#define HW_WORDS      (sizeof(dma_hw_t) / 4)
+#define WORD(field)   (offsetof(dma_hw_t, field) / 4)
+
+typedef struct {
+  uint32_t read;
+  uint32_t write;
+  uint32_t count; // Transfers left
+  uint32_t reload; // What a trigger loads into count
+  uint32_t ctrl;
+  bool busy;
+  uint32_t credits; // PWM wraps waiting to be used up
+} channel_t;
+
+static channel_t channels[NUM_DMA_CHANNELS];
+static uint32_t claimed;
+static uint32_t intr;
+static uint32_t inte[2];
+static uint32_t intf[2];
+
+static dma_hw_t dma_hw_inst __aligned(64); // Ring writes into a channel's alias 3 registers need them 16 byte aligned
+static uint32_t shadow[HW_WORDS];           // What was last published in dma_hw_inst
+dma_hw_t * const dma_hw = &dma_hw_inst;
+
+/************************************
+ * STATIC FUNCTIONS
+ ************************************/
+
+static uint32_t dma_addr(const volatile void * addr) {
+  if ((uintptr_t) addr >> 32) panic("DMA address %p isn't below 4GB. Link with -no-pie and keep DMA buffers out of the stack and big mallocs.", addr);
+  return (uint32_t) (uintptr_t) addr;
+}
+
+static uint treq(const channel_t * c) {
+  return (c->ctrl & DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) >> DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB;
+}
+
+static uint chain_to(const channel_t * c) {
+  return (c->ctrl & DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) >> DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB;
+}
+
+static void start(uint n) {
+  channel_t * c = &channels[n];
+  if (!(c->ctrl & DMA_CH0_CTRL_TRIG_EN_BITS)) return;
+  c->busy  = true;
+  c->count = c->reload;
+}
+
+static void complete(uint n) {
+  channel_t * c = &channels[n];
+  c->busy       = false;
+  if (!(c->ctrl & DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS)) intr |= 1u << n;
+  if (chain_to(c) != n) start(chain_to(c));
+}
+
+static void reg_write(uint n, uint word, uint32_t value) {
+  channel_t * c = &channels[n];
+  uint reg      = alias_reg[word];
+  switch (reg) {
+    case REG_READ:
+      c->read = value;
+      break;
+    case REG_WRITE:
+      c->write = value;
+      break;
+    case REG_COUNT:
+      c->reload = value;
+      break;
+    case REG_CTRL:
+      c->ctrl = value & ~(DMA_CH0_CTRL_TRIG_BUSY_BITS | DMA_CH0_CTRL_TRIG_AHB_ERROR_BITS | DMA_CH0_CTRL_TRIG_READ_ERROR_BITS | DMA_CH0_CTRL_TRIG_WRITE_ERROR_BITS);
+      if (!(c->ctrl & DMA_CH0_CTRL_TRIG_EN_BITS)) c->busy = false;
+      break;
+  }
+
+  if (word % 4 == 3) {
+    if (value == 0 && reg != REG_CTRL) {
+      // Null trigger: doesn't start the channel, raises its IRQ if it's IRQ quiet (that's what quiet is for)
+      if (c->ctrl & DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS) intr |= 1u << n;
+    } else {
+      start(n);
+    }
+  }
+}
+
+static bool dreq_ready(channel_t * c) {
+  uint dreq = treq(c);
+  if (dreq < 16) return pio_dreq_ready(dreq);
+  if (dreq >= DREQ_PWM_WRAP0 && dreq < DREQ_PWM_WRAP0 + 8) return c->credits > 0;
+  return true; // DREQ_FORCE, and everything there's no model of
+}
+
+static uint32_t ring_step(uint32_t addr, uint32_t step, uint ring_bits) {
+  if (!ring_bits) return addr + step;
+  uint32_t mask = (1u << ring_bits) - 1;
+  return (addr & ~mask) | ((addr + step) & mask);
+}
+
+static void transfer(uint n) {
+  channel_t * c  = &channels[n];
+  uint size      = (c->ctrl & DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB;
+  uint read_size = size == DMA_SIZE_PTR ? sizeof(void *) : 1u << size;
+  uint write_size = size == DMA_SIZE_PTR ? 4 : read_size;
+  uint ring_bits = (c->ctrl & DMA_CH0_CTRL_TRIG_RING_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_RING_SIZE_LSB;
+  bool ring_write = c->ctrl & DMA_CH0_CTRL_TRIG_RING_SEL_BITS;
+
+  uint64_t value = 0;
+  memcpy(&value, (const void *) (uintptr_t) c->read, read_size);
+  void * dst = (void *) (uintptr_t) c->write;
+  if (!dma_write_reg(dst, (uint32_t) value) && !pio_txf_push(dst, (uint32_t) value)) {
+    memcpy(dst, &value, write_size);
+  }
+
+  if (c->ctrl & DMA_CH0_CTRL_TRIG_INCR_READ_BITS) c->read = ring_step(c->read, read_size, ring_write ? 0 : ring_bits);
+  if (c->ctrl & DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS) c->write = ring_step(c->write, write_size, ring_write ? ring_bits : 0);
+
+  emu_stats.dma_transfers[n]++;
+  emu_stats.dma_bytes[n] += read_size;
+  if (pio_in_vblank()) emu_stats.dma_blank_transfers[n]++;
+
+  if (--c->count == 0) complete(n);
+}
+
+static void publish_word(uint word, uint32_t value) {
+  uint32_t expected = shadow[word];
+  if (expected == value) return;
+  // If the CPU wrote this since the last dma_sync() leave it, dma_sync() picks it up and it gets published after
+  if (__atomic_compare_exchange_n(&((uint32_t *) &dma_hw_inst)[word], &expected, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    shadow[word] = value;
+  }
+}
+
+/************************************
+ * EMULATOR FUNCTIONS
+ ************************************/
+
+void dma_sync(void) {
+  uint32_t * mem = (uint32_t *) &dma_hw_inst;
+  for (uint word = 0; word < HW_WORDS; word++) {
+    uint32_t value = __atomic_load_n(&mem[word], __ATOMIC_SEQ_CST);
+    if (value == shadow[word]) continue;
+    shadow[word] = value;
+
+    if (word < NUM_DMA_CHANNELS * CHANNEL_WORDS) {
+      reg_write(word / CHANNEL_WORDS, word % CHANNEL_WORDS, value);
+    } else if (word == WORD(intr)) {
+      intr &= ~(value & ~INTR_MARKER); // Write 1 to clear
+    } else if (word == WORD(ints0) || word == WORD(ints1)) {
+      intr &= ~value;
+    } else if (word == WORD(inte0) || word == WORD(inte1)) {
+      inte[word == WORD(inte1)] = value;
+    } else if (word == WORD(intf0) || word == WORD(intf1)) {
+      intf[word == WORD(intf1)] = value;
+    } else if (word == WORD(multi_channel_trigger)) {
+      for (uint32_t m = value; m; m &= m - 1) start(__builtin_ctz(m));
+    } else if (word == WORD(abort)) {
+      for (uint32_t m = value; m; m &= m - 1) channels[__builtin_ctz(m)].busy = false;
+    }
+  }
+}
+
+void dma_publish(void) {
+  for (uint n = 0; n < NUM_DMA_CHANNELS; n++) {
+    const channel_t * c   = &channels[n];
+    const uint32_t reg[4] = { c->read, c->write, c->count, c->ctrl | (c->busy ? DMA_CH0_CTRL_TRIG_BUSY_BITS : 0) };
+    for (uint word = 0; word < CHANNEL_WORDS; word++) {
+      publish_word(n * CHANNEL_WORDS + word, reg[alias_reg[word]]);
+    }
+  }
+  publish_word(WORD(intr), intr | INTR_MARKER);
+  publish_word(WORD(inte0), inte[0]);
+  publish_word(WORD(inte1), inte[1]);
+  publish_word(WORD(intf0), intf[0]);
+  publish_word(WORD(intf1), intf[1]);
+  publish_word(WORD(ints0), (intr & inte[0]) | intf[0]);
+  publish_word(WORD(ints1), (intr & inte[1]) | intf[1]);
+  publish_word(WORD(multi_channel_trigger), 0);
+  publish_word(WORD(abort), 0);
+}
+
+void dma_run(void) {
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (uint n = 0; n < NUM_DMA_CHANNELS; n++) {
+      channel_t * c = &channels[n];
+      while (c->busy && dreq_ready(c)) {
+        if (treq(c) >= DREQ_PWM_WRAP0 && treq(c) < DREQ_PWM_WRAP0 + 8) c->credits--;
+        if (c->count == 0) {
+          complete(n);
+        } else {
+          transfer(n);
+        }
+        progress = true;
+      }
+    }
+  }
+}
+
+uint32_t dma_irq_levels(void) {
+  uint32_t levels = 0;
+  if ((intr & inte[0]) | intf[0]) levels |= 1u << DMA_IRQ_0;
+  if ((intr & inte[1]) | intf[1]) levels |= 1u << DMA_IRQ_1;
+  return levels;
+}
+
+bool dma_dreq_wanted(uint dreq) {
+  for (uint n = 0; n < NUM_DMA_CHANNELS; n++) {
+    if (channels[n].busy && treq(&channels[n]) == dreq) return true;
+  }
+  return false;
+}
+
+void dma_dreq_pulse(uint dreq) {
+  for (uint n = 0; n < NUM_DMA_CHANNELS; n++) {
+    if (channels[n].busy && treq(&channels[n]) == dreq) channels[n].credits++;
+  }
+}
+
+bool dma_write_reg(volatile void * addr, uint32_t value) {
+  uintptr_t offset = (uintptr_t) addr - (uintptr_t) &dma_hw_inst;
+  if (offset >= NUM_DMA_CHANNELS * sizeof(dma_channel_hw_t)) return false; // Only the channels, nothing chains into the rest
+  uint word = offset / 4;
+  reg_write(word / CHANNEL_WORDS, word % CHANNEL_WORDS, value);
+  return true;
+}
+
+/************************************
+ * PICO-SDK FUNCTIONS
+ ************************************/
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+  dma_channel_config c = { 0 };
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, DREQ_FORCE);
+  channel_config_set_chain_to(&c, channel);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_enable(&c, true);
+  return c;
+}
+
+dma_channel_config dma_get_channel_config(uint channel) {
+  bus_lock();
+  dma_channel_config c = { channels[channel].ctrl };
+  bus_unlock();
+  return c;
+}
+
+void dma_channel_claim(uint channel) {
+  if (claimed & (1u << channel)) panic("DMA channel %u is already claimed", channel);
+  claimed |= 1u << channel;
+}
+
+void dma_claim_mask(uint32_t channel_mask) {
+  for (uint32_t m = channel_mask; m; m &= m - 1) dma_channel_claim(__builtin_ctz(m));
+}
+
+int dma_claim_unused_channel(bool required) {
+  for (uint n = 0; n < NUM_DMA_CHANNELS; n++) {
+    if (!(claimed & (1u << n))) {
+      claimed |= 1u << n;
+      return n;
+    }
+  }
+  if (required) panic("No DMA channels are available");
+  return -1;
+}
+
+void dma_channel_unclaim(uint channel) {
+  claimed &= ~(1u << channel);
+}
+
+void dma_unclaim_mask(uint32_t channel_mask) {
+  claimed &= ~channel_mask;
+}
+
+bool dma_channel_is_claimed(uint channel) {
+  return claimed & (1u << channel);
+}
+
+void dma_channel_set_config(uint channel, const dma_channel_config * config, bool trigger) {
+  bus_lock();
+  reg_write(channel, trigger ? 3 : 4, config->ctrl);
+  bus_unlock();
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void * read_addr, bool trigger) {
+  bus_lock();
+  reg_write(channel, trigger ? 15 : 0, dma_addr(read_addr));
+  bus_unlock();
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void * write_addr, bool trigger) {
+  bus_lock();
+  reg_write(channel, trigger ? 11 : 1, dma_addr(write_addr));
+  bus_unlock();
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+  bus_lock();
+  reg_write(channel, trigger ? 7 : 2, trans_count);
+  bus_unlock();
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config * config, volatile void * write_addr, const volatile void * read_addr, uint transfer_count, bool trigger) {
+  bus_lock();
+  dma_channel_set_read_addr(channel, read_addr, false);
+  dma_channel_set_write_addr(channel, write_addr, false);
+  dma_channel_set_trans_count(channel, transfer_count, false);
+  dma_channel_set_config(channel, config, trigger);
+  bus_unlock();
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void * read_addr, uint32_t transfer_count) {
+  bus_lock();
+  dma_channel_set_read_addr(channel, read_addr, false);
+  dma_channel_set_trans_count(channel, transfer_count, true);
+  bus_unlock();
+}
+
+void dma_channel_transfer_to_buffer_now(uint channel, volatile void * write_addr, uint32_t transfer_count) {
+  bus_lock();
+  dma_channel_set_write_addr(channel, write_addr, false);
+  dma_channel_set_trans_count(channel, transfer_count, true);
+  bus_unlock();
+}
+
+void dma_start_channel_mask(uint32_t chan_mask) {
+  bus_lock();
+  for (uint32_t m = chan_mask; m; m &= m - 1) start(__builtin_ctz(m));
+  bus_unlock();
+}
+
+void dma_channel_start(uint channel) {
+  dma_start_channel_mask(1u << channel);
+}
+
+void dma_channel_abort(uint channel) {
+  bus_lock();
+  channels[channel].busy = false;
+  bus_unlock();
+}
+
+bool dma_channel_is_busy(uint channel) {
+  bus_lock();
+  bool busy = channels[channel].busy;
+  bus_unlock();
+  return busy;
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel) {
+  while (dma_channel_is_busy(channel)) {
+    tight_loop_contents();
+  }
+}
+
+static void set_irq_enabled(int irq, uint32_t channel_mask, bool enabled) {
+  bus_lock();
+  inte[irq] = enabled ? inte[irq] | channel_mask : inte[irq] & ~channel_mask;
+  bus_unlock();
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+  set_irq_enabled(0, 1u << channel, enabled);
+}
+
+void dma_set_irq0_channel_mask_enabled(uint32_t channel_mask, bool enabled) {
+  set_irq_enabled(0, channel_mask, enabled);
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) {
+  set_irq_enabled(1, 1u << channel, enabled);
+}
+
+void dma_set_irq1_channel_mask_enabled(uint32_t channel_mask, bool enabled) {
+  set_irq_enabled(1, channel_mask, enabled);
+}
+
+bool dma_channel_get_irq0_status(uint channel) {
+  bus_lock();
+  bool status = ((intr & inte[0]) | intf[0]) & (1u << channel);
+  bus_unlock();
+  return status;
+}
+
+bool dma_channel_get_irq1_status(uint channel) {
+  bus_lock();
+  bool status = ((intr & inte[1]) | intf[1]) & (1u << channel);
+  bus_unlock();
+  return status;
+}
+
+void dma_channel_acknowledge_irq0(uint channel) {
+  bus_lock();
+  intr &= ~(1u << channel);
+  bus_unlock();
+}
+
+void dma_channel_acknowledge_irq1(uint channel) {
+  dma_channel_acknowledge_irq0(channel); // Both clear the same raw status
+}
@@ -0,0 +1,311 @@
+// Host build: the emulator thread, and the lock between it and the cores.
+//
+// The emulated peripherals keep their state here on the host and mirror it into the register structs (dma_hw, pio0/1,
+// pwm_hw) the library reads directly. bus_lock() picks up anything the CPU wrote to those structs since, and
+// bus_unlock() mirrors the state back out and raises whatever IRQs are asserted.
+//
+// The emulator thread steps the color state machine, the PWM slices and the DMA channels they pace through emulated
+// time, which follows the host's wall clock at the emulated system clock (or PV_HOST_TIME_SCALE times slower). Every
+// time a DMA IRQ goes off it waits for the cores to run their handlers before it carries on (up to
+// PV_HOST_IRQ_TIMEOUT_MS), so IRQ handlers are never late as far as the emulated hardware is concerned.
+
+#include "emu.h"
+#include "hardware/sync.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_SYS_HZ  125000000
+#define MAX_STEP_NS     20000   // Hold the bus for at most this much emulated time at once
+#define MAX_SLEEP_NS    1000000
+#define MAX_FRAME_BYTES (2048 * 1024)
+
+host_stats_t emu_stats;
+
+static pthread_mutex_t bus            = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread uint32_t bus_depth    = 0;
+static __thread uint32_t bus_saved    = 0;
+static pthread_cond_t wake            = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t frame_lock     = PTHREAD_MUTEX_INITIALIZER; // Only for the frames, so waiting on one doesn't hold up IRQs
+static pthread_cond_t frame_done      = PTHREAD_COND_INITIALIZER;
+
+static _Atomic uint64_t now_ticks     = 0;
+static uint32_t sys_hz                = DEFAULT_SYS_HZ;
+static double time_scale              = 1.0;
+static uint64_t irq_timeout_ns        = 50000000;
+static uint64_t anchor_ns             = 0; // now_ticks was anchor_ticks at anchor_ns on the host's clock
+static uint64_t anchor_ticks          = 0;
+
+// Frames: the color state machine writes into frame_buf[writing], a finished frame becomes frame_buf[!writing]
+static uint8_t * frame_buf[2];
+static uint32_t frame_len[2];
+static int writing                    = 0;
+static uint32_t frames_done           = 0;
+
+/************************************
+ * STATIC FUNCTIONS
+ ************************************/
+
+static uint64_t real_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+static double ticks_per_ns() {
+  return (double) sys_hz * TICKS_PER_CYCLE / 1e9 / time_scale;
+}
+
+// Where emulated time should be by now
+static uint64_t target_ticks() {
+  return anchor_ticks + (uint64_t) ((double) (real_ns() - anchor_ns) * ticks_per_ns());
+}
+
+static void sync_cpu_writes() {
+  dma_sync();
+  pio_sync();
+}
+
+static void publish() {
+  dma_publish();
+  pio_publish();
+}
+
+// An IRQ just went off, let the cores handle it before the emulated hardware moves on
+static void lockstep() {
+  publish();
+  pthread_mutex_unlock(&bus);
+  uint64_t deadline = real_ns() + irq_timeout_ns;
+  while (!cores_idle()) {
+    if (real_ns() > deadline) {
+      emu_stats.lockstep_timeouts++;
+      break;
+    }
+    struct timespec t = { 0, 10000 };
+    nanosleep(&t, NULL);
+  }
+  pthread_mutex_lock(&bus);
+  sync_cpu_writes();
+}
+
+// Run everything up to emulated time stop
+static void advance(uint64_t stop) {
+  while (true) {
+    dma_run();
+    if (irq_update_levels()) {
+      lockstep();
+      continue;
+    }
+
+    uint64_t pio = pio_next_event();
+    uint64_t pwm = pwm_next_event();
+    uint64_t t   = pio < pwm ? pio : pwm;
+    if (t > stop) break;
+    if (t > now_ticks) now_ticks = t;
+    pwm_process(now_ticks);
+    pio_process(now_ticks);
+  }
+  if (stop > now_ticks) now_ticks = stop;
+}
+
+static void * emu_main(void * arg) {
+  sigset_t set;
+  sigfillset(&set);
+  pthread_sigmask(SIG_BLOCK, &set, NULL); // IRQs only go to the cores
+
+  pthread_mutex_lock(&bus);
+  while (true) {
+    sync_cpu_writes();
+    uint64_t target = target_ticks();
+    uint64_t max    = now_ticks + (uint64_t) (MAX_STEP_NS * ticks_per_ns());
+    advance(target < max ? target : max);
+    publish();
+
+    uint64_t next = pio_next_event();
+    uint64_t pwm  = pwm_next_event();
+    if (pwm < next) next = pwm;
+
+    if (target > now_ticks) {
+      // Behind, let the cores in and keep going
+      pthread_mutex_unlock(&bus);
+      sched_yield();
+      pthread_mutex_lock(&bus);
+      continue;
+    }
+
+    // Sleep until the next event (or until something changes)
+    uint64_t sleep_ns = MAX_SLEEP_NS;
+    if (next != NEVER && next > now_ticks && (next - now_ticks) / ticks_per_ns() < sleep_ns) {
+      sleep_ns = (next - now_ticks) / ticks_per_ns();
+    } else if (next != NEVER && next <= now_ticks) {
+      sleep_ns = 0;
+    }
+    if (sleep_ns) {
+      struct timespec until;
+      clock_gettime(CLOCK_REALTIME, &until);
+      until.tv_nsec += sleep_ns;
+      until.tv_sec += until.tv_nsec / 1000000000;
+      until.tv_nsec %= 1000000000;
+      pthread_cond_timedwait(&wake, &bus, &until);
+    }
+  }
+  return NULL;
+}
+
+__attribute__((constructor)) static void emu_init() {
+  const char * scale = getenv("PV_HOST_TIME_SCALE");
+  if (scale && atof(scale) > 0) time_scale = atof(scale);
+  const char * timeout = getenv("PV_HOST_IRQ_TIMEOUT_MS");
+  if (timeout && atoi(timeout) > 0) irq_timeout_ns = (uint64_t) atoi(timeout) * 1000000;
+
+  anchor_ns = real_ns();
+  for (int i = 0; i < 2; i++) {
+    frame_buf[i] = malloc(MAX_FRAME_BYTES); // Not DMA visible, doesn't have to be below 4GB
+  }
+
+  pthread_t thread;
+  pthread_create(&thread, NULL, emu_main, NULL);
+  pthread_detach(thread);
+}
+
+/************************************
+ * EMULATOR FUNCTIONS
+ ************************************/
+
+void bus_enter(void) {
+  pthread_mutex_lock(&bus);
+  if (bus_depth++ == 0) {
+    sync_cpu_writes();
+  }
+}
+
+void bus_leave(void) {
+  if (--bus_depth == 0) {
+    dma_run(); // Unpaced channels (and anything paced by a FIFO with room) run right away
+    publish();
+    irq_update_levels();
+    pthread_cond_signal(&wake);
+  }
+  pthread_mutex_unlock(&bus);
+}
+
+void bus_lock(void) {
+  uint32_t save = save_and_disable_interrupts();
+  bus_enter();
+  if (bus_depth == 1) bus_saved = save;
+}
+
+void bus_unlock(void) {
+  uint32_t save = bus_saved;
+  bool outer    = bus_depth == 1;
+  bus_leave();
+  if (outer) restore_interrupts(save);
+}
+
+uint64_t emu_now(void) {
+  return now_ticks;
+}
+
+uint32_t emu_sys_hz(void) {
+  return sys_hz;
+}
+
+void emu_set_sys_hz(uint32_t hz) {
+  bus_lock();
+  anchor_ns    = real_ns();
+  anchor_ticks = now_ticks;
+  sys_hz       = hz;
+  bus_unlock();
+}
+
+uint64_t emu_ticks_to_ns(uint64_t ticks) {
+  return ticks / ticks_per_ns();
+}
+
+void emu_wake(void) {
+  pthread_cond_signal(&wake);
+}
+
+void emu_frame_start(void) {
+  frame_len[writing] = 0;
+}
+
+void emu_frame_pixels(const uint8_t * pixels, uint32_t count) {
+  uint32_t len = frame_len[writing];
+  if (len + count > MAX_FRAME_BYTES) count = MAX_FRAME_BYTES - len;
+  memcpy(frame_buf[writing] + len, pixels, count);
+  frame_len[writing] = len + count;
+}
+
+void emu_frame_end(void) {
+  pthread_mutex_lock(&frame_lock);
+  writing = !writing;
+  frames_done++;
+  emu_stats.frames++;
+  pthread_cond_broadcast(&frame_done);
+  pthread_mutex_unlock(&frame_lock);
+}
+
+/************************************
+ * HOST API
+ ************************************/
+
+int host_wait_frames(uint32_t frames) {
+  pthread_mutex_lock(&frame_lock);
+  uint32_t until = frames_done + frames;
+  int ret        = 0;
+  while ((int32_t) (frames_done - until) < 0) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += 1 + (time_t) time_scale;
+    uint32_t before = frames_done;
+    pthread_cond_timedwait(&frame_done, &frame_lock, &deadline);
+    if (frames_done == before) {
+      ret = 1; // Nothing for a whole second, the scanout isn't running
+      break;
+    }
+  }
+  pthread_mutex_unlock(&frame_lock);
+  return ret;
+}
+
+uint32_t host_get_frame(uint8_t * pixels, uint32_t max) {
+  pthread_mutex_lock(&frame_lock);
+  uint32_t len = 0;
+  if (frames_done) {
+    len = frame_len[!writing] < max ? frame_len[!writing] : max;
+    memcpy(pixels, frame_buf[!writing], len);
+  }
+  pthread_mutex_unlock(&frame_lock);
+  return len;
+}
+
+int host_write_ppm(const char * path, const uint8_t * pixels, uint16_t width, uint16_t height, uint32_t stride) {
+  FILE * f = fopen(path, "wb");
+  if (!f) return 1;
+  fprintf(f, "P6\n%u %u\n255\n", width, height);
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      uint8_t c      = pixels[y * stride + x];
+      uint8_t rgb[3] = { (c >> 5) * 255 / 7, ((c >> 2) & 7) * 255 / 7, (c & 3) * 255 / 3 }; // RGB332
+      fwrite(rgb, 1, 3, f);
+    }
+  }
+  return fclose(f) != 0;
+}
+
+void host_get_stats(host_stats_t * stats) {
+  bus_lock();
+  *stats = emu_stats;
+  bus_unlock();
+}
+
+void host_reset_stats(void) {
+  bus_lock();
+  memset(&emu_stats, 0, sizeof(emu_stats));
+  bus_unlock();
+}
@@ -0,0 +1,58 @@
+// Host build: what the emulated peripherals share. See emu.c.
+
+#ifndef _HOST_EMU_INTERNAL_H
+#define _HOST_EMU_INTERNAL_H
+
+#include "host-emu.h"
+
+#include <stdatomic.h>
+
+// Emulated time is kept in ticks, 1/256ths of a system clock cycle (the color state machine's divider is in 1/256ths)
+#define TICKS_PER_CYCLE 256
+#define NEVER           UINT64_MAX
+
+extern host_stats_t emu_stats;
+
+// emu.c
+void bus_lock(void);   // Holds off this core's IRQs and the emulator, and picks up CPU writes to the registers
+void bus_unlock(void); // Publishes the registers, raises IRQs and lets pending ones in
+void bus_enter(void);  // Same without touching the IRQ mask, for code that already holds IRQs off
+void bus_leave(void);
+uint64_t emu_now(void); // Emulated time, in ticks
+uint32_t emu_sys_hz(void);
+void emu_set_sys_hz(uint32_t hz);
+void emu_wake(void); // Something changed that the emulator thread might be waiting on
+void emu_frame_start(void);
+void emu_frame_pixels(const uint8_t * pixels, uint32_t count);
+void emu_frame_end(void);
+uint64_t emu_ticks_to_ns(uint64_t ticks);
+
+// core.c
+int core_this(void); // 0 or 1 on the core threads, -1 anywhere else
+void core_yield(void); // Point where core 1 can be reset
+bool cores_idle(void); // No IRQ pending or running on either core
+bool irq_update_levels(void); // Pends the DMA IRQs that are asserted, true if a core has to run a handler now
+
+// dma.c
+void dma_sync(void);    // Picks up CPU writes to dma_hw
+void dma_publish(void); // Writes the channel state out to dma_hw
+void dma_run(void);     // Runs every channel that can go
+uint32_t dma_irq_levels(void); // (1 << DMA_IRQ_0) and/or (1 << DMA_IRQ_1)
+bool dma_dreq_wanted(uint dreq); // A busy channel is waiting on this DREQ
+void dma_dreq_pulse(uint dreq);  // One more transfer for the channels paced by this DREQ
+bool dma_write_reg(volatile void * addr, uint32_t value); // false if addr isn't in dma_hw
+
+// pio.c
+void pio_sync(void);
+void pio_publish(void);
+uint64_t pio_next_event(void);
+void pio_process(uint64_t now);
+bool pio_txf_push(volatile void * addr, uint32_t value); // false if addr isn't a TX FIFO
+bool pio_dreq_ready(uint dreq);
+bool pio_in_vblank(void);
+
+// pwm.c
+uint64_t pwm_next_event(void);
+void pwm_process(uint64_t now);
+
+#endif
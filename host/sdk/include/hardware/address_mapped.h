@@ -0,0 +1,31 @@
+// Host stand-in for hardware/address_mapped.h. "Registers" are plain memory the emulator keeps up to date, see
+// host/sdk/emu.h.
+
+#ifndef _HARDWARE_ADDRESS_MAPPED_H
+#define _HARDWARE_ADDRESS_MAPPED_H
+
+#include "pico/platform.h"
+
+typedef volatile uint32_t io_rw_32;
+typedef const volatile uint32_t io_ro_32;
+typedef volatile uint32_t io_wo_32;
+typedef volatile uint16_t io_rw_16;
+typedef volatile uint8_t io_rw_8;
+
+static inline void hw_set_bits(io_rw_32 * addr, uint32_t mask) {
+  *addr |= mask;
+}
+
+static inline void hw_clear_bits(io_rw_32 * addr, uint32_t mask) {
+  *addr &= ~mask;
+}
+
+static inline void hw_xor_bits(io_rw_32 * addr, uint32_t mask) {
+  *addr ^= mask;
+}
+
+static inline void hw_write_masked(io_rw_32 * addr, uint32_t values, uint32_t write_mask) {
+  *addr = (*addr & ~write_mask) | (values & write_mask);
+}
+
+#endif
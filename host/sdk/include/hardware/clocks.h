@@ -0,0 +1,27 @@
+// Host stand-in for hardware/clocks.h. The system clock only sets how fast the emulated peripherals run.
+
+#ifndef _HARDWARE_CLOCKS_H
+#define _HARDWARE_CLOCKS_H
+
+#include "pico/platform.h"
+
+enum clock_index {
+  clk_gpout0 = 0,
+  clk_gpout1,
+  clk_gpout2,
+  clk_gpout3,
+  clk_ref,
+  clk_sys,
+  clk_peri,
+  clk_usb,
+  clk_adc,
+  clk_rtc,
+  CLK_COUNT
+};
+
+void clocks_init(void);
+void set_sys_clock_pll(uint32_t vco_freq, uint post_div1, uint post_div2);
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+uint32_t clock_get_hz(enum clock_index clk_index);
+
+#endif
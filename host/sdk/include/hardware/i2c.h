@@ -0,0 +1,16 @@
+// Host stand-in for hardware/i2c.h. Nothing on the host build talks I2C, this only has the types.
+
+#ifndef _HARDWARE_I2C_H
+#define _HARDWARE_I2C_H
+
+#include "pico/platform.h"
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+#endif
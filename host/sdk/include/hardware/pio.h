@@ -0,0 +1,157 @@
+// Host stand-in for hardware/pio.h. The emulated state machines (host/sdk/pio.c) run the color program (color.pio)
+// and nothing else: pio_sm_exec() understands the instructions color.pio.h feeds it, and an enabled state machine
+// shifts pixels out of its TX FIFO and counts out vertical blanking the way color.pio does.
+
+#ifndef _HARDWARE_PIO_H
+#define _HARDWARE_PIO_H
+
+#include "hardware/address_mapped.h"
+
+#define NUM_PIOS                 2
+#define NUM_PIO_STATE_MACHINES   4
+#define PIO_INSTRUCTION_COUNT    32
+
+typedef struct {
+  io_rw_32 clkdiv;
+  io_rw_32 execctrl;
+  io_rw_32 shiftctrl;
+  io_ro_32 addr;
+  io_rw_32 instr;
+  io_rw_32 pinctrl;
+} pio_sm_hw_t;
+
+typedef struct {
+  io_rw_32 ctrl;
+  io_ro_32 fstat;
+  io_rw_32 fdebug;
+  io_ro_32 flevel;
+  io_wo_32 txf[NUM_PIO_STATE_MACHINES];
+  io_ro_32 rxf[NUM_PIO_STATE_MACHINES];
+  io_rw_32 irq;
+  io_wo_32 irq_force;
+  io_rw_32 input_sync_bypass;
+  io_ro_32 dbg_padout;
+  io_ro_32 dbg_padoe;
+  io_ro_32 dbg_cfginfo;
+  io_wo_32 instr_mem[PIO_INSTRUCTION_COUNT];
+  pio_sm_hw_t sm[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t * PIO;
+
+extern pio_hw_t pio0_hw_inst;
+extern pio_hw_t pio1_hw_inst;
+
+#define pio0 (&pio0_hw_inst)
+#define pio1 (&pio1_hw_inst)
+
+#define PIO_FDEBUG_TXSTALL_LSB 24
+#define PIO_FDEBUG_TXOVER_LSB  16
+#define PIO_FDEBUG_RXUNDER_LSB 8
+#define PIO_FDEBUG_RXSTALL_LSB 0
+#define PIO_FSTAT_TXEMPTY_LSB  24
+#define PIO_FSTAT_TXFULL_LSB   16
+
+typedef struct pio_program {
+  const uint16_t * instructions;
+  uint8_t length;
+  int8_t origin;
+} pio_program_t;
+
+typedef struct {
+  uint32_t clkdiv;
+  uint32_t execctrl;
+  uint32_t shiftctrl;
+  uint32_t pinctrl;
+} pio_sm_config;
+
+enum pio_fifo_join {
+  PIO_FIFO_JOIN_NONE = 0,
+  PIO_FIFO_JOIN_TX   = 1,
+  PIO_FIFO_JOIN_RX   = 2,
+};
+
+enum pio_src_dest {
+  pio_pins    = 0u,
+  pio_x       = 1u,
+  pio_y       = 2u,
+  pio_null    = 3u | 0x20u | 0x80u,
+  pio_pindirs = 4u | 0x08u | 0x40u | 0x80u,
+  pio_exec_mov = 4u | 0x08u | 0x10u | 0x20u | 0x80u,
+  pio_status  = 5u | 0x08u | 0x10u | 0x20u | 0x80u,
+  pio_pc      = 5u | 0x08u | 0x20u | 0x40u,
+  pio_isr     = 6u | 0x20u,
+  pio_osr     = 7u | 0x10u | 0x20u,
+  pio_exec_out = 7u | 0x08u | 0x20u | 0x40u | 0x80u,
+};
+
+pio_sm_config pio_get_default_sm_config(void);
+void sm_config_set_out_pins(pio_sm_config * c, uint out_base, uint out_count);
+void sm_config_set_set_pins(pio_sm_config * c, uint set_base, uint set_count);
+void sm_config_set_in_pins(pio_sm_config * c, uint in_base);
+void sm_config_set_sideset_pins(pio_sm_config * c, uint sideset_base);
+void sm_config_set_clkdiv_int_frac(pio_sm_config * c, uint16_t div_int, uint8_t div_frac);
+void sm_config_set_clkdiv(pio_sm_config * c, float div);
+void sm_config_set_wrap(pio_sm_config * c, uint wrap_target, uint wrap);
+void sm_config_set_out_shift(pio_sm_config * c, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_in_shift(pio_sm_config * c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_fifo_join(pio_sm_config * c, enum pio_fifo_join join);
+
+uint pio_get_index(PIO pio);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+void pio_gpio_init(PIO pio, uint pin);
+bool pio_can_add_program(PIO pio, const pio_program_t * program);
+uint pio_add_program(PIO pio, const pio_program_t * program);
+void pio_remove_program(PIO pio, const pio_program_t * program, uint loaded_offset);
+void pio_clear_instruction_memory(PIO pio);
+
+void pio_sm_claim(PIO pio, uint sm);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_unclaim(PIO pio, uint sm);
+bool pio_sm_is_claimed(PIO pio, uint sm);
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config * config);
+void pio_sm_set_config(PIO pio, uint sm, const pio_sm_config * config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_set_sm_mask_enabled(PIO pio, uint32_t mask, bool enabled);
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_clkdiv_restart(PIO pio, uint sm);
+void pio_sm_set_clkdiv_int_frac(PIO pio, uint sm, uint16_t div_int, uint8_t div_frac);
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div);
+void pio_sm_set_pins(PIO pio, uint sm, uint32_t pin_values);
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm);
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_drain_tx_fifo(PIO pio, uint sm);
+
+// Instruction encodings are the real ones, see pio_sm_exec()
+static inline uint pio_encode_jmp(uint addr) {
+  return 0x0000u | (addr & 0x1fu);
+}
+
+static inline uint pio_encode_out(enum pio_src_dest dest, uint count) {
+  return 0x6000u | ((dest & 7u) << 5) | (count & 0x1fu);
+}
+
+static inline uint pio_encode_pull(bool if_empty, bool block) {
+  return 0x8080u | (if_empty ? 0x40u : 0) | (block ? 0x20u : 0);
+}
+
+static inline uint pio_encode_mov(enum pio_src_dest dest, enum pio_src_dest src) {
+  return 0xa000u | ((dest & 7u) << 5) | (src & 7u);
+}
+
+static inline uint pio_encode_nop(void) {
+  return pio_encode_mov(pio_y, pio_y);
+}
+
+#endif
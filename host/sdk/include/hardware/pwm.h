@@ -0,0 +1,84 @@
+// Host stand-in for hardware/pwm.h. Counters are worked out from the emulated system clock (host/sdk/pwm.c),
+// wraps pace DMA channels (DREQ_PWM_WRAP0 + slice). There are no pins and no PWM_IRQ_WRAP.
+
+#ifndef _HARDWARE_PWM_H
+#define _HARDWARE_PWM_H
+
+#include "hardware/address_mapped.h"
+
+#define NUM_PWM_SLICES 8
+
+enum pwm_clkdiv_mode {
+  PWM_DIV_FREE_RUNNING = 0,
+  PWM_DIV_B_HIGH       = 1,
+  PWM_DIV_B_RISING     = 2,
+  PWM_DIV_B_FALLING    = 3,
+};
+
+enum pwm_chan {
+  PWM_CHAN_A = 0,
+  PWM_CHAN_B = 1,
+};
+
+typedef struct {
+  uint32_t csr;
+  uint32_t div; // 8.4 fixed point, like the DIV register
+  uint32_t top;
+} pwm_config;
+
+typedef struct {
+  io_rw_32 en;
+  io_rw_32 intr;
+  io_rw_32 inte;
+  io_rw_32 intf;
+  io_ro_32 ints;
+} pwm_hw_t;
+
+extern pwm_hw_t * const pwm_hw;
+
+static inline uint pwm_gpio_to_slice_num(uint gpio) {
+  return (gpio >> 1u) & 7u;
+}
+
+static inline uint pwm_gpio_to_channel(uint gpio) {
+  return gpio & 1u;
+}
+
+static inline uint pwm_get_dreq(uint slice_num) {
+  return 24 + slice_num; // DREQ_PWM_WRAP0
+}
+
+static inline void pwm_config_set_clkdiv_int_frac(pwm_config * c, uint8_t integer, uint8_t fract) {
+  c->div = ((uint32_t) integer << 4) | (fract & 0xfu);
+}
+
+static inline void pwm_config_set_clkdiv(pwm_config * c, float div) {
+  c->div = (uint32_t) (div * 16.0f);
+}
+
+static inline void pwm_config_set_wrap(pwm_config * c, uint16_t wrap) {
+  c->top = wrap;
+}
+
+static inline pwm_config pwm_get_default_config(void) {
+  pwm_config c = { 0, 1u << 4, 0xffffu };
+  return c;
+}
+
+void pwm_init(uint slice_num, pwm_config * c, bool start);
+void pwm_set_clkdiv(uint slice_num, float divider);
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract);
+void pwm_set_wrap(uint slice_num, uint16_t wrap);
+void pwm_set_counter(uint slice_num, uint16_t c);
+uint16_t pwm_get_counter(uint slice_num);
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level);
+void pwm_set_both_levels(uint slice_num, uint16_t level_a, uint16_t level_b);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+void pwm_set_output_polarity(uint slice_num, bool a, bool b);
+void pwm_set_phase_correct(uint slice_num, bool phase_correct);
+void pwm_set_enabled(uint slice_num, bool enabled);
+void pwm_set_mask_enabled(uint32_t mask);
+void pwm_set_irq_enabled(uint slice_num, bool enabled);
+void pwm_clear_irq(uint slice_num);
+
+#endif
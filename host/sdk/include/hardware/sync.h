@@ -0,0 +1,59 @@
+// Host stand-in for hardware/sync.h. Disabling interrupts only holds off this core's emulated IRQs (see
+// host/sdk/core.c), the spin locks are real locks between the core threads.
+
+#ifndef _HARDWARE_SYNC_H
+#define _HARDWARE_SYNC_H
+
+#include "hardware/address_mapped.h"
+
+typedef volatile uint32_t spin_lock_t;
+
+#define PICO_SPINLOCK_ID_OS1               14
+#define PICO_SPINLOCK_ID_OS2               15
+#define PICO_SPINLOCK_ID_STRIPED_FIRST     16
+#define PICO_SPINLOCK_ID_CLAIM_FREE_FIRST  24
+#define NUM_SPIN_LOCKS                     32
+
+static inline void __dmb(void) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __dsb(void) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __nop(void) {
+}
+
+/**
+ * @brief Sets the event flag of both cores and wakes up the other one
+ */
+void __sev(void);
+
+/**
+ * @brief Waits for (and clears) this core's event flag, or for an IRQ. Can also return early.
+ */
+void __wfe(void);
+
+/**
+ * @brief Waits for an IRQ. Can also return early.
+ */
+void __wfi(void);
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+spin_lock_t * spin_lock_instance(uint lock_num);
+uint spin_lock_get_num(spin_lock_t * lock);
+void spin_lock_claim(uint lock_num);
+int spin_lock_claim_unused(bool required);
+void spin_lock_unclaim(uint lock_num);
+spin_lock_t * spin_lock_init(uint lock_num);
+void spin_locks_reset(void);
+void spin_lock_unsafe_blocking(spin_lock_t * lock);
+void spin_unlock_unsafe(spin_lock_t * lock);
+uint32_t spin_lock_blocking(spin_lock_t * lock);
+void spin_unlock(spin_lock_t * lock, uint32_t saved_irq);
+bool is_spin_locked(spin_lock_t * lock);
+
+#endif
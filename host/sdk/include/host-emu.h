@@ -0,0 +1,60 @@
+// Host build only: looking at (and waiting on) the emulated scanout from tests and benchmarks.
+// See host/sdk/emu.c for how the emulator works.
+
+#ifndef _HOST_EMU_H
+#define _HOST_EMU_H
+
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "pico/platform.h"
+
+typedef struct {
+  uint32_t frames;                                   // Frames the color state machine finished
+  uint32_t irqs[2][NUM_IRQS];                        // IRQ handler entries, per core
+  uint64_t dma_transfers[NUM_DMA_CHANNELS];          // Every transfer, per channel
+  uint64_t dma_blank_transfers[NUM_DMA_CHANNELS];    // The ones while the color state machine was in vertical blanking
+  uint64_t dma_bytes[NUM_DMA_CHANNELS];              // Bytes read, per channel
+  uint32_t pio_stalls;                               // Times the color state machine ran out of pixels
+  uint32_t lockstep_timeouts;                        // IRQs a core didn't get to within PV_HOST_IRQ_TIMEOUT_MS
+  uint32_t pll_changes;                              // set_sys_clock_pll()/set_sys_clock_khz() calls
+  uint32_t pwm_stops;                                // Times a running PWM slice got stopped (disabled or pwm_init())
+} host_stats_t;
+
+/**
+ * @brief Wait for the color state machine to finish frames more frames.
+ *
+ * @return int 0, or 1 if they didn't show up in time (about a second a frame of host time)
+ */
+int host_wait_frames(uint32_t frames);
+
+/**
+ * @brief Wait until a core has nothing left to do: it's sleeping in __wfe()/__wfi() (or it isn't running) with no
+ * IRQs pending or running.
+ *
+ * @return int 0, or 1 on a timeout (5 seconds)
+ */
+int host_wait_idle(uint core);
+
+/**
+ * @brief Copy out the last frame the color state machine finished: every pixel it sent, in order, starting with
+ * the first visible pixel. That's vga_get_width_full() pixels a line (horizontal blanking included, at the scaled
+ * pixel clock) for every line of the base resolution.
+ *
+ * @param pixels Where to put them
+ * @param max Size of pixels
+ * @return uint32_t Number of pixels copied, 0 if there hasn't been a frame yet
+ */
+uint32_t host_get_frame(uint8_t * pixels, uint32_t max);
+
+/**
+ * @brief Write RGB332 pixels out as a binary PPM.
+ *
+ * @param stride Pixels from the start of one line to the next
+ * @return int 0, or 1 if the file couldn't be written
+ */
+int host_write_ppm(const char * path, const uint8_t * pixels, uint16_t width, uint16_t height, uint32_t stride);
+
+void host_get_stats(host_stats_t * stats);
+void host_reset_stats(void);
+
+#endif
@@ -0,0 +1,11 @@
+// Host stand-in for pico/assert.h
+
+#ifndef _PICO_ASSERT_H
+#define _PICO_ASSERT_H
+
+#include <assert.h>
+
+#define invalid_params_if(x, test) assert(!(test))
+#define valid_params_if(x, test)   assert(test)
+
+#endif
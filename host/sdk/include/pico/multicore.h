@@ -0,0 +1,22 @@
+// Host stand-in for pico/multicore.h. Core 1 is a host thread.
+
+#ifndef _PICO_MULTICORE_H
+#define _PICO_MULTICORE_H
+
+#include "pico/platform.h"
+
+void multicore_launch_core1(void (*entry)(void));
+
+/**
+ * @brief Stops core 1 the next time it waits on something (__wfe(), __wfi(), tight_loop_contents(), sleeping)
+ * outside of an IRQ, and resets its IRQ state
+ */
+void multicore_reset_core1(void);
+
+bool multicore_fifo_rvalid(void);
+bool multicore_fifo_wready(void);
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking(void);
+void multicore_fifo_drain(void);
+
+#endif
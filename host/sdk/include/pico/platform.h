@@ -0,0 +1,50 @@
+// Host stand-in for pico/platform.h. Only what libpicovga and its examples use.
+
+#ifndef _PICO_PLATFORM_H
+#define _PICO_PLATFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PICO_ON_DEVICE  0
+#define PICO_NO_HARDWARE 1
+
+typedef unsigned int uint;
+
+#define __packed                               __attribute__((__packed__))
+#define __aligned(x)                           __attribute__((__aligned__(x)))
+#define __not_in_flash(group)                  /* Everything's in RAM */
+#define __not_in_flash_func(func_name)         func_name
+#define __time_critical_func(func_name)        func_name
+#define __no_inline_not_in_flash_func(func_name) __attribute__((noinline)) func_name
+#define __scratch_x(group)                     /* No scratch banks */
+#define __scratch_y(group)
+
+#define __compiler_memory_barrier() __asm__ volatile("" : : : "memory")
+
+#define PICO_LOWEST_IRQ_PRIORITY  0xc0
+#define PICO_HIGHEST_IRQ_PRIORITY 0x00
+#define PICO_DEFAULT_IRQ_PRIORITY 0x80
+
+/**
+ * @brief Core the calling thread is standing in for: 0 for the main thread, 1 for the thread
+ * multicore_launch_core1() starts.
+ */
+uint get_core_num(void);
+
+/**
+ * @brief IRQ number being handled on this core (offset by 16 like the exception number), or 0 in thread mode
+ */
+uint __get_current_exception(void);
+
+/**
+ * @brief Yield the host CPU, every busy wait goes through here
+ */
+void tight_loop_contents(void);
+
+void panic(const char * fmt, ...) __attribute__((noreturn));
+
+#define hard_assert(x) ((void) 0)
+
+#endif
@@ -0,0 +1,15 @@
+// Host stand-in for pico/stdlib.h. Only what libpicovga and its examples use.
+
+#ifndef _PICO_STDLIB_H
+#define _PICO_STDLIB_H
+
+#include "hardware/gpio.h"
+#include "pico/platform.h"
+#include "pico/time.h"
+
+/**
+ * @brief stdio already goes to the host's stdout
+ */
+bool stdio_init_all(void);
+
+#endif
@@ -0,0 +1,563 @@
+// Host build: the PIO blocks, running color.pio.
+//
+// An enabled state machine doesn't execute instructions one by one, it works out what color.pio would do: 2 cycles a
+// pixel through the visible lines (pulling from the TX FIFO, stalling when it's empty), then however long vertical
+// blanking takes, then the next frame. pio_sm_exec() understands the instructions color_program_init() feeds a
+// stopped state machine. Every pixel goes to emu_frame_pixels().
+
+#include "emu.h"
+#include "hardware/pio.h"
+
+#include "color.pio.h"
+
+#include <string.h>
+
+#define FDEBUG_MARKER (1u << 31) // Published in fdebug, so a CPU write to it (write 1 to clear) shows up
+#define FIFO_DEPTH    8          // With the RX FIFO joined on, 4 otherwise
+
+#define CLKDIV_INT_LSB   16
+#define CLKDIV_FRAC_LSB  8
+#define SHIFTCTRL_FJOIN_TX_BITS (1u << 30)
+
+enum phase {
+  PHASE_STOPPED, // Not at a place color.pio can be in
+  PHASE_START,   // About to start the frame (mov x, isr)
+  PHASE_VISIBLE, // Shifting out pixels
+  PHASE_BLANK,   // Counting out vertical blanking
+};
+
+typedef struct {
+  bool enabled;
+  uint offset; // Where color.pio is loaded
+  uint32_t clkdiv;
+  uint32_t shiftctrl;
+  uint32_t execctrl;
+  uint32_t pinctrl;
+
+  uint32_t fifo[FIFO_DEPTH];
+  uint fifo_head;
+  uint fifo_level;
+
+  uint32_t osr;
+  uint osr_count; // Bits shifted out of the OSR, 32 is empty
+  uint32_t isr;
+  uint32_t x;
+  uint32_t y;
+
+  enum phase phase;
+  uint32_t remaining; // Pixels left in the visible lines
+  uint64_t next;      // Next event (ticks), while enabled
+  bool stalled;
+} sm_t;
+
+typedef struct {
+  pio_hw_t * hw;
+  uint32_t shadow_fdebug;
+  uint32_t fdebug;
+  uint32_t used_instructions;
+  uint32_t claimed;
+  sm_t sm[NUM_PIO_STATE_MACHINES];
+} pio_t;
+
+pio_hw_t pio0_hw_inst;
+pio_hw_t pio1_hw_inst;
+
+static pio_t pios[NUM_PIOS] = { { .hw = &pio0_hw_inst }, { .hw = &pio1_hw_inst } };
+
+/************************************
+ * STATIC FUNCTIONS
+ ************************************/
+
+static pio_t * get_pio(PIO pio) {
+  return &pios[pio_get_index(pio)];
+}
+
+static uint fifo_depth(const sm_t * sm) {
+  return sm->shiftctrl & SHIFTCTRL_FJOIN_TX_BITS ? FIFO_DEPTH : FIFO_DEPTH / 2;
+}
+
+static uint64_t ticks_per_cycle(const sm_t * sm) {
+  uint64_t div_int = sm->clkdiv >> CLKDIV_INT_LSB;
+  uint64_t frac    = (sm->clkdiv >> CLKDIV_FRAC_LSB) & 0xff;
+  return (div_int ? div_int : 65536) * TICKS_PER_CYCLE + frac;
+}
+
+static bool fifo_pop(sm_t * sm, uint32_t * data) {
+  if (sm->fifo_level == 0) return false;
+  *data         = sm->fifo[sm->fifo_head];
+  sm->fifo_head = (sm->fifo_head + 1) % FIFO_DEPTH;
+  sm->fifo_level--;
+  return true;
+}
+
+static bool fifo_push(sm_t * sm, uint32_t data) {
+  if (sm->fifo_level >= fifo_depth(sm)) return false;
+  sm->fifo[(sm->fifo_head + sm->fifo_level) % FIFO_DEPTH] = data;
+  sm->fifo_level++;
+  return true;
+}
+
+static void start_frame(sm_t * sm, uint64_t t) {
+  emu_frame_start();
+  sm->x         = sm->isr; // mov x, isr
+  sm->remaining = sm->isr + 1;
+  sm->phase     = PHASE_VISIBLE;
+  sm->next      = t + ticks_per_cycle(sm);
+}
+
+// out pins 8 / jmp x-- visible, for as many pixels as there are in the FIFO
+static void shift_pixels(pio_t * pio, uint n, sm_t * sm, uint64_t t) {
+  uint8_t pixels[FIFO_DEPTH * 4];
+  uint count = 0;
+  while (sm->remaining && count + 4 <= sizeof(pixels)) {
+    if (sm->osr_count >= 32) {
+      if (!fifo_pop(sm, &sm->osr)) break;
+      sm->osr_count = 0;
+    }
+    pixels[count++] = sm->osr & 0xff;
+    sm->osr >>= 8;
+    sm->osr_count += 8;
+    sm->remaining--;
+  }
+
+  if (count == 0) {
+    sm->stalled = true;
+    sm->next    = NEVER;
+    if (!(pio->fdebug & (1u << (PIO_FDEBUG_TXSTALL_LSB + n)))) emu_stats.pio_stalls++;
+    pio->fdebug |= 1u << (PIO_FDEBUG_TXSTALL_LSB + n);
+    return;
+  }
+
+  emu_frame_pixels(pixels, count);
+  sm->x    = sm->remaining - 1;
+  sm->next = t + 2 * count * ticks_per_cycle(sm);
+  if (sm->remaining == 0) {
+    emu_frame_end();
+    sm->x     = sm->y; // mov x, y
+    sm->phase = PHASE_BLANK;
+    sm->next += (1 + 2 * ((uint64_t) sm->y + 1)) * ticks_per_cycle(sm);
+  }
+}
+
+static void jump(sm_t * sm, uint addr) {
+  if (addr == sm->offset) {
+    sm->phase = PHASE_START;
+  } else {
+    sm->phase = PHASE_STOPPED;
+  }
+}
+
+static void set_enabled(sm_t * sm, bool enabled) {
+  if (enabled && !sm->enabled) {
+    sm->stalled = false;
+    sm->next    = emu_now();
+  }
+  sm->enabled = enabled;
+}
+
+static void publish_word(io_rw_32 * reg, uint32_t value) {
+  __atomic_store_n((uint32_t *) reg, value, __ATOMIC_SEQ_CST);
+}
+
+/************************************
+ * EMULATOR FUNCTIONS
+ ************************************/
+
+void pio_sync(void) {
+  for (uint i = 0; i < NUM_PIOS; i++) {
+    pio_t * pio    = &pios[i];
+    uint32_t value = __atomic_load_n(&pio->hw->fdebug, __ATOMIC_SEQ_CST);
+    if (value != pio->shadow_fdebug) {
+      pio->fdebug &= ~(value & ~FDEBUG_MARKER); // Write 1 to clear
+      pio->shadow_fdebug = value;
+    }
+  }
+}
+
+void pio_publish(void) {
+  for (uint i = 0; i < NUM_PIOS; i++) {
+    pio_t * pio     = &pios[i];
+    uint32_t ctrl   = 0;
+    uint32_t fstat  = 0;
+    uint32_t flevel = 0;
+    for (uint n = 0; n < NUM_PIO_STATE_MACHINES; n++) {
+      const sm_t * sm = &pio->sm[n];
+      if (sm->enabled) ctrl |= 1u << n;
+      if (sm->fifo_level == 0) fstat |= 1u << (PIO_FSTAT_TXEMPTY_LSB + n);
+      if (sm->fifo_level >= fifo_depth(sm)) fstat |= 1u << (PIO_FSTAT_TXFULL_LSB + n);
+      flevel |= sm->fifo_level << (n * 8);
+    }
+    publish_word(&pio->hw->ctrl, ctrl);
+    publish_word((io_rw_32 *) &pio->hw->fstat, fstat);
+    publish_word((io_rw_32 *) &pio->hw->flevel, flevel);
+
+    // If the CPU wrote fdebug since the last pio_sync() leave it, it gets picked up then
+    uint32_t expected = pio->shadow_fdebug;
+    if (__atomic_compare_exchange_n((uint32_t *) &pio->hw->fdebug, &expected, pio->fdebug | FDEBUG_MARKER, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+      pio->shadow_fdebug = pio->fdebug | FDEBUG_MARKER;
+    }
+  }
+}
+
+uint64_t pio_next_event(void) {
+  uint64_t next = NEVER;
+  for (uint i = 0; i < NUM_PIOS; i++) {
+    for (uint n = 0; n < NUM_PIO_STATE_MACHINES; n++) {
+      const sm_t * sm = &pios[i].sm[n];
+      if (sm->enabled && sm->phase != PHASE_STOPPED && sm->next < next) next = sm->next;
+    }
+  }
+  return next;
+}
+
+void pio_process(uint64_t now) {
+  for (uint i = 0; i < NUM_PIOS; i++) {
+    for (uint n = 0; n < NUM_PIO_STATE_MACHINES; n++) {
+      sm_t * sm = &pios[i].sm[n];
+      if (!sm->enabled || sm->next > now) continue;
+      switch (sm->phase) {
+        case PHASE_START:
+        case PHASE_BLANK:
+          start_frame(sm, sm->next);
+          break;
+        case PHASE_VISIBLE:
+          shift_pixels(&pios[i], n, sm, sm->next);
+          break;
+        case PHASE_STOPPED:
+          break;
+      }
+    }
+  }
+}
+
+bool pio_txf_push(volatile void * addr, uint32_t value) {
+  for (uint i = 0; i < NUM_PIOS; i++) {
+    pio_t * pio = &pios[i];
+    for (uint n = 0; n < NUM_PIO_STATE_MACHINES; n++) {
+      if (addr != (volatile void *) &pio->hw->txf[n]) continue;
+      sm_t * sm = &pio->sm[n];
+      if (!fifo_push(sm, value)) {
+        pio->fdebug |= 1u << (PIO_FDEBUG_TXOVER_LSB + n);
+      } else if (sm->stalled) {
+        sm->stalled = false;
+        sm->next    = emu_now();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool pio_dreq_ready(uint dreq) {
+  uint n = dreq % 8;
+  if (dreq / 8 >= NUM_PIOS || n >= NUM_PIO_STATE_MACHINES) return false; // RX FIFOs never have anything in them
+  const sm_t * sm = &pios[dreq / 8].sm[n];
+  return sm->fifo_level < fifo_depth(sm);
+}
+
+bool pio_in_vblank(void) {
+  for (uint i = 0; i < NUM_PIOS; i++) {
+    for (uint n = 0; n < NUM_PIO_STATE_MACHINES; n++) {
+      const sm_t * sm = &pios[i].sm[n];
+      if (sm->enabled && sm->phase == PHASE_BLANK) return true;
+    }
+  }
+  return false;
+}
+
+/************************************
+ * PICO-SDK FUNCTIONS
+ ************************************/
+
+pio_sm_config pio_get_default_sm_config(void) {
+  pio_sm_config c = { 0 };
+  sm_config_set_clkdiv_int_frac(&c, 1, 0);
+  sm_config_set_wrap(&c, 0, 31);
+  sm_config_set_in_shift(&c, true, false, 32);
+  sm_config_set_out_shift(&c, true, false, 32);
+  return c;
+}
+
+void sm_config_set_out_pins(pio_sm_config * c, uint out_base, uint out_count) {
+  c->pinctrl = (c->pinctrl & ~0x03f0001fu) | out_base | (out_count << 20);
+}
+
+void sm_config_set_set_pins(pio_sm_config * c, uint set_base, uint set_count) {
+  c->pinctrl = (c->pinctrl & ~0x1c0003e0u) | (set_base << 5) | (set_count << 26);
+}
+
+void sm_config_set_in_pins(pio_sm_config * c, uint in_base) {
+  c->pinctrl = (c->pinctrl & ~0x000f8000u) | (in_base << 15);
+}
+
+void sm_config_set_sideset_pins(pio_sm_config * c, uint sideset_base) {
+  c->pinctrl = (c->pinctrl & ~0x00007c00u) | (sideset_base << 10);
+}
+
+void sm_config_set_clkdiv_int_frac(pio_sm_config * c, uint16_t div_int, uint8_t div_frac) {
+  c->clkdiv = ((uint32_t) div_int << CLKDIV_INT_LSB) | ((uint32_t) div_frac << CLKDIV_FRAC_LSB);
+}
+
+void sm_config_set_clkdiv(pio_sm_config * c, float div) {
+  uint16_t div_int = (uint16_t) div;
+  sm_config_set_clkdiv_int_frac(c, div_int, (uint8_t) ((div - div_int) * 256));
+}
+
+void sm_config_set_wrap(pio_sm_config * c, uint wrap_target, uint wrap) {
+  c->execctrl = (c->execctrl & ~0x0001ff80u) | (wrap_target << 7) | (wrap << 12);
+}
+
+void sm_config_set_out_shift(pio_sm_config * c, bool shift_right, bool autopull, uint pull_threshold) {
+  c->shiftctrl = (c->shiftctrl & ~0x3e0a0000u) | (shift_right ? 1u << 19 : 0) | (autopull ? 1u << 17 : 0) | ((pull_threshold & 0x1fu) << 25);
+}
+
+void sm_config_set_in_shift(pio_sm_config * c, bool shift_right, bool autopush, uint push_threshold) {
+  c->shiftctrl = (c->shiftctrl & ~0x01f50000u) | (shift_right ? 1u << 18 : 0) | (autopush ? 1u << 16 : 0) | ((push_threshold & 0x1fu) << 20);
+}
+
+void sm_config_set_fifo_join(pio_sm_config * c, enum pio_fifo_join join) {
+  c->shiftctrl = (c->shiftctrl & ~0xc0000000u) | ((uint32_t) join << 30);
+}
+
+uint pio_get_index(PIO pio) {
+  return pio == pio1 ? 1 : 0;
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+  return pio_get_index(pio) * 8 + sm + (is_tx ? 0 : 4);
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+}
+
+static int find_offset(pio_t * pio, const pio_program_t * program) {
+  uint32_t mask = (1u << program->length) - 1;
+  if (program->origin >= 0) {
+    return pio->used_instructions & (mask << program->origin) ? -1 : program->origin;
+  }
+  for (int offset = PIO_INSTRUCTION_COUNT - program->length; offset >= 0; offset--) {
+    if (!(pio->used_instructions & (mask << offset))) return offset;
+  }
+  return -1;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t * program) {
+  bus_lock();
+  bool can = find_offset(get_pio(pio), program) >= 0;
+  bus_unlock();
+  return can;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t * program) {
+  bus_lock();
+  pio_t * p  = get_pio(pio);
+  int offset = find_offset(p, program);
+  if (offset < 0) panic("No program space");
+  for (uint i = 0; i < program->length; i++) {
+    pio->instr_mem[offset + i] = program->instructions[i];
+  }
+  p->used_instructions |= ((1u << program->length) - 1) << offset;
+  bus_unlock();
+  return offset;
+}
+
+void pio_remove_program(PIO pio, const pio_program_t * program, uint loaded_offset) {
+  bus_lock();
+  get_pio(pio)->used_instructions &= ~(((1u << program->length) - 1) << loaded_offset);
+  bus_unlock();
+}
+
+void pio_clear_instruction_memory(PIO pio) {
+  bus_lock();
+  get_pio(pio)->used_instructions = 0;
+  bus_unlock();
+}
+
+void pio_sm_claim(PIO pio, uint sm) {
+  pio_t * p = get_pio(pio);
+  if (p->claimed & (1u << sm)) panic("PIO %u state machine %u is already claimed", pio_get_index(pio), sm);
+  p->claimed |= 1u << sm;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+  pio_t * p = get_pio(pio);
+  for (uint n = 0; n < NUM_PIO_STATE_MACHINES; n++) {
+    if (!(p->claimed & (1u << n))) {
+      p->claimed |= 1u << n;
+      return n;
+    }
+  }
+  if (required) panic("No PIO state machines are available");
+  return -1;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm) {
+  get_pio(pio)->claimed &= ~(1u << sm);
+}
+
+bool pio_sm_is_claimed(PIO pio, uint sm) {
+  return get_pio(pio)->claimed & (1u << sm);
+}
+
+void pio_sm_set_config(PIO pio, uint sm, const pio_sm_config * config) {
+  bus_lock();
+  sm_t * s     = &get_pio(pio)->sm[sm];
+  s->clkdiv    = config->clkdiv;
+  s->execctrl  = config->execctrl;
+  s->shiftctrl = config->shiftctrl;
+  s->pinctrl   = config->pinctrl;
+  bus_unlock();
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config * config) {
+  bus_lock();
+  sm_t * s = &get_pio(pio)->sm[sm];
+  set_enabled(s, false);
+  pio_sm_set_config(pio, sm, config);
+  s->fifo_head  = 0;
+  s->fifo_level = 0;
+  s->osr        = 0;
+  s->osr_count  = 32;
+  s->isr        = 0;
+  s->x          = 0;
+  s->y          = 0;
+  s->offset     = initial_pc;
+  jump(s, initial_pc);
+  bus_unlock();
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+  bus_lock();
+  set_enabled(&get_pio(pio)->sm[sm], enabled);
+  bus_unlock();
+}
+
+void pio_set_sm_mask_enabled(PIO pio, uint32_t mask, bool enabled) {
+  bus_lock();
+  for (uint n = 0; n < NUM_PIO_STATE_MACHINES; n++) {
+    if (mask & (1u << n)) set_enabled(&get_pio(pio)->sm[n], enabled);
+  }
+  bus_unlock();
+}
+
+void pio_enable_sm_mask_in_sync(PIO pio, uint32_t mask) {
+  pio_set_sm_mask_enabled(pio, mask, true); // Clock dividers restart when they're enabled here anyway
+}
+
+void pio_sm_restart(PIO pio, uint sm) {
+  bus_lock();
+  sm_t * s     = &get_pio(pio)->sm[sm];
+  s->osr_count = 32;
+  s->stalled   = false;
+  bus_unlock();
+}
+
+void pio_sm_clkdiv_restart(PIO pio, uint sm) {
+}
+
+void pio_sm_set_clkdiv_int_frac(PIO pio, uint sm, uint16_t div_int, uint8_t div_frac) {
+  bus_lock();
+  get_pio(pio)->sm[sm].clkdiv = ((uint32_t) div_int << CLKDIV_INT_LSB) | ((uint32_t) div_frac << CLKDIV_FRAC_LSB);
+  bus_unlock();
+}
+
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div) {
+  uint16_t div_int = (uint16_t) div;
+  pio_sm_set_clkdiv_int_frac(pio, sm, div_int, (uint8_t) ((div - div_int) * 256));
+}
+
+void pio_sm_set_pins(PIO pio, uint sm, uint32_t pin_values) {
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask) {
+}
+
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask) {
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {
+}
+
+static uint32_t * reg(sm_t * sm, uint index) {
+  switch (index) {
+    case 1: return &sm->x;
+    case 2: return &sm->y;
+    case 6: return &sm->isr;
+    case 7: return &sm->osr;
+    default: return NULL;
+  }
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+  bus_lock();
+  sm_t * s   = &get_pio(pio)->sm[sm];
+  uint dest  = (instr >> 5) & 7u;
+  uint32_t * d = reg(s, dest);
+  switch (instr & 0xe000u) {
+    case 0x0000u: // jmp (unconditional only)
+      jump(s, instr & 0x1fu);
+      break;
+    case 0x6000u: { // out
+      uint count = instr & 0x1fu ? instr & 0x1fu : 32;
+      uint32_t value = count == 32 ? s->osr : s->osr & ((1u << count) - 1);
+      s->osr = count == 32 ? 0 : s->osr >> count;
+      s->osr_count += count;
+      if (s->osr_count > 32) s->osr_count = 32;
+      if (d) *d = value;
+      break;
+    }
+    case 0x8000u: // pull
+      if (instr & 0x80u && fifo_pop(s, &s->osr)) s->osr_count = 0;
+      break;
+    case 0xa000u: { // mov
+      uint32_t * src = reg(s, instr & 7u);
+      if (d) *d = src ? *src : 0;
+      if (dest == 7) s->osr_count = 0;
+      break;
+    }
+    default:
+      panic("pio_sm_exec(): instruction %04x isn't emulated", instr);
+  }
+  bus_unlock();
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data) {
+  bus_lock();
+  pio_txf_push(&pio->txf[sm], data);
+  bus_unlock();
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+  while (pio_sm_is_tx_fifo_full(pio, sm)) {
+    tight_loop_contents();
+  }
+  pio_sm_put(pio, sm, data);
+}
+
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm) {
+  bus_lock();
+  uint level = get_pio(pio)->sm[sm].fifo_level;
+  bus_unlock();
+  return level;
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm) {
+  bus_lock();
+  bool full = get_pio(pio)->sm[sm].fifo_level >= fifo_depth(&get_pio(pio)->sm[sm]);
+  bus_unlock();
+  return full;
+}
+
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm) {
+  return pio_sm_get_tx_fifo_level(pio, sm) == 0;
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+  bus_lock();
+  get_pio(pio)->sm[sm].fifo_level = 0;
+  bus_unlock();
+}
+
+void pio_sm_drain_tx_fifo(PIO pio, uint sm) {
+  pio_sm_clear_fifos(pio, sm);
+}
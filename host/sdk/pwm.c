@@ -0,0 +1,203 @@
+// Host build: the PWM slices.
+//
+// A counter is never stepped, it's worked out from emulated time whenever something asks for it. The only events are
+// wraps of slices a DMA channel is waiting on (DREQ_PWM_WRAP0 + slice).
+
+#include "emu.h"
+#include "hardware/pwm.h"
+
+typedef struct {
+  bool enabled;
+  uint32_t top;
+  uint32_t div;     // 8.4 fixed point
+  uint32_t counter; // At ref
+  uint64_t ref;     // Ticks
+  uint64_t next_wrap;
+  uint16_t level[2];
+  bool inverted[2];
+} slice_t;
+
+static slice_t slices[NUM_PWM_SLICES];
+static pwm_hw_t pwm_hw_inst;
+pwm_hw_t * const pwm_hw = &pwm_hw_inst;
+
+/************************************
+ * STATIC FUNCTIONS
+ ************************************/
+
+// Ticks per count
+static uint64_t period(const slice_t * s) {
+  uint64_t div = s->div >> 4 ? s->div : s->div + (256u << 4); // An integer part of 0 is 256
+  return div * TICKS_PER_CYCLE / 16;
+}
+
+static uint32_t counter(const slice_t * s, uint64_t now) {
+  if (!s->enabled) return s->counter;
+  return (s->counter + (now - s->ref) / period(s)) % (s->top + 1);
+}
+
+// Call before changing a slice: the counter carries on from where it is now
+static void rebase(slice_t * s) {
+  uint64_t now = emu_now();
+  if (s->enabled) {
+    uint64_t p = period(s);
+    s->counter = counter(s, now);
+    s->ref     = now - (now - s->ref) % p; // Keep the part of a count that's already gone by
+  } else {
+    s->ref = now;
+  }
+}
+
+// Call after changing a slice
+static void reschedule(slice_t * s) {
+  if (s->counter > s->top) s->counter = 0;
+  s->next_wrap = s->ref + (uint64_t) (s->top + 1 - s->counter) * period(s);
+  emu_wake();
+}
+
+static void publish_enabled(void) {
+  uint32_t en = 0;
+  for (uint n = 0; n < NUM_PWM_SLICES; n++) {
+    if (slices[n].enabled) en |= 1u << n;
+  }
+  __atomic_store_n((uint32_t *) &pwm_hw_inst.en, en, __ATOMIC_SEQ_CST);
+}
+
+/************************************
+ * EMULATOR FUNCTIONS
+ ************************************/
+
+uint64_t pwm_next_event(void) {
+  uint64_t now  = emu_now();
+  uint64_t next = NEVER;
+  for (uint n = 0; n < NUM_PWM_SLICES; n++) {
+    slice_t * s = &slices[n];
+    if (!s->enabled) continue;
+    if (s->next_wrap < now) {
+      // Wraps nothing was waiting on, skip them so a DMA channel that starts waiting now doesn't get them
+      uint64_t wrap = (uint64_t) (s->top + 1) * period(s);
+      s->next_wrap += ((now - s->next_wrap) / wrap + 1) * wrap;
+    }
+    if (s->next_wrap < next && dma_dreq_wanted(pwm_get_dreq(n))) next = s->next_wrap;
+  }
+  return next;
+}
+
+void pwm_process(uint64_t now) {
+  for (uint n = 0; n < NUM_PWM_SLICES; n++) {
+    slice_t * s = &slices[n];
+    if (!s->enabled) continue;
+    while (s->next_wrap <= now) {
+      dma_dreq_pulse(pwm_get_dreq(n));
+      s->next_wrap += (uint64_t) (s->top + 1) * period(s);
+    }
+  }
+}
+
+/************************************
+ * PICO-SDK FUNCTIONS
+ ************************************/
+
+void pwm_init(uint slice_num, pwm_config * c, bool start) {
+  bus_lock();
+  slice_t * s  = &slices[slice_num];
+  if (s->enabled) emu_stats.pwm_stops++;
+  s->enabled   = false;
+  s->top       = c->top;
+  s->div       = c->div;
+  s->counter   = 0;
+  s->level[0]  = 0;
+  s->level[1]  = 0;
+  rebase(s);
+  pwm_set_enabled(slice_num, start);
+  bus_unlock();
+}
+
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract) {
+  bus_lock();
+  slice_t * s = &slices[slice_num];
+  rebase(s);
+  s->div = ((uint32_t) integer << 4) | (fract & 0xfu);
+  reschedule(s);
+  bus_unlock();
+}
+
+void pwm_set_clkdiv(uint slice_num, float divider) {
+  uint8_t integer = (uint8_t) divider;
+  pwm_set_clkdiv_int_frac(slice_num, integer, (uint8_t) ((divider - integer) * 16));
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap) {
+  bus_lock();
+  slice_t * s = &slices[slice_num];
+  rebase(s);
+  s->top = wrap;
+  reschedule(s);
+  bus_unlock();
+}
+
+void pwm_set_counter(uint slice_num, uint16_t c) {
+  bus_lock();
+  slice_t * s = &slices[slice_num];
+  rebase(s);
+  s->counter = c;
+  reschedule(s);
+  bus_unlock();
+}
+
+uint16_t pwm_get_counter(uint slice_num) {
+  bus_lock();
+  uint16_t c = counter(&slices[slice_num], emu_now());
+  bus_unlock();
+  return c;
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level) {
+  slices[slice_num].level[chan] = level;
+}
+
+void pwm_set_both_levels(uint slice_num, uint16_t level_a, uint16_t level_b) {
+  slices[slice_num].level[0] = level_a;
+  slices[slice_num].level[1] = level_b;
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level) {
+  pwm_set_chan_level(pwm_gpio_to_slice_num(gpio), pwm_gpio_to_channel(gpio), level);
+}
+
+void pwm_set_output_polarity(uint slice_num, bool a, bool b) {
+  slices[slice_num].inverted[0] = a;
+  slices[slice_num].inverted[1] = b;
+}
+
+void pwm_set_phase_correct(uint slice_num, bool phase_correct) {
+  if (phase_correct) panic("Phase correct PWM isn't emulated");
+}
+
+void pwm_set_mask_enabled(uint32_t mask) {
+  bus_lock();
+  for (uint n = 0; n < NUM_PWM_SLICES; n++) {
+    slice_t * s  = &slices[n];
+    bool enabled = mask & (1u << n);
+    if (enabled == s->enabled) continue;
+    if (!enabled) emu_stats.pwm_stops++;
+    rebase(s);
+    s->enabled = enabled;
+    reschedule(s);
+  }
+  publish_enabled();
+  bus_unlock();
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled) {
+  bus_lock();
+  uint32_t mask = pwm_hw->en;
+  pwm_set_mask_enabled(enabled ? mask | (1u << slice_num) : mask & ~(1u << slice_num));
+  bus_unlock();
+}
+
+void pwm_set_irq_enabled(uint slice_num, bool enabled) {
+}
+
+void pwm_clear_irq(uint slice_num) {
+}
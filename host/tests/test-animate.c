@@ -0,0 +1,74 @@
+// animate() in AutoRender: only items with an animate() function get called, once a frame even while nothing is being
+// redrawn, and an animate() function that changes its item and sets flags.update by hand (instead of calling
+// draw_mark_updated()) still gets it redrawn.
+
+#include "test.h"
+
+#include <string.h>
+
+#define RENDER_QUEUE_LEN 3
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+vga_config_t display_conf = {
+  .pio                    = pio0,
+  .base_resolution        = RES_640x480,
+  .scaled_resolution      = RES_SCALED_320x240,
+  .render_queue           = render_queue,
+  .render_queue_len       = RENDER_QUEUE_LEN,
+  .auto_render            = true,
+  .num_interpolated_lines = 4,
+};
+
+#define MOVE_TO 40
+
+static volatile uint32_t moves = 0, idles = 0;
+
+// Walks right a pixel a frame until it gets to MOVE_TO, the old way
+static void move(struct vga_render_item_t * p) {
+  vga_render_item_t * item = (vga_render_item_t *) p;
+  moves++;
+  if (item->item_2d.x < MOVE_TO) {
+    item->item_2d.x++;
+    item->header.flags.update = true;
+  }
+}
+
+static void idle(struct vga_render_item_t * p) {
+  idles++;
+}
+
+int main() {
+  CHECK_EQ(vga_init(&display_conf), 0);
+
+  draw2d_pixel(&render_queue[0], 5, 5, COLOR_RED);
+  render_queue[1].animate = move;
+  draw2d_pixel(&render_queue[1], 10, 10, COLOR_GREEN);
+  render_queue[2].animate = idle;
+  draw2d_rectangle_filled(&render_queue[2], 100, 100, 120, 120, COLOR_BLUE);
+
+  // Should get there in about MOVE_TO - 10 frames, give it a few more
+  CHECK_EQ(host_wait_frames(MOVE_TO - 10 + 10), 0);
+  CHECK_EQ(render_queue[1].item_2d.x, MOVE_TO);
+  uint8_t * frame = test_capture();
+  CHECK(frame != NULL);
+  if (frame) {
+    test_dump("animate", frame);
+    CHECK_EQ(test_screen_row(frame, 10)[MOVE_TO], COLOR_GREEN);
+    CHECK_EQ(test_screen_row(frame, 10)[10], COLOR_BLACK);
+    CHECK_EQ(test_screen_row(frame, 5)[5], COLOR_RED);
+  }
+
+  // Nothing changes anymore: both still get called every frame, without any more render() passes
+  vga_render_profile_t before, after;
+  uint32_t moves_before = moves, idles_before = idles;
+  vga_get_render_profile(&before);
+  CHECK_EQ(host_wait_frames(10), 0);
+  vga_get_render_profile(&after);
+  fprintf(stderr, "%u moves, %u idles in 10 frames, %u passes\n", moves - moves_before, idles - idles_before, after.passes - before.passes);
+  CHECK(moves - moves_before >= 8 && moves - moves_before <= 12);
+  CHECK(idles - idles_before >= 8 && idles - idles_before <= 12);
+  CHECK_EQ(after.passes, before.passes);
+
+  CHECK_EQ(vga_deinit(&display_conf), 0);
+  return TEST_RESULT();
+}
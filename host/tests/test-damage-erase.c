@@ -0,0 +1,125 @@
+// Moving or hiding an item only redraws the area it was in and the area it's in now (its bounding boxes), so anything
+// a rasterizer draws outside its item's bounding box is left behind on the screen. For every 2D item type: move it,
+// and the screen has to match a full redraw, hide it, and the screen has to go black. The last few types move off the
+// edges of the screen, where the rasterizers have to clip instead of wrapping around.
+
+#include "test.h"
+
+#include <string.h>
+
+#define RENDER_QUEUE_LEN 1
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+static uint16_t polygon_points[2][5][2];
+static vga_color_t sprite[8 * 8];
+static char string[] = "Hello";
+
+// pos picks which copy of the points array the polygon uses
+static void draw_polygon(vga_render_item_t * item, bool filled, uint16_t x, uint16_t y, int pos) {
+  const uint16_t shape[5][2] = { { 10, 30 }, { 40, 10 }, { 80, 25 }, { 60, 60 }, { 20, 55 } };
+  for (int i = 0; i < 5; i++) {
+    polygon_points[pos][i][POINT_X] = shape[i][POINT_X] + x;
+    polygon_points[pos][i][POINT_Y] = shape[i][POINT_Y] + y;
+  }
+  if (filled) {
+    draw2d_polygon_filled(item, polygon_points[pos], 5, COLOR_WHITE);
+  } else {
+    draw2d_polygon(item, polygon_points[pos], 5, COLOR_WHITE);
+  }
+}
+
+// Draw the item for type t, moved by (dx, dy) (the other way for the circles going off the top left)
+static void draw(vga_render_item_t * item, int t, uint16_t dx, uint16_t dy, int pos) {
+  switch (t) {
+    case 0: draw2d_pixel(item, 10 + dx, 10 + dy, COLOR_WHITE); break;
+    case 1: draw2d_line(item, 10 + dx, 40 + dy, 70 + dx, 12 + dy, COLOR_WHITE); break;
+    case 2: draw2d_rectangle(item, 10 + dx, 10 + dy, 60 + dx, 40 + dy, COLOR_WHITE); break;
+    case 3: draw2d_rectangle_filled(item, 10 + dx, 10 + dy, 60 + dx, 40 + dy, COLOR_WHITE); break;
+    case 4: draw2d_triangle(item, 10 + dx, 50 + dy, 40 + dx, 10 + dy, 90 + dx, 35 + dy, COLOR_WHITE); break;
+    case 5: draw2d_triangle_filled(item, 10 + dx, 50 + dy, 40 + dx, 10 + dy, 90 + dx, 35 + dy, COLOR_WHITE); break;
+    case 6: draw2d_triangle_filled(item, 90 + dx, 10 + dy, 11 + dx, 30 + dy, 50 + dx, 60 + dy, COLOR_WHITE); break;
+    case 7: draw2d_circle(item, 40 + dx, 40 + dy, 25, COLOR_WHITE); break;
+    case 8: draw2d_circle_filled(item, 40 + dx, 40 + dy, 25, COLOR_WHITE); break;
+    case 9: draw_polygon(item, false, dx, dy, pos); break;
+    case 10: draw_polygon(item, true, dx, dy, pos); break;
+    case 11: draw2d_text(item, 10 + dx, 10 + dy, 200, string, COLOR_WHITE, false); break;
+    case 12: draw2d_sprite(item, 10 + dx, 10 + dy, sprite, 8, 8, COLOR_BLACK); break;
+    // Circles moving up and left, off the left edge and the top left corner
+    case 13: draw2d_circle(item, 42 - dx, 121 - dy, 20, COLOR_WHITE); break;
+    case 14: draw2d_circle_filled(item, 42 - dx, 121 - dy, 20, COLOR_WHITE); break;
+    case 15: draw2d_circle_filled(item, 42 - dx, 31 - dy, 20, COLOR_WHITE); break;
+    // The rest off the right and bottom edges (320x240)
+    case 16: draw2d_triangle(item, 250 + dx, 200 + dy, 280 + dx, 160 + dy, 310 + dx, 215 + dy, COLOR_WHITE); break;
+    case 17: draw2d_triangle_filled(item, 250 + dx, 200 + dy, 280 + dx, 160 + dy, 310 + dx, 215 + dy, COLOR_WHITE); break;
+    case 18: draw_polygon(item, false, 240 + dx, 170 + dy, pos); break;
+    case 19: draw_polygon(item, true, 240 + dx, 170 + dy, pos); break;
+  }
+}
+#define NUM_TYPES 20
+
+static uint8_t * copy_screen(const uint8_t * frame) {
+  uint16_t width = vga_get_width(), height = vga_get_height();
+  uint8_t * screen = malloc((uint32_t) width * height);
+  for (uint16_t y = 0; y < height; y++) memcpy(screen + (uint32_t) y * width, test_screen_row(frame, y), width);
+  return screen;
+}
+
+// Number of pixels that differ, printing the first one
+static uint32_t compare(const uint8_t * a, const uint8_t * b, const char * what, int t) {
+  uint16_t width = vga_get_width(), height = vga_get_height();
+  uint32_t diff  = 0;
+  for (uint32_t p = 0; p < (uint32_t) width * height; p++) {
+    if (a[p] == b[p]) continue;
+    if (!diff) fprintf(stderr, "type %d %s: pixel %u,%u is %02x, should be %02x\n", t, what, p % width, p / width, a[p], b[p]);
+    diff++;
+  }
+  return diff;
+}
+
+int main() {
+  for (int i = 0; i < 8 * 8; i++) sprite[i] = i % 5 ? COLOR_RED : COLOR_BLACK;
+
+  for (int binned = 0; binned < 2; binned++) {
+    vga_config_t config = {
+      .pio                    = pio0,
+      .base_resolution        = RES_640x480,
+      .scaled_resolution      = RES_SCALED_320x240,
+      .render_queue           = render_queue,
+      .render_queue_len       = RENDER_QUEUE_LEN,
+      .auto_render            = true,
+      .binned_render          = binned,
+      .num_interpolated_lines = 4,
+    };
+    memset(render_queue, 0, sizeof(render_queue));
+    CHECK_EQ(vga_init(&config), 0);
+    uint8_t * black = calloc((uint32_t) vga_get_width() * vga_get_height(), 1);
+
+    for (int t = 0; t < NUM_TYPES; t++) {
+      draw(&render_queue[0], t, 0, 0, 0);
+      CHECK(test_capture() != NULL);
+
+      // Partly overlapping the old spot, so the two damaged areas get merged too
+      draw(&render_queue[0], t, 37, 21, 1);
+      uint8_t * frame = test_capture();
+      CHECK(frame != NULL);
+      if (!frame) break;
+      uint8_t * moved = copy_screen(frame);
+
+      vga_refresh();
+      uint8_t * redrawn = copy_screen(test_capture());
+      CHECK_EQ(compare(moved, redrawn, "moved", t), 0);
+
+      draw_set_shown(&render_queue[0], false);
+      uint8_t * hidden = copy_screen(test_capture());
+      CHECK_EQ(compare(hidden, black, "hidden", t), 0);
+
+      free(moved);
+      free(redrawn);
+      free(hidden);
+    }
+
+    free(black);
+    CHECK_EQ(vga_deinit(&config), 0);
+  }
+  return TEST_RESULT();
+}
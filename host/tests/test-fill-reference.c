@@ -0,0 +1,142 @@
+// Filled triangles and polygons go through render_fill_span() a row at a time. Every span has to be the right one:
+// triangles are checked pixel for pixel against the slope formula worked out longhand, polygons (no single right
+// answer for their edges) have to stay inside their bounding box, cover their vertices and come out as one run per
+// row when they're convex.
+
+#include "test.h"
+
+#include <string.h>
+
+#define RENDER_QUEUE_LEN 1
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+vga_config_t display_conf = {
+  .pio                    = pio0,
+  .base_resolution        = RES_640x480,
+  .scaled_resolution      = RES_SCALED_320x240,
+  .render_queue           = render_queue,
+  .render_queue_len       = RENDER_QUEUE_LEN,
+  .auto_render            = false, // Straight from the rasterizers into the framebuffer
+  .num_interpolated_lines = 4,
+};
+
+#define NUM_TRIANGLES 40
+
+static uint8_t * draw_and_capture(void) {
+  vga_refresh();
+  return test_capture();
+}
+
+// Where row y of the triangle starts and ends, longhand (see render2d_triangle_filled())
+static void triangle_row(int32_t x[3], int32_t y[3], int32_t row, int32_t * a, int32_t * b) {
+  if (y[0] == y[2]) {
+    *a = MIN(x[0], MIN(x[1], x[2]));
+    *b = MAX(x[0], MAX(x[1], x[2]));
+    return;
+  }
+  bool upper = y[1] == y[2] ? row <= y[1] : row < y[1];
+  if (upper) {
+    *a = x[0] + (x[1] - x[0]) * (row - y[0]) / (y[1] - y[0]);
+  } else {
+    *a = x[1] + (x[2] - x[1]) * (row - y[1]) / (y[2] - y[1]);
+  }
+  *b = x[0] + (x[2] - x[0]) * (row - y[0]) / (y[2] - y[0]);
+  if (*a > *b) SWAP(*a, *b);
+}
+
+static void check_triangle(int n, int32_t x[3], int32_t y[3]) {
+  draw2d_triangle_filled(&render_queue[0], x[0], y[0], x[1], y[1], x[2], y[2], COLOR_WHITE);
+  uint8_t * frame = draw_and_capture();
+  CHECK(frame != NULL);
+  if (!frame) return;
+
+  // Sorted by y for the reference, the same way the rasterizer does it
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2 - i; j++) {
+      if (y[j] > y[j + 1]) {
+        SWAP(y[j], y[j + 1]);
+        SWAP(x[j], x[j + 1]);
+      }
+    }
+  }
+
+  uint32_t wrong = 0;
+  for (int32_t row = 0; row < vga_get_height(); row++) {
+    int32_t a = 1, b = 0;
+    if (row >= y[0] && row <= y[2]) triangle_row(x, y, row, &a, &b);
+    const uint8_t * pixels = test_screen_row(frame, row);
+    for (int32_t col = 0; col < vga_get_width(); col++) {
+      bool lit = pixels[col] == COLOR_WHITE;
+      if (lit != (col >= a && col <= b)) {
+        if (!wrong) fprintf(stderr, "triangle %d: pixel %d,%d is %s\n", n, col, row, lit ? "lit" : "missing");
+        wrong++;
+      }
+    }
+  }
+  CHECK_EQ(wrong, 0);
+}
+
+static void check_polygon(int n, uint16_t points[][2], uint16_t num_points) {
+  draw2d_polygon_filled(&render_queue[0], points, num_points, COLOR_WHITE);
+  uint8_t * frame = draw_and_capture();
+  CHECK(frame != NULL);
+  if (!frame) return;
+
+  vga_rect_t bbox = render_queue[0].bbox;
+  for (int32_t row = 0; row < vga_get_height(); row++) {
+    const uint8_t * pixels = test_screen_row(frame, row);
+    uint32_t runs          = 0;
+    for (int32_t col = 0; col < vga_get_width(); col++) {
+      if (pixels[col] != COLOR_WHITE) continue;
+      runs += col == 0 || pixels[col - 1] != COLOR_WHITE;
+      if (col < bbox.x1 || col > bbox.x2 || row < bbox.y1 || row > bbox.y2) {
+        fprintf(stderr, "polygon %d: pixel %d,%d is outside the bounding box\n", n, col, row);
+        CHECK(false);
+      }
+    }
+    if (row >= bbox.y1 && row <= bbox.y2) CHECK_EQ(runs, 1);
+  }
+  for (int i = 0; i < num_points; i++) {
+    CHECK_EQ(test_screen_row(frame, points[i][POINT_Y])[points[i][POINT_X]], COLOR_WHITE);
+  }
+}
+
+int main() {
+  CHECK_EQ(vga_init(&display_conf), 0);
+  uint16_t width = vga_get_width(), height = vga_get_height();
+
+  // Flat tops and bottoms, a single row and a single point, then random ones
+  int32_t fixed[][6] = {
+    { 10, 10, 200, 10, 100, 150 }, { 10, 150, 200, 150, 100, 10 }, { 5, 20, 300, 20, 150, 20 },
+    { 50, 50, 50, 50, 50, 50 },    { 1, 2, 318, 119, 3, 237 },     { 0, 0, 319, 239, 0, 239 },
+  };
+  int n = 0;
+  for (; n < sizeof(fixed) / sizeof(fixed[0]); n++) {
+    int32_t x[3] = { fixed[n][0], fixed[n][2], fixed[n][4] }, y[3] = { fixed[n][1], fixed[n][3], fixed[n][5] };
+    check_triangle(n, x, y);
+  }
+  srand(1);
+  for (; n < NUM_TRIANGLES; n++) {
+    int32_t x[3], y[3];
+    for (int i = 0; i < 3; i++) {
+      x[i] = rand() % width;
+      y[i] = rand() % height;
+    }
+    check_triangle(n, x, y);
+  }
+
+  // Regular-ish convex polygons, 3 to 8 sides, at odd positions so the rows don't start word aligned
+  static uint16_t points[8][2];
+  for (int sides = 3; sides <= 8; sides++) {
+    static const int8_t circle[8][2] = { { 10, 0 }, { 7, 7 }, { 0, 10 }, { -7, 7 }, { -10, 0 }, { -7, -7 }, { 0, -10 }, { 7, -7 } };
+    for (int i = 0; i < sides; i++) {
+      const int8_t * p    = circle[i * 8 / sides];
+      points[i][POINT_X] = 101 + sides + p[0] * 9;
+      points[i][POINT_Y] = 117 + p[1] * 9;
+    }
+    check_polygon(sides, points, sides);
+  }
+
+  CHECK_EQ(vga_deinit(&display_conf), 0);
+  return TEST_RESULT();
+}
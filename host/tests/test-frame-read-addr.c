@@ -0,0 +1,133 @@
+// build_frame_read_addr(): every base resolution at every scale, with and without line interpolation. The table has to
+// repeat every row over a run of lines, hand out the buffered lines in order and spread the interpolated lines evenly
+// through the frame, and the scanout has to show the right thing without ever reading an interpolated line before the
+// renderer got to it.
+
+#include "test.h"
+
+#include <string.h>
+
+#define RENDER_QUEUE_LEN 10
+#define NUM_BANDS        8
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+static const vga_color_t band_colors[NUM_BANDS] = { COLOR_RED, COLOR_LIME, COLOR_BLUE, COLOR_YELLOW, COLOR_CYAN, COLOR_MAGENTA, COLOR_WHITE, COLOR_GRAY };
+static const vga_resolution_scaled_t scales[]   = { 1, 2, 4, 8 };
+
+static void check_table(const vga_config_t * config) {
+  uint8_t ** table  = __vga_get_frame_read_addr();
+  uint8_t * ring    = __vga_get_interp_ring();
+  uint16_t width    = vga_get_width();
+  uint16_t height   = vga_get_height();
+  uint16_t lines    = __vga_get_row_line(height);
+  uint32_t ring_len = (uint32_t) config->num_interpolated_lines * width;
+
+  CHECK_EQ(__vga_get_row_line(0), 0);
+  CHECK(table[lines] == NULL);
+
+  uint8_t * next_buffered = NULL;
+  uint16_t next_slot      = 0;
+  uint16_t buffered       = 0;
+  int32_t last_interp     = -1;
+  int32_t min_gap         = INT32_MAX;
+  int32_t max_gap         = 0;
+  for (uint16_t y = 0; y < height; y++) {
+    uint16_t first = __vga_get_row_line(y);
+    uint16_t end   = __vga_get_row_line(y + 1);
+    CHECK(end > first);
+    uint8_t * line = table[first];
+    CHECK(line != NULL);
+    for (uint16_t l = first; l < end; l++) {
+      CHECK(table[l] == line); // Every line of a row shows the same thing
+    }
+
+    if (ring && line >= ring && line < ring + ring_len) {
+      CHECK_EQ((line - ring) % width, 0);
+      CHECK_EQ((line - ring) / width, next_slot); // Slots are used round robin
+      next_slot = (next_slot + 1) % config->num_interpolated_lines;
+      if (last_interp >= 0) {
+        min_gap = MIN(min_gap, y - last_interp);
+        max_gap = MAX(max_gap, y - last_interp);
+      } else {
+        CHECK_EQ(y, 0); // The first row starts a segment
+      }
+      last_interp = y;
+    } else {
+      if (!next_buffered) next_buffered = line;
+      CHECK(line == next_buffered); // Buffered rows are back to back, in order
+      next_buffered = line + width;
+      buffered++;
+    }
+  }
+
+  if (!ring) {
+    CHECK_EQ(buffered, height);
+  } else {
+    // Uses up the framebuffer, and the interpolated rows are spread out evenly
+    CHECK(ring_len + (uint32_t) buffered * width <= PV_FRAMEBUFFER_BYTES);
+    CHECK(ring_len + (uint32_t) (buffered + 1) * width > PV_FRAMEBUFFER_BYTES);
+    if (max_gap > 0) CHECK(max_gap - min_gap <= 1);
+  }
+}
+
+static void check_scanout() {
+  uint16_t width  = vga_get_width();
+  uint16_t height = vga_get_height();
+  for (int b = 0; b < NUM_BANDS; b++) {
+    draw2d_rectangle_filled(&render_queue[b], 0, height * b / NUM_BANDS, width - 1, height * (b + 1) / NUM_BANDS - 1, band_colors[b]);
+  }
+  // A different pixel on every row, so a row showing a stale line buffer can't look right
+  draw2d_line(&render_queue[NUM_BANDS], 0, 0, height, height, COLOR_BLACK); // Stops short of its last pixel
+
+  test_capture();
+  vga_reset_scanout_stats();
+  uint8_t * frame = test_capture();
+  CHECK(frame != NULL);
+  if (!frame) return;
+
+  for (uint16_t y = 0; y < height; y++) {
+    const uint8_t * row = test_screen_row(frame, y);
+    int band            = 0;
+    while (y >= height * (band + 1) / NUM_BANDS) band++;
+    for (uint16_t x = 0; x < width; x++) {
+      vga_color_t color = x == y ? COLOR_BLACK : band_colors[band];
+      if (row[x] != color) {
+        fprintf(stderr, "%ux%u: pixel %u,%u is %02x, not %02x\n", width, height, x, y, row[x], color);
+        CHECK(false);
+        return;
+      }
+    }
+  }
+
+  vga_scanout_stats_t stats;
+  vga_get_scanout_stats(&stats);
+  CHECK(stats.frames > 0);
+  CHECK_EQ(stats.late_lines, 0);
+  CHECK_EQ(stats.underrun_frames, 0);
+}
+
+int main() {
+  for (vga_resolution_base_t base = 0; base < RES_BASE_COUNT; base++) {
+    for (int s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+      for (uint8_t interp = 2; interp <= 4; interp += 2) {
+        vga_config_t config = {
+          .pio                    = pio0,
+          .base_resolution        = base,
+          .scaled_resolution      = scales[s],
+          .render_queue           = render_queue,
+          .render_queue_len       = RENDER_QUEUE_LEN,
+          .auto_render            = true,
+          .num_interpolated_lines = interp,
+        };
+        memset(render_queue, 0, sizeof(render_queue));
+
+        CHECK_EQ(vga_init(&config), 0);
+        fprintf(stderr, "base %d, scale %d, %u interpolated lines: %ux%u, %s\n", base, scales[s], interp, vga_get_width(), vga_get_height(), __vga_get_interp_ring() ? "interpolated" : "buffered");
+        check_table(&config);
+        check_scanout();
+        CHECK_EQ(vga_deinit(&config), 0);
+      }
+    }
+  }
+  return TEST_RESULT();
+}
@@ -0,0 +1,66 @@
+// Every base resolution against the VESA timings it's meant to be: total line and frame length, the system clock the
+// PLL ends up at (an exact multiple of the pixel clock), the frame period, and every visible line going out at the
+// full line length. Recomputed here from the standard, not from vga_modes, so a typo in the table shows up.
+
+#include "test.h"
+
+#include "hardware/clocks.h"
+
+typedef struct {
+  uint32_t pixel_clock_khz;
+  uint16_t h_visible, h_total;
+  uint16_t v_visible, v_total;
+  uint32_t sys_hz; // Pixel clock times the default clock divider
+} mode_timing_t;
+
+static const mode_timing_t timings[RES_BASE_COUNT] = {
+  [RES_800x600]  = { 40000, 800, 800 + 40 + 128 + 88, 600, 600 + 1 + 4 + 23, 120000000 },
+  [RES_640x480]  = { 25000, 640, 640 + 16 + 96 + 48, 480, 480 + 10 + 2 + 33 - 4, 125000000 }, // 25MHz, not 25.175, so 4 lines less back porch keeps it near 60Hz
+  [RES_1024x768] = { 65000, 1024, 1024 + 24 + 136 + 160, 768, 768 + 3 + 6 + 29, 130000000 },
+};
+
+#define RENDER_QUEUE_LEN 1
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+int main() {
+  for (vga_resolution_base_t base = 0; base < RES_BASE_COUNT; base++) {
+    const mode_timing_t * t = &timings[base];
+    CHECK(t->pixel_clock_khz != 0); // Every mode has a row here too
+    if (!t->pixel_clock_khz) continue;
+
+    vga_config_t config = {
+      .pio                    = pio0,
+      .base_resolution        = base,
+      .scaled_resolution      = RES_SCALED_800x600,
+      .render_queue           = render_queue,
+      .render_queue_len       = RENDER_QUEUE_LEN,
+      .scanline_render        = true, // Nothing to buffer, so every size fits
+      .num_interpolated_lines = 4,
+    };
+    CHECK_EQ(vga_init(&config), 0);
+    fprintf(stderr, "base %d: %ux%u, %u system clock\n", base, vga_get_width(), vga_get_height(), clock_get_hz(clk_sys));
+
+    CHECK_EQ(vga_get_width(), t->h_visible);
+    CHECK_EQ(vga_get_height(), t->v_visible);
+    CHECK_EQ(vga_get_width_full(), t->h_total);
+    CHECK_EQ(__vga_get_frame_read_addr_len(), t->v_total);
+    CHECK_EQ(clock_get_hz(clk_sys), t->sys_hz);
+    CHECK_EQ(clock_get_hz(clk_sys) % (t->pixel_clock_khz * 1000), 0);
+
+    uint32_t period_us = (uint64_t) t->h_total * t->v_total * 1000 / t->pixel_clock_khz;
+    CHECK_EQ(__vga_get_frame_period_us(), period_us);
+    CHECK(period_us > 1000000 / 61 && period_us < 1000000 / 59); // 60Hz
+
+    // The color state machine sends every visible line at the full line length
+    CHECK_EQ(host_wait_frames(2), 0);
+    uint8_t * frame = malloc(TEST_FRAME_BYTES);
+    CHECK_EQ(host_get_frame(frame, TEST_FRAME_BYTES), (uint32_t) t->h_total * t->v_visible);
+    free(frame);
+
+    host_stats_t stats;
+    host_get_stats(&stats);
+    CHECK_EQ(stats.pio_stalls, 0);
+    CHECK_EQ(vga_deinit(&config), 0);
+  }
+  return TEST_RESULT();
+}
@@ -0,0 +1,50 @@
+// vga_get_render_profile()'s cull count: an opaque item covering a whole band only counts the items under it that would
+// have been drawn in that band, not hidden ones or ones somewhere else. Runs with and without binning.
+
+#include "test.h"
+
+#include <string.h>
+
+#define RENDER_QUEUE_LEN 4
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+int main() {
+  for (int binned = 0; binned < 2; binned++) {
+    vga_config_t config = {
+      .pio                    = pio0,
+      .base_resolution        = RES_640x480,
+      .scaled_resolution      = RES_SCALED_320x240,
+      .render_queue           = render_queue,
+      .render_queue_len       = RENDER_QUEUE_LEN,
+      .auto_render            = true,
+      .binned_render          = binned,
+      .num_interpolated_lines = 4,
+    };
+    memset(render_queue, 0, sizeof(render_queue));
+    CHECK_EQ(vga_init(&config), 0);
+
+    draw2d_pixel(&render_queue[0], 5, 5, COLOR_RED); // Hidden
+    draw_set_shown(&render_queue[0], false);
+    draw2d_pixel(&render_queue[1], 6, 5, COLOR_GREEN);
+    draw2d_pixel(&render_queue[2], 7, 5, COLOR_BLUE);
+    draw2d_rectangle_filled(&render_queue[3], 0, 0, vga_get_width() - 1, vga_get_height() - 1, COLOR_WHITE);
+    CHECK(test_capture() != NULL);
+
+    // Redraw everything once: items 1 and 2 are under the rectangle in one band (tile), and that's it
+    vga_reset_render_profile();
+    vga_refresh();
+    uint8_t * frame = test_capture();
+    CHECK(frame != NULL);
+    if (frame) CHECK_EQ(test_screen_row(frame, 5)[6], COLOR_WHITE);
+
+    vga_render_profile_t profile;
+    vga_get_render_profile(&profile);
+    fprintf(stderr, "binned %d: %u passes, %u culled\n", binned, profile.passes, profile.culled_items);
+    CHECK_EQ(profile.passes, 1);
+    CHECK_EQ(profile.culled_items, 2);
+    CHECK(profile.types[VGA_RENDER_ITEM_FILLED_RECTANGLE].count > 0); // Once a band (tile)
+    CHECK_EQ(profile.types[VGA_RENDER_ITEM_PIXEL].count, 0);
+    CHECK_EQ(vga_deinit(&config), 0);
+  }
+  return TEST_RESULT();
+}
@@ -0,0 +1,88 @@
+// Arbitrary scaled heights (scaled_width/scaled_height) that don't divide the base resolution: __vga_get_row_line()
+// has to repeat every row over floor() or ceil() of base_height / height lines, spread out so no row is more than one
+// line off where it would be at an exact scale, and the scanout has to show each row on exactly those lines.
+
+#include "test.h"
+
+#include <string.h>
+
+#define RENDER_QUEUE_LEN 2
+#define STRIPE_WIDTH     4
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+vga_color_t stripe[1024 * STRIPE_WIDTH];
+
+// Never COLOR_BLACK (the sprite's null color), and next to each other rows are always different
+static vga_color_t row_color(uint16_t y) {
+  return (y * 37) % 255 + 1;
+}
+
+static void check_rows(uint16_t base_height) {
+  uint16_t height = vga_get_height();
+  uint16_t min    = base_height / height;
+  uint16_t max    = (base_height + height - 1) / height;
+
+  CHECK_EQ(__vga_get_row_line(0), 0);
+  CHECK_EQ(__vga_get_row_line(height), base_height);
+  for (uint16_t y = 0; y < height; y++) {
+    uint16_t first = __vga_get_row_line(y);
+    uint16_t lines = __vga_get_row_line(y + 1) - first;
+    CHECK(lines >= min && lines <= max);
+    CHECK_EQ(first, ((uint32_t) y * base_height + height - 1) / height); // Never more than a line from y * scale
+  }
+}
+
+static void check_scanout(uint16_t base_height) {
+  uint16_t height = vga_get_height();
+  for (uint16_t y = 0; y < height; y++) {
+    memset(&stripe[y * STRIPE_WIDTH], row_color(y), STRIPE_WIDTH);
+  }
+  draw2d_sprite(&render_queue[0], 0, 0, stripe, STRIPE_WIDTH, height, COLOR_BLACK);
+
+  uint8_t * frame = test_capture();
+  CHECK(frame != NULL);
+  if (!frame) return;
+
+  // Base resolution line i shows row (i * height) / base_height
+  for (uint16_t i = 0; i < base_height; i++) {
+    uint16_t y  = (uint32_t) i * height / base_height;
+    uint8_t got = frame[(uint32_t) i * vga_get_width_full()];
+    if (got != row_color(y)) {
+      fprintf(stderr, "%ux%u: line %u is %02x, not row %u (%02x)\n", vga_get_width(), height, i, got, y, row_color(y));
+      CHECK(false);
+      return;
+    }
+  }
+}
+
+int main() {
+  for (vga_resolution_base_t base = 0; base < RES_BASE_COUNT; base++) {
+    vga_config_t probe = { .pio = pio0, .base_resolution = base, .scaled_resolution = RES_SCALED_800x600, .render_queue = render_queue, .render_queue_len = RENDER_QUEUE_LEN, .auto_render = true };
+    CHECK_EQ(vga_init(&probe), 0);
+    uint16_t base_width  = vga_get_width();
+    uint16_t base_height = vga_get_height();
+    CHECK_EQ(vga_deinit(&probe), 0);
+
+    const uint16_t heights[] = { base_height * 2 / 3, base_height * 3 / 5, base_height / 3 + 1, 200, base_height - 1 };
+    for (int h = 0; h < sizeof(heights) / sizeof(heights[0]); h++) {
+      vga_config_t config = {
+        .pio                    = pio0,
+        .base_resolution        = base,
+        .scaled_width           = (uint32_t) base_width * heights[h] / base_height,
+        .scaled_height          = heights[h],
+        .render_queue           = render_queue,
+        .render_queue_len       = RENDER_QUEUE_LEN,
+        .auto_render            = true,
+        .num_interpolated_lines = 4,
+      };
+      memset(render_queue, 0, sizeof(render_queue));
+
+      CHECK_EQ(vga_init(&config), 0);
+      fprintf(stderr, "base %d: %ux%u\n", base, vga_get_width(), vga_get_height());
+      CHECK_EQ(vga_get_height(), heights[h]);
+      check_rows(base_height);
+      check_scanout(base_height);
+      CHECK_EQ(vga_deinit(&config), 0);
+    }
+  }
+  return TEST_RESULT();
+}
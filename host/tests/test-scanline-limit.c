@@ -0,0 +1,46 @@
+// The scanline renderer keeps a few arrays of PV_SCANLINE_MAX_ITEMS item indices. vga_init() has to turn down a longer
+// render queue instead of the renderer quietly leaving the items past the end off the screen, and every item of a
+// render queue that's exactly that long has to show up.
+
+#include "test.h"
+
+#define RENDER_QUEUE_LEN (PV_SCANLINE_MAX_ITEMS + 1)
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+vga_config_t display_conf = {
+  .pio                    = pio0,
+  .base_resolution        = RES_640x480,
+  .scaled_resolution      = RES_SCALED_320x240,
+  .render_queue           = render_queue,
+  .render_queue_len       = RENDER_QUEUE_LEN,
+  .scanline_render        = true,
+  .num_interpolated_lines = 4,
+};
+
+int main() {
+  CHECK_EQ(vga_init(&display_conf), 1);
+
+  display_conf.render_queue_len = PV_SCANLINE_MAX_ITEMS;
+  CHECK_EQ(vga_init(&display_conf), 0);
+
+  // One pixel per item, along the rows, so every item is on the screen at once
+  for (uint16_t i = 0; i < PV_SCANLINE_MAX_ITEMS; i++) {
+    draw2d_pixel(&render_queue[i], i % 128 * 2, i / 128 * 2, COLOR_WHITE);
+  }
+
+  uint8_t * frame = test_capture();
+  CHECK(frame != NULL);
+  if (!frame) return TEST_RESULT();
+  test_dump("scanline-limit", frame);
+
+  for (uint16_t i = 0; i < PV_SCANLINE_MAX_ITEMS; i++) {
+    uint16_t x = i % 128 * 2, y = i / 128 * 2;
+    if (test_screen_row(frame, y)[x] != COLOR_WHITE) {
+      fprintf(stderr, "Item %u (pixel %u,%u) is missing\n", i, x, y);
+      CHECK(false);
+    }
+  }
+
+  CHECK_EQ(vga_deinit(&display_conf), 0);
+  return TEST_RESULT();
+}
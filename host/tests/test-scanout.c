@@ -0,0 +1,47 @@
+// The scanout end to end: draw something, let the emulated hardware send it out, and check what the color state
+// machine shifted out matches.
+
+#include "test.h"
+
+#define RENDER_QUEUE_LEN 8
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+vga_config_t display_conf = {
+  .pio                    = pio0,
+  .base_resolution        = RES_640x480,
+  .scaled_resolution      = RES_SCALED_320x240,
+  .render_queue           = render_queue,
+  .render_queue_len       = RENDER_QUEUE_LEN,
+  .auto_render            = true,
+  .num_interpolated_lines = 0,
+};
+
+int main() {
+  CHECK_EQ(vga_init(&display_conf), 0);
+  draw2d_rectangle_filled(&render_queue[0], 10, 20, 99, 59, COLOR_RED);
+
+  uint8_t * frame = test_capture();
+  CHECK(frame != NULL);
+  if (!frame) return TEST_RESULT();
+  test_dump("scanout", frame);
+
+  for (uint16_t y = 0; y < vga_get_height(); y++) {
+    const uint8_t * row = test_screen_row(frame, y);
+    for (uint16_t x = 0; x < vga_get_width(); x++) {
+      bool inside = x >= 10 && x <= 99 && y >= 20 && y <= 59;
+      if (row[x] != (inside ? COLOR_RED : COLOR_BLACK)) {
+        fprintf(stderr, "Pixel %u,%u is %02x\n", x, y, row[x]);
+        CHECK(false);
+        return TEST_RESULT();
+      }
+    }
+  }
+
+  host_stats_t stats;
+  host_get_stats(&stats);
+  CHECK_EQ(stats.pio_stalls, 0);
+  CHECK_EQ(stats.lockstep_timeouts, 0);
+
+  CHECK_EQ(vga_deinit(&display_conf), 0);
+  return TEST_RESULT();
+}
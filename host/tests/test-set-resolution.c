@@ -0,0 +1,107 @@
+// vga_set_resolution(): core 1 stops the scanout, reclocks and starts it again at the new size, with the whole screen
+// redrawn. Goes through the framebuffer renderer (core 1 in the render loop) and the scanline renderer (core 1 idle),
+// each to a different base resolution and back. A new scale at the same base resolution mustn't touch the system
+// clock or the sync PWM slices, and has to be done by the next frame.
+
+#include "test.h"
+
+#include "hardware/clocks.h"
+
+#include <string.h>
+
+#define RENDER_QUEUE_LEN 4
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+// A background bigger than the first resolution, so it only covers the whole screen once it's redrawn at the new size
+static void check_screen(const char * name) {
+  uint8_t * frame = test_capture();
+  CHECK(frame != NULL);
+  if (!frame) return;
+  test_dump(name, frame);
+
+  for (uint16_t y = 0; y < vga_get_height(); y++) {
+    const uint8_t * row = test_screen_row(frame, y);
+    for (uint16_t x = 0; x < vga_get_width(); x++) {
+      bool inside       = x >= 10 && x <= 99 && y >= 20 && y <= 59;
+      vga_color_t color = inside ? COLOR_RED : COLOR_BLUE;
+      if (row[x] != color) {
+        fprintf(stderr, "%s, %ux%u: pixel %u,%u is %02x, not %02x\n", name, vga_get_width(), vga_get_height(), x, y, row[x], color);
+        CHECK(false);
+        return;
+      }
+    }
+  }
+
+  vga_scanout_stats_t stats;
+  vga_reset_scanout_stats();
+  test_capture();
+  vga_get_scanout_stats(&stats);
+  CHECK(stats.frames > 0);
+  CHECK_EQ(stats.underrun_frames, 0);
+  CHECK_EQ(stats.late_lines, 0);
+}
+
+static void run(bool scanline) {
+  vga_config_t config = {
+    .pio                    = pio0,
+    .base_resolution        = RES_640x480,
+    .scaled_resolution      = RES_SCALED_320x240,
+    .render_queue           = render_queue,
+    .render_queue_len       = RENDER_QUEUE_LEN,
+    .auto_render            = !scanline,
+    .scanline_render        = scanline,
+    .num_interpolated_lines = 4,
+  };
+  memset(render_queue, 0, sizeof(render_queue));
+
+  CHECK_EQ(vga_init(&config), 0);
+  draw2d_rectangle_filled(&render_queue[0], 0, 0, 1023, 767, COLOR_BLUE);
+  draw2d_rectangle_filled(&render_queue[1], 10, 20, 99, 59, COLOR_RED);
+  check_screen(scanline ? "set-resolution-scanline-320" : "set-resolution-320");
+
+  CHECK_EQ(vga_set_resolution(RES_800x600, RES_SCALED_400x300), 0);
+  CHECK_EQ(vga_get_width(), 400);
+  CHECK_EQ(vga_get_height(), 300);
+  CHECK_EQ(vga_get_config()->base_resolution, RES_800x600);
+  check_screen(scanline ? "set-resolution-scanline-400" : "set-resolution-400");
+
+  // Same base resolution, new scale: the sync signals keep running
+  host_stats_t stats;
+  host_reset_stats();
+  uint32_t sys_hz = clock_get_hz(clk_sys);
+  uint32_t frame  = vga_get_frame_count();
+  CHECK_EQ(vga_set_resolution(RES_800x600, RES_SCALED_200x150), 0);
+  CHECK(vga_get_frame_count() - frame <= 1);
+  host_get_stats(&stats);
+  CHECK_EQ(stats.pll_changes, 0);
+  CHECK_EQ(stats.pwm_stops, 0);
+  CHECK_EQ(clock_get_hz(clk_sys), sys_hz);
+  CHECK_EQ(vga_get_width(), 200);
+  check_screen(scanline ? "set-resolution-scanline-200" : "set-resolution-200");
+
+  CHECK_EQ(vga_set_resolution(RES_800x600, RES_SCALED_400x300), 0);
+  CHECK_EQ(vga_get_width(), 400);
+  check_screen(scanline ? "set-resolution-scanline-400-again" : "set-resolution-400-again");
+  host_get_stats(&stats);
+  CHECK_EQ(stats.pll_changes, 0);
+  CHECK_EQ(stats.pwm_stops, 0);
+
+  CHECK_EQ(vga_set_resolution(RES_640x480, RES_SCALED_320x240), 0);
+  CHECK_EQ(vga_get_width(), 320);
+  host_get_stats(&stats);
+  CHECK(stats.pll_changes > 0); // A new base resolution does stop everything
+  CHECK(stats.pwm_stops > 0);
+  check_screen(scanline ? "set-resolution-scanline-320-again" : "set-resolution-320-again");
+
+  // Doesn't fit, nothing changes
+  CHECK_EQ(vga_set_resolution(RES_BASE_COUNT, RES_SCALED_320x240), 1);
+  CHECK_EQ(vga_get_width(), 320);
+
+  CHECK_EQ(vga_deinit(&config), 0);
+}
+
+int main() {
+  run(false);
+  run(true);
+  return TEST_RESULT();
+}
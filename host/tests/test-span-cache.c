@@ -0,0 +1,104 @@
+// Span cache (built with PV_SPAN_CACHE_SPANS): every item type that gets cached is rasterized into spans once, and
+// has to come out the same from the cache as straight from its rasterizer. That's drawn first (manual rendering
+// doesn't use the cache), then the same item in AutoRender, then again after part of it gets redrawn from its spans.
+
+#include "test.h"
+
+#include <string.h>
+
+#define RENDER_QUEUE_LEN 2
+vga_render_item_t render_queue[RENDER_QUEUE_LEN];
+
+static uint16_t polygon_points[5][2] = { { 10, 30 }, { 40, 10 }, { 80, 25 }, { 60, 60 }, { 20, 55 } };
+static char string[]                 = "Hello";
+
+static void draw(vga_render_item_t * item, vga_render_item_type_t type) {
+  switch (type) {
+    case VGA_RENDER_ITEM_LINE: draw2d_line(item, 10, 40, 70, 12, COLOR_WHITE); break;
+    case VGA_RENDER_ITEM_RECTANGLE: draw2d_rectangle(item, 10, 10, 60, 40, COLOR_WHITE); break;
+    case VGA_RENDER_ITEM_TRIANGLE: draw2d_triangle(item, 10, 50, 40, 10, 90, 35, COLOR_WHITE); break;
+    case VGA_RENDER_ITEM_FILLED_TRIANGLE: draw2d_triangle_filled(item, 10, 50, 40, 10, 90, 35, COLOR_WHITE); break;
+    case VGA_RENDER_ITEM_CIRCLE: draw2d_circle(item, 40, 40, 25, COLOR_WHITE); break;
+    case VGA_RENDER_ITEM_FILLED_CIRCLE: draw2d_circle_filled(item, 40, 40, 25, COLOR_WHITE); break;
+    case VGA_RENDER_ITEM_STRING: draw2d_text(item, 10, 10, 200, string, COLOR_WHITE, false); break;
+    case VGA_RENDER_ITEM_POLYGON: draw2d_polygon(item, polygon_points, 5, COLOR_WHITE); break;
+    case VGA_RENDER_ITEM_FILLED_POLYGON: draw2d_polygon_filled(item, polygon_points, 5, COLOR_WHITE); break;
+    default: break;
+  }
+}
+
+static const vga_render_item_type_t cached[] = {
+  VGA_RENDER_ITEM_LINE,   VGA_RENDER_ITEM_RECTANGLE,     VGA_RENDER_ITEM_TRIANGLE, VGA_RENDER_ITEM_FILLED_TRIANGLE,
+  VGA_RENDER_ITEM_CIRCLE, VGA_RENDER_ITEM_FILLED_CIRCLE, VGA_RENDER_ITEM_STRING,   VGA_RENDER_ITEM_POLYGON,
+  VGA_RENDER_ITEM_FILLED_POLYGON,
+};
+#define NUM_CACHED (sizeof(cached) / sizeof(cached[0]))
+
+static uint8_t * screens[NUM_CACHED];
+
+static uint8_t * copy_screen(const uint8_t * frame) {
+  uint16_t width = vga_get_width(), height = vga_get_height();
+  uint8_t * screen = calloc((uint32_t) width * height, 1);
+  for (uint16_t y = 0; frame && y < height; y++) memcpy(screen + (uint32_t) y * width, test_screen_row(frame, y), width);
+  return screen;
+}
+
+// Number of pixels that differ, printing the first one
+static uint32_t compare(const uint8_t * a, const uint8_t * b, const char * what, int t) {
+  uint16_t width = vga_get_width(), height = vga_get_height();
+  uint32_t diff  = 0;
+  for (uint32_t p = 0; p < (uint32_t) width * height; p++) {
+    if (a[p] == b[p]) continue;
+    if (!diff) fprintf(stderr, "type %d %s: pixel %u,%u is %02x, should be %02x\n", t, what, p % width, p / width, a[p], b[p]);
+    diff++;
+  }
+  return diff;
+}
+
+int main() {
+  vga_config_t config = {
+    .pio                    = pio0,
+    .base_resolution        = RES_640x480,
+    .scaled_resolution      = RES_SCALED_320x240,
+    .render_queue           = render_queue,
+    .render_queue_len       = RENDER_QUEUE_LEN,
+    .auto_render            = false,
+    .num_interpolated_lines = 4,
+  };
+
+  // Straight from the rasterizers
+  CHECK_EQ(vga_init(&config), 0);
+  for (int t = 0; t < NUM_CACHED; t++) {
+    memset(render_queue, 0, sizeof(render_queue));
+    draw(&render_queue[0], cached[t]);
+    vga_refresh();
+    screens[t] = copy_screen(test_capture());
+
+    uint32_t lit = 0;
+    for (uint32_t p = 0; p < (uint32_t) vga_get_width() * vga_get_height(); p++) lit += screens[t][p] != COLOR_BLACK;
+    CHECK(lit > 0);
+  }
+  CHECK_EQ(vga_deinit(&config), 0);
+
+  // From the span cache
+  config.auto_render = true;
+  CHECK_EQ(vga_init(&config), 0);
+  for (int t = 0; t < NUM_CACHED; t++) {
+    memset(render_queue, 0, sizeof(render_queue));
+    draw_clear();
+    draw(&render_queue[0], cached[t]);
+    uint8_t * screen = copy_screen(test_capture());
+    CHECK_EQ(compare(screen, screens[t], "recorded", cached[t]), 0);
+    free(screen);
+
+    // Damage the middle of it, so part of it gets drawn again from its spans
+    draw2d_rectangle_filled(&render_queue[1], 20, 20, 50, 30, COLOR_RED);
+    draw_set_shown(&render_queue[1], false);
+    screen = copy_screen(test_capture());
+    CHECK_EQ(compare(screen, screens[t], "replayed", cached[t]), 0);
+    free(screen);
+    free(screens[t]);
+  }
+  CHECK_EQ(vga_deinit(&config), 0);
+  return TEST_RESULT();
+}
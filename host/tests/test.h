@@ -0,0 +1,74 @@
+// Host tests: every test is its own executable, see host/tests/CMakeLists.txt.
+
+#ifndef _PV_TEST_H
+#define _PV_TEST_H
+
+#include "host-emu.h"
+#include "pico-vga.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int test_failures = 0;
+
+// Keep going after a failure so one run shows all of them
+#define CHECK(cond)                                                        \
+  do {                                                                     \
+    if (!(cond)) {                                                         \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      test_failures++;                                                     \
+    }                                                                      \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                                                       \
+  do {                                                                                                       \
+    long long _a = (long long) (a), _b = (long long) (b);                                                    \
+    if (_a != _b) {                                                                                          \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+      test_failures++;                                                                                       \
+    }                                                                                                        \
+  } while (0)
+
+#define TEST_RESULT() (test_failures ? (fprintf(stderr, "%d check(s) failed\n", test_failures), 1) : 0)
+
+#define TEST_FRAME_BYTES (2048 * 1024)
+
+/**
+ * @brief Let the renderer finish what it's doing, then wait for a couple of frames so the screen shows it and copy
+ * the last one out. Rows are vga_get_width_full() pixels apart, row y of the screen is test_screen_row(frame, y).
+ *
+ * @return uint8_t* The frame (static, overwritten by the next call), NULL if the scanout isn't running
+ */
+static uint8_t * test_capture(void) {
+  static uint8_t * frame = NULL;
+  if (!frame) frame = malloc(TEST_FRAME_BYTES);
+  host_wait_idle(1);
+  if (host_wait_frames(2)) return NULL;
+  if (host_get_frame(frame, TEST_FRAME_BYTES) == 0) return NULL;
+  return frame;
+}
+
+static inline const uint8_t * test_screen_row(const uint8_t * frame, uint16_t y) {
+  return frame + (uint32_t) __vga_get_row_line(y) * vga_get_width_full();
+}
+
+/**
+ * @brief Write the screen out as <PV_HOST_DUMP>/<name>.ppm, if PV_HOST_DUMP is set
+ */
+static void test_dump(const char * name, const uint8_t * frame) {
+  const char * dir = getenv("PV_HOST_DUMP");
+  if (!dir || !frame) return;
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s.ppm", dir, name);
+  uint16_t width  = vga_get_width();
+  uint16_t height = vga_get_height();
+  uint8_t * screen = malloc((uint32_t) width * height);
+  for (uint16_t y = 0; y < height; y++) {
+    const uint8_t * row = test_screen_row(frame, y);
+    for (uint16_t x = 0; x < width; x++) screen[(uint32_t) y * width + x] = row[x];
+  }
+  if (host_write_ppm(path, screen, width, height, width)) fprintf(stderr, "Couldn't write %s\n", path);
+  free(screen);
+}
+
+#endif
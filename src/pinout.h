@@ -50,6 +50,7 @@ GPIO21 - Controller SCL
 #define VSYNC_PIN       10
 #define VSYNC_PWM_SLICE (VSYNC_PIN / 2) % 8
 #define VSYNC_PWM_CHAN  (VSYNC_PIN % 2)
+#define FRAME_PWM_SLICE 0 // No pin (GPIO0/1 belong to the color PIO), only used to pace the DMA once a frame
 
 #define AUDIO_L_PIN       27
 #define AUDIO_L_PWM_SLICE (AUDIO_L_PIN / 2) % 8
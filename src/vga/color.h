@@ -46,6 +46,18 @@ static inline vga_color_t color_html_to_vga(uint32_t html_color) {
   return color_rgb_to_vga((uint8_t) ((html_color >> 16) & 255), (uint8_t) ((html_color >> 8) & 255), (uint8_t) ((html_color & 255)));
 }
 
+/**
+ * @brief Convert an 8 bit color back into red, green, and blue values (0-255, i.e. for writing out a PPM image).
+ *
+ * @param color The 8 bit color
+ * @param rgb Filled with the red, green, and blue values
+ */
+static inline void color_vga_to_rgb(vga_color_t color, uint8_t rgb[3]) {
+  rgb[0] = ((color >> 5) & 7) * 255 / 7;
+  rgb[1] = ((color >> 2) & 7) * 255 / 7;
+  rgb[2] = (color & 3) * 255 / 3;
+}
+
 /**
  * @brief Convert HSV colors into 8 bit compressed RGB.
  * @param hue Hue value, 0-255
@@ -30,7 +30,45 @@ static volatile uint8_t (*font)[FONT_HEIGHT] = cp437; // The current font in use
 static void clear_and_activate_item(vga_render_item_t * item) {
   item->header.flags_byte   = 0;
   item->header.flags.shown  = true;
-  item->header.flags.update = true;
+  draw2d_update_bbox(item);
+  draw_mark_updated(item);
+}
+
+// Rectangle from signed corners, clamped to what fits in a vga_rect_t
+static vga_rect_t clamp_rect(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+  if (x1 > x2 || y1 > y2 || x2 < 0 || y2 < 0) return VGA_RECT_EMPTY;
+  return (vga_rect_t) { MAX(x1, 0), MAX(y1, 0), MIN(x2, UINT16_MAX), MIN(y2, UINT16_MAX) };
+}
+
+// True if none of a sprite's pixels are its null color
+static bool sprite_opaque(const vga_render_item_t * item) {
+  const vga_color_t * sprite = item->item_2d.sprite.sprite;
+  uint32_t size              = (uint32_t) item->item_2d.sprite.size_x * item->item_2d.sprite.size_y;
+  for (uint32_t i = 0; i < size; i++) {
+    if (sprite[i] == item->item_2d.sprite.null_color) return false;
+  }
+  return true;
+}
+
+// Bottom right corner of a string, walking it the same way render2d_string() does
+static void string_extent(const vga_render_item_t * item, int32_t * x2, int32_t * y2) {
+  uint16_t x1       = item->item_2d.x;
+  uint16_t cursor_x = x1;
+  int32_t cursor_y  = item->item_2d.y;
+  *x2               = x1;
+  for (const char * c = item->item_2d.str.str; *c != '\0'; c++) {
+    *x2      = MAX(*x2, cursor_x + FONT_WIDTH);
+    cursor_x = cursor_x + FONT_WIDTH + FONT_SPACING;
+    if (item->header.flags.wordwrap) {
+      if (cursor_x > item->item_2d.str.x2) {
+        cursor_x = x1;
+        if (c[1] != '\0') cursor_y += FONT_HEIGHT;
+      }
+    } else if (cursor_x > vga_get_playfield_width()) {
+      cursor_x = vga_get_playfield_width();
+    }
+  }
+  *y2 = cursor_y + FONT_HEIGHT - 1;
 }
 
 /************************************
@@ -40,23 +78,23 @@ static void clear_and_activate_item(vga_render_item_t * item) {
 void draw2d_set_scale(vga_render_item_t * item, uint8_t scale_x, uint8_t scale_y) {
   assert(item);
 
-  item->item_2d.scale_x     = scale_x;
-  item->item_2d.scale_y     = scale_y;
-  item->header.flags.update = true;
+  item->item_2d.scale_x = scale_x;
+  item->item_2d.scale_y = scale_y;
+  draw_mark_updated(item);
 }
 
 void draw2d_set_rotation(vga_render_item_t * item, int8_t theta) {
   assert(item);
 
-  item->item_2d.theta       = theta;
-  item->header.flags.update = true;
+  item->item_2d.theta = theta;
+  draw_mark_updated(item);
 }
 
 void draw2d_set_color(vga_render_item_t * item, vga_color_t color) {
   assert(item);
 
-  item->item_2d.color       = color;
-  item->header.flags.update = true;
+  item->item_2d.color = color;
+  draw_mark_updated(item);
 }
 
 
@@ -199,8 +237,10 @@ void draw2d_text(vga_render_item_t * item, uint16_t x1, uint16_t y, uint16_t x2,
   item->item_2d.str.x2  = x2;
 
   item->header.flags_byte     = 0;
+  item->header.flags.shown    = true;
   item->header.flags.wordwrap = wrap;
-  item->header.flags.update   = true;
+  draw2d_update_bbox(item);
+  draw_mark_updated(item);
 }
 
 void draw2d_set_font(const uint8_t new_font[256][FONT_HEIGHT]) {
@@ -230,4 +270,71 @@ void draw2d_sprite(vga_render_item_t * item, uint16_t x, uint16_t y, vga_color_t
   item->item_2d.sprite.null_color = null_color;
 
   clear_and_activate_item(item);
+}
+
+
+/*
+        Bounding Boxes
+==============================
+*/
+
+void draw2d_update_bbox(vga_render_item_t * item) {
+  assert(item);
+
+  item->header.flags.opaque = item->header.type == VGA_RENDER_ITEM_FILL || item->header.type == VGA_RENDER_ITEM_FILLED_RECTANGLE;
+
+  uint16_t px[3] = { item->item_2d.point.x[0], item->item_2d.point.x[1], item->item_2d.point.x[2] }; // Copied out of the packed struct
+  uint16_t py[3] = { item->item_2d.point.y[0], item->item_2d.point.y[1], item->item_2d.point.y[2] };
+  int32_t x      = item->item_2d.x;
+  int32_t y      = item->item_2d.y;
+  int32_t x2, y2;
+
+  switch (item->header.type) {
+    case VGA_RENDER_ITEM_FILL:
+      item->bbox = (vga_rect_t) { 0, 0, UINT16_MAX, UINT16_MAX };
+      break;
+    case VGA_RENDER_ITEM_PIXEL:
+      item->bbox = clamp_rect(x, y, x, y);
+      break;
+    case VGA_RENDER_ITEM_LINE:
+    case VGA_RENDER_ITEM_RECTANGLE:
+    case VGA_RENDER_ITEM_FILLED_RECTANGLE:
+      item->bbox = clamp_rect(MIN(px[0], px[1]), MIN(py[0], py[1]), MAX(px[0], px[1]), MAX(py[0], py[1]));
+      break;
+    case VGA_RENDER_ITEM_TRIANGLE:
+    case VGA_RENDER_ITEM_FILLED_TRIANGLE:
+      item->bbox = clamp_rect(MIN(px[0], MIN(px[1], px[2])), MIN(py[0], MIN(py[1], py[2])),
+                              MAX(px[0], MAX(px[1], px[2])), MAX(py[0], MAX(py[1], py[2])));
+      break;
+    case VGA_RENDER_ITEM_CIRCLE:
+    case VGA_RENDER_ITEM_FILLED_CIRCLE:
+      item->bbox = clamp_rect(x - px[0], y - px[0], x + px[0], y + px[0]); // point.x[0] is the radius
+      break;
+    case VGA_RENDER_ITEM_STRING:
+      string_extent(item, &x2, &y2);
+      item->bbox = clamp_rect(x, y, x2, y2);
+      break;
+    case VGA_RENDER_ITEM_SPRITE:
+      item->bbox                = clamp_rect(x, y, x + item->item_2d.sprite.size_x - 1, y + item->item_2d.sprite.size_y - 1);
+      item->header.flags.opaque = sprite_opaque(item);
+      break;
+    case VGA_RENDER_ITEM_POLYGON:
+    case VGA_RENDER_ITEM_FILLED_POLYGON:
+      item->bbox = VGA_RECT_EMPTY;
+      for (uint32_t i = 0; i < item->item_2d.points_arr.num_points; i++) {
+        const uint16_t * point = item->item_2d.points_arr.points[i];
+        item->bbox.x1          = MIN(item->bbox.x1, point[POINT_X]);
+        item->bbox.y1          = MIN(item->bbox.y1, point[POINT_Y]);
+        item->bbox.x2          = MAX(item->bbox.x2, point[POINT_X]);
+        item->bbox.y2          = MAX(item->bbox.y2, point[POINT_Y]);
+      }
+      break;
+    case VGA_RENDER_ITEM_BITMAP:
+    case VGA_RENDER_ITEM_LIGHT:
+    case VGA_RENDER_ITEM_SVG:
+    case VGA_RENDER_ITEM_MAX:
+    default:
+      item->bbox = VGA_RECT_EMPTY; // Not drawn
+      break;
+  }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "pico/assert.h"
 #include "pico/stdlib.h"
+#include "render.h"
 #include "vga.h"
 
 /************************************
@@ -41,6 +42,13 @@ void draw_set_shown(vga_render_item_t * item, bool shown) {
   assert(item);
 
   item->header.flags.shown = shown;
+  draw_mark_updated(item);
+}
+
+// Set the item's update flag and wake the renderer up
+void draw_mark_updated(vga_render_item_t * item) {
+  assert(item);
+
   item->header.flags.update = true;
-  // update screen
+  render_mark_dirty(item);
 }
\ No newline at end of file
@@ -1,9 +1,9 @@
 #include "../common.h"
 #include "color.h"
-#include "hardware/dma.h"
 #include "pico/platform.h"
 #include "render.h"
 #include "vga.h"
+#include <string.h>
 
 /************************************
  * EXTERN VARIABLES
@@ -13,6 +13,8 @@
  * PRIVATE MACROS AND DEFINES
  ************************************/
 
+#define DMA_MIN_PIXELS 1024 // Smaller fills and blits are done by the CPU, setting the DMA engine up isn't worth it
+
 /************************************
  * PRIVATE TYPEDEFS
  ************************************/
@@ -25,25 +27,53 @@
  * STATIC FUNCTIONS
  ************************************/
 
-static void render_fast_vert_line(uint16_t x, uint16_t y1, uint16_t y2, vga_color_t color) {
+// Both fast lines only walk the part of the line inside the clip area. Like everything in here that clips, they take
+// signed coordinates (the same as render-scanline.c), so a line partly off the top or left of the screen gets clipped
+// instead of wrapping around.
+static void render_fast_vert_line(const render_target_t * t, int32_t x, int32_t y1, int32_t y2, vga_color_t color) {
   if (y2 < y1) {
     SWAP(y1, y2);
   }
-  for (; y1 <= y2; y1++) {
-    render_pixel(y1, x, color);
+  if (x < t->clip.x1 || x > t->clip.x2) return;
+  int32_t top    = MAX(y1, t->clip.y1);
+  int32_t bottom = MIN(y2, t->clip.y2);
+  if (!t->base) {
+    for (int32_t y = top; y <= bottom; y++) {
+      render_pixel(y, x, color);
+    }
+    return;
   }
+  uint8_t * p = t->base + (top - t->clip.y1) * t->stride + (x - t->clip.x1);
+  for (int32_t y = top; y <= bottom; y++, p += t->stride) {
+    *p = color;
+  }
+  render_count_pixels(bottom - top + 1);
 }
 
-static void render_fast_horiz_line(uint16_t x1, uint16_t x2, uint16_t y, vga_color_t color) {
+static void render_fast_horiz_line(const render_target_t * t, int32_t x1, int32_t x2, int32_t y, vga_color_t color) {
   if (x2 < x1) {
     SWAP(x1, x2);
   }
-  for (; x1 <= x2; x1++) {
-    render_pixel(y, x1, color);
+  if (y < t->clip.y1 || y > t->clip.y2) return;
+  int32_t left  = MAX(x1, t->clip.x1);
+  int32_t right = MIN(x2, t->clip.x2);
+  if (left > right) return;
+  if (!t->base) {
+    for (int32_t x = left; x <= right; x++) {
+      render_pixel(y, x, color);
+    }
+    return;
   }
+  render_fill_span(t->base + (y - t->clip.y1) * t->stride + (left - t->clip.x1), color, right - left + 1);
 }
 
-static void bresenham_low(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, vga_color_t color) {
+/*
+  Both Bresenhams skip straight to the first column (row) inside the clip area instead of clipping the line itself,
+  so a line split over several bands or tiles still lands on exactly the same pixels. After k steps the minor axis
+  has moved n = (2 * minor * k + major - 1) / (2 * major) times, and the decision variable follows from that.
+*/
+
+static void bresenham_low(const render_target_t * t, int32_t x1, int32_t y1, int32_t x2, int32_t y2, vga_color_t color) {
   // Bresenham's line drawing algorithm, thanks Wikipedia! (https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm)
   int32_t dx = x2 - x1;
   int32_t dy = y2 - y1;
@@ -53,11 +83,18 @@ static void bresenham_low(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, vg
     yi = -1;
     dy = -dy;
   }
-  int32_t D = (2 * dy) - dx;
-  int32_t y = y1;
 
-  for (int32_t x = x1; x < x2; x++) {
-    render_pixel(y, x, color);
+  int32_t start = MAX(x1, t->clip.x1);
+  int32_t end   = MIN(x2, t->clip.x2 + 1);
+  int32_t k     = start - x1;
+  int32_t n     = ((int64_t) 2 * dy * k + dx - 1) / (2 * dx);
+  int32_t D     = (int64_t) 2 * dy * (k + 1) - dx - (int64_t) 2 * dx * n;
+  int32_t y     = y1 + yi * n;
+
+  for (int32_t x = start; x < end; x++) {
+    if (y >= t->clip.y1 && y <= t->clip.y2) {
+      render_target_pixel(t, x, y, color);
+    }
     if (D > 0) {
       y = y + yi;
       D = D + 2 * (dy - dx);
@@ -67,7 +104,7 @@ static void bresenham_low(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, vg
   }
 }
 
-static void bresenham_high(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, vga_color_t color) {
+static void bresenham_high(const render_target_t * t, int32_t x1, int32_t y1, int32_t x2, int32_t y2, vga_color_t color) {
   int32_t dx = x2 - x1;
   int32_t dy = y2 - y1;
 
@@ -76,11 +113,18 @@ static void bresenham_high(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, v
     xi = -1;
     dx = -dx;
   }
-  int32_t D = (2 * dx) - dy;
-  int32_t x = x1;
 
-  for (int32_t y = y1; y < y2; y++) {
-    render_pixel(y, x, color);
+  int32_t start = MAX(y1, t->clip.y1);
+  int32_t end   = MIN(y2, t->clip.y2 + 1);
+  int32_t k     = start - y1;
+  int32_t n     = ((int64_t) 2 * dx * k + dy - 1) / (2 * dy);
+  int32_t D     = (int64_t) 2 * dx * (k + 1) - dy - (int64_t) 2 * dy * n;
+  int32_t x     = x1 + xi * n;
+
+  for (int32_t y = start; y < end; y++) {
+    if (x >= t->clip.x1 && x <= t->clip.x2) {
+      render_target_pixel(t, x, y, color);
+    }
     if (D > 0) {
       x = x + xi;
       D = D + 2 * (dx - dy);
@@ -90,22 +134,28 @@ static void bresenham_high(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, v
   }
 }
 
-static void bresenham_circle(uint16_t x, uint16_t y, uint16_t pixel_x, uint16_t pixel_y, vga_color_t color) {
-  render_pixel(y + pixel_y, x + pixel_x, color);
-  render_pixel(y + pixel_y, x - pixel_x, color);
-  render_pixel(y - pixel_y, x + pixel_x, color);
-  render_pixel(y - pixel_y, x - pixel_x, color);
-  render_pixel(y + pixel_x, x + pixel_y, color);
-  render_pixel(y + pixel_x, x - pixel_y, color);
-  render_pixel(y - pixel_x, x + pixel_y, color);
-  render_pixel(y - pixel_x, x - pixel_y, color);
+static inline void render_clipped_pixel(const render_target_t * t, int32_t x, int32_t y, vga_color_t color) {
+  if (x >= t->clip.x1 && x <= t->clip.x2 && y >= t->clip.y1 && y <= t->clip.y2) {
+    render_target_pixel(t, x, y, color);
+  }
 }
 
-static void bresenham_circle_filled(uint16_t x, uint16_t y, uint16_t pixel_x, uint16_t pixel_y, vga_color_t color) {
-  render_fast_horiz_line(x - pixel_x, x + pixel_x, y + pixel_y, color);
-  render_fast_horiz_line(x + pixel_x, x - pixel_x, y - pixel_y, color);
-  render_fast_horiz_line(x + pixel_y, x - pixel_y, y + pixel_x, color);
-  render_fast_horiz_line(x + pixel_y, x - pixel_y, y - pixel_x, color);
+static void bresenham_circle(const render_target_t * t, int32_t x, int32_t y, int32_t pixel_x, int32_t pixel_y, vga_color_t color) {
+  render_clipped_pixel(t, x + pixel_x, y + pixel_y, color);
+  render_clipped_pixel(t, x - pixel_x, y + pixel_y, color);
+  render_clipped_pixel(t, x + pixel_x, y - pixel_y, color);
+  render_clipped_pixel(t, x - pixel_x, y - pixel_y, color);
+  render_clipped_pixel(t, x + pixel_y, y + pixel_x, color);
+  render_clipped_pixel(t, x - pixel_y, y + pixel_x, color);
+  render_clipped_pixel(t, x + pixel_y, y - pixel_x, color);
+  render_clipped_pixel(t, x - pixel_y, y - pixel_x, color);
+}
+
+static void bresenham_circle_filled(const render_target_t * t, int32_t x, int32_t y, int32_t pixel_x, int32_t pixel_y, vga_color_t color) {
+  render_fast_horiz_line(t, x - pixel_x, x + pixel_x, y + pixel_y, color);
+  render_fast_horiz_line(t, x + pixel_x, x - pixel_x, y - pixel_y, color);
+  render_fast_horiz_line(t, x + pixel_y, x - pixel_y, y + pixel_x, color);
+  render_fast_horiz_line(t, x + pixel_y, x - pixel_y, y - pixel_x, color);
 }
 
 /************************************
@@ -113,79 +163,67 @@ static void bresenham_circle_filled(uint16_t x, uint16_t y, uint16_t pixel_x, ui
  ************************************/
 
 void render2d_fill(vga_color_t color) {
-  render2d_rectangle_filled(0, 0, vga_get_width() - 1, vga_get_height() - 1, color);
+  render2d_rectangle_filled(0, 0, vga_get_playfield_width() - 1, vga_get_playfield_height() - 1, color);
 }
 
 void render2d_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, vga_color_t color) {
+  render_target_t t;
+  render_get_target(&t);
   if (x1 == x2) {
-    render_fast_vert_line(x1, y1, y2, color);
+    render_fast_vert_line(&t, x1, y1, y2, color);
   } else if (y1 == y2) {
-    render_fast_horiz_line(x1, x2, y1, color);
+    render_fast_horiz_line(&t, x1, x2, y1, color);
   } else {
     if (ABS(y2 - y1) < ABS(x2 - x1)) {        // -1 < slope < 1
       if (x1 > x2) {                          // line goes right -> left
-        bresenham_low(x2, y2, x1, y1, color); // Coordinate pairs reversed
+        bresenham_low(&t, x2, y2, x1, y1, color); // Coordinate pairs reversed
       } else {
-        bresenham_low(x1, y1, x2, y2, color);
+        bresenham_low(&t, x1, y1, x2, y2, color);
       }
     } else {                                   // slope =< -1 || slope >= 1
       if (y1 > y2) {                           // line goes bottom -> top
-        bresenham_high(x2, y2, x1, y1, color); // Coordinate pairs reversed
+        bresenham_high(&t, x2, y2, x1, y1, color); // Coordinate pairs reversed
       } else {
-        bresenham_high(x1, y1, x2, y2, color);
+        bresenham_high(&t, x1, y1, x2, y2, color);
       }
     }
   }
 }
 
 void render2d_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, vga_color_t color) {
-  render_fast_vert_line(x1, y1, y2, color);
-  render_fast_vert_line(x2, y1, y2, color);
-  render_fast_horiz_line(x1, x2, y1, color);
-  render_fast_horiz_line(x1, x2, y2, color);
+  render_target_t t;
+  render_get_target(&t);
+  render_fast_vert_line(&t, x1, y1, y2, color);
+  render_fast_vert_line(&t, x2, y1, y2, color);
+  render_fast_horiz_line(&t, x1, x2, y1, color);
+  render_fast_horiz_line(&t, x1, x2, y2, color);
 }
 
 void render2d_rectangle_filled(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, vga_color_t color) {
-  static volatile dma_channel_config config = {
-    .ctrl = DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS
-          | (DREQ_FORCE << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB)
-          | (DMA_SIZE_32 << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB)
-          | DMA_CH0_CTRL_TRIG_HIGH_PRIORITY_BITS
-          | DMA_CH0_CTRL_TRIG_EN_BITS,
-  };
-  uint32_t color32 = color | (color << 8) | (color << 16) | (color << 24);
-
-  for (int y = y1; y <= y2; y++) {
-    for (int x = x1; x <= x2; x++) {
-      render_pixel(y, x, color);
+  // Only walk the clip area (a damaged area, or a single row during line interpolation), a row at a time.
+  // Doubled lines share their row's buffer (see render_pixel()), so each row only gets filled once.
+  render_target_t t;
+  render_get_target(&t);
+  int32_t top    = MAX(y1, t.clip.y1);
+  int32_t bottom = MIN(y2, t.clip.y2);
+  int32_t left   = MAX(x1, t.clip.x1);
+  int32_t right  = MIN(x2, t.clip.x2);
+  if (top > bottom || left > right) return;
+  if (!t.base) {
+    for (int32_t y = top; y <= bottom; y++) {
+      render_fast_horiz_line(&t, left, right, y, color);
     }
+    return;
   }
-  return;
-
-  // *** Don't care about this for now ***
-
-  static uint8_t dma_chan;
-  dma_chan        = !dma_chan ? dma_claim_unused_channel(true) : dma_chan;
-  int dma_bytes   = (x2 - x1 + 1) / sizeof(uint32_t); // coordinates are inclusive
-  int spare_bytes = (x2 - x1 + 1) % sizeof(uint32_t);
-
-  // DMA one line at a time -- if a rectangle is in the middle of
-  // the screen DMA can't jump the gaps on the left and right.
-  // Handle line doubling as well: only write to doubled lines once,
-  // skip over all of the duplicates (hence the +=)
-  for (int y = y1; y < y2; y += vga_get_config()->scaled_resolution) {
-    channel_config_set_chain_to(&config, dma_chan); // Make sure chaining is off
-    dma_channel_configure(dma_chan, &config, &color32, render_get_pixel_ptr(y, x1), dma_bytes, true);
 
-    for (int x = 0; x < spare_bytes; x++) {
-      render_pixel(y, x1 + dma_bytes + x, color);
-    }
-
-    dma_channel_wait_for_finish_blocking(dma_chan);
+  uint8_t * row = t.base + (top - t.clip.y1) * t.stride + (left - t.clip.x1);
+  if (t.async && (right - left + 1) * (bottom - top + 1) >= DMA_MIN_PIXELS) {
+    render_dma_fill(row, t.stride, right - left + 1, bottom - top + 1, color, (vga_rect_t) { left, top, right, bottom });
+    return;
+  }
+  for (int32_t y = top; y <= bottom; y++, row += t.stride) {
+    render_fill_span(row, color, right - left + 1);
   }
-
-  // dma_channel_unclaim(dma_chan);
-  asm("nop");
 }
 
 void render2d_triangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, vga_color_t color) {
@@ -197,6 +235,8 @@ void render2d_triangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint1
 void render2d_triangle_filled(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t x3, uint16_t y3, vga_color_t color) {
   // Adafruit GFX slope algorithm, https://github.com/adafruit/Adafruit-GFX-Library/blob/master/Adafruit_GFX.cpp
   int32_t a, b, y, last;
+  render_target_t t;
+  render_get_target(&t);
 
   // Sort coordinates by Y order (y3 >= y2 >= y1)
   if (y1 > y2) {
@@ -213,7 +253,7 @@ void render2d_triangle_filled(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2
   }
 
   if (y1 == y3) { // Handle awkward all-on-same-line case as its own thing
-    render_fast_horiz_line(MIN(x1, MIN(x2, x3)), MAX(x1, MAX(x2, x3)), y1, color);
+    render_fast_horiz_line(&t, MIN(x1, MIN(x2, x3)), MAX(x1, MAX(x2, x3)), y1, color);
     return;
   }
 
@@ -241,7 +281,7 @@ void render2d_triangle_filled(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2
     a = x1 + sa / dy12;
     b = x1 + sb / dy13;
     sa += dx12;
-    sb += dx12;
+    sb += dx13;
     /* longhand:
     a = x1 + (x2 - x1) * (y - y1) / (y2 - y1);
     b = x1 + (x3 - x1) * (y - y1) / (y3 - y1);
@@ -249,7 +289,7 @@ void render2d_triangle_filled(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2
     if (a > b) {
       SWAP(a, b);
     }
-    render_fast_horiz_line(a, b - a + 1, y, color);
+    render_fast_horiz_line(&t, a, b, y, color);
   }
 
   // For lower part of triangle, find scanline crossings for segments
@@ -268,7 +308,7 @@ void render2d_triangle_filled(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2
     if (a > b) {
       SWAP(a, b);
     }
-    render_fast_horiz_line(a, b - a + 1, y, color);
+    render_fast_horiz_line(&t, a, b, y, color);
   }
 }
 
@@ -276,7 +316,9 @@ void render2d_circle(uint16_t x, uint16_t y, uint16_t radius, vga_color_t color)
   // Bresenham circle algorithm, https://www.geeksforgeeks.org/bresenhams-circle-drawing-algorithm/
   int32_t pixel_x = 0, pixel_y = radius;
   int32_t d = 3 - 2 * radius;
-  bresenham_circle(x, y, pixel_x, pixel_y, color);
+  render_target_t t;
+  render_get_target(&t);
+  bresenham_circle(&t, x, y, pixel_x, pixel_y, color);
   while (pixel_y >= pixel_x) {
     // check for decision parameter and correspondingly update d, y
     if (d > 0) {
@@ -290,7 +332,7 @@ void render2d_circle(uint16_t x, uint16_t y, uint16_t radius, vga_color_t color)
     pixel_x++;
 
     // Draw the circle using the new coordinates
-    bresenham_circle(x, y, pixel_x, pixel_y, color);
+    bresenham_circle(&t, x, y, pixel_x, pixel_y, color);
   }
 }
 
@@ -298,7 +340,9 @@ void render2d_circle_filled(uint16_t x, uint16_t y, uint16_t radius, vga_color_t
   // Bresenham circle algorithm, modified for a filled circle
   int32_t pixel_x = 0, pixel_y = radius;
   int32_t d = 3 - 2 * radius;
-  bresenham_circle_filled(x, y, pixel_x, pixel_y, color);
+  render_target_t t;
+  render_get_target(&t);
+  bresenham_circle_filled(&t, x, y, pixel_x, pixel_y, color);
   while (pixel_y >= pixel_x) {
     // check for decision parameter and correspondingly update d, y
     if (d > 0) {
@@ -312,103 +356,60 @@ void render2d_circle_filled(uint16_t x, uint16_t y, uint16_t radius, vga_color_t
     pixel_x++;
 
     // Draw the circle using the new coordinates
-    bresenham_circle_filled(x, y, pixel_x, pixel_y, color);
+    bresenham_circle_filled(&t, x, y, pixel_x, pixel_y, color);
   }
 }
 
 void render2d_polygon(uint16_t points[][2], uint16_t num_points, vga_color_t color) {
-  for (int i = 0; i < num_points; i++) {
-    render2d_line(points[i][POINT_X], points[i + 1][POINT_X], points[i][POINT_Y], points[i + 1][POINT_Y], color);
+  for (uint32_t i = 0; i < num_points; i++) {
+    uint32_t next = (i + 1) % num_points; // The last point joins back up with the first
+    render2d_line(points[i][POINT_X], points[i][POINT_Y], points[next][POINT_X], points[next][POINT_Y], color);
   }
-  render2d_line(points[num_points][POINT_X], points[0][POINT_X], points[num_points][POINT_Y], points[0][POINT_Y], color);
 }
 
 void render2d_polygon_filled(uint16_t points[][2], const uint16_t num_points, vga_color_t color) {
-  // Sunshine's polygon filling algorithm applet, http://www.sunshine2k.de/coding/java/Polygon/Filling/FillPolygon.htm
-  enum {
-    EDGE_TOP = 0, //"top" point, higher on the screen/smaller y coordinate
-    EDGE_BOT,
-  };
-  // turn points into edges
-  uint16_t * edges[num_points][2]; // Pairs of points, !! could be large !!
-  uint32_t i;
-  for (i = 0; i < num_points; i++) {
-    // put the edge in Y-order (top to bottom)
-    if (points[i][POINT_Y] < points[i + 1][POINT_Y]) {
-      edges[i][EDGE_TOP] = points[i];
-      edges[i][EDGE_BOT] = points[(i + 1) % num_points];
-    } else {
-      edges[i][EDGE_TOP] = points[(i + 1) % num_points];
-      edges[i][EDGE_BOT] = points[i];
-    }
-  }
-
-  // sort edges in y-order (selection sort)
-  for (i = 0; i < num_points - 1u; i++) {
-    uint32_t j              = i + 1;
-    uint32_t smallest_y_idx = j;
-    for (; j < num_points; j++) {
-      if (edges[j][EDGE_TOP][POINT_Y] < edges[smallest_y_idx][EDGE_TOP][POINT_Y]) {
-        smallest_y_idx = j;
-      }
-    }
-    if (smallest_y_idx != i) {
-      SWAP(edges[i][EDGE_TOP], edges[smallest_y_idx][EDGE_TOP]);
-      SWAP(edges[i][EDGE_BOT], edges[smallest_y_idx][EDGE_BOT]);
-    }
+  // Even-odd scanline fill. Every row crosses the edges an even number of times, and the polygon is between each
+  // pair of crossings. An edge covers the rows from its top up to, not including, its bottom, so a vertex between two
+  // edges is only crossed once. The bottom row of the polygon is the exception, there every edge ends.
+  render_target_t t;
+  render_get_target(&t);
+  if (num_points == 0) return;
+
+  int32_t top = points[0][POINT_Y], bottom = points[0][POINT_Y];
+  for (uint32_t i = 1; i < num_points; i++) {
+    top    = MIN(top, points[i][POINT_Y]);
+    bottom = MAX(bottom, points[i][POINT_Y]);
   }
 
-  // find the largest y value (NOT guaranteed by edges sorting)
-  uint32_t largest_y = 0;
-  for (i = 0; i < num_points; i++) {
-    if (points[i][POINT_Y] > largest_y) {
-      largest_y = points[i][POINT_Y];
-    }
-  }
-
-  // loop through each scanline
-  uint16_t x_coords[num_points]; // !!! can be large !!!
-  uint32_t x_coords_idx = 0;
-  for (i = edges[0][EDGE_TOP][POINT_Y]; i < largest_y; i++) {
-    uint32_t j;
-    // find edges cut by the scanline
-    for (j = 0; j < num_points; i++) {
-      if (edges[j][EDGE_TOP][POINT_Y] == i) { // reached the top of an edge
-        if (edges[j][EDGE_BOT][POINT_Y] == i) {
-          x_coords[x_coords_idx++] = edges[j][EDGE_TOP][POINT_X]; // horizontal edge, add both ends
-          x_coords[x_coords_idx++] = edges[j][EDGE_TOP][POINT_X];
+  int32_t x_coords[num_points]; // An edge crosses a row at most once, !!! can be large !!!
+  for (int32_t y = MAX(top, t.clip.y1); y <= MIN(bottom, t.clip.y2); y++) {
+    uint32_t num_x = 0;
+    for (uint32_t i = 0; i < num_points; i++) {
+      int32_t x1 = points[i][POINT_X], y1 = points[i][POINT_Y];
+      int32_t x2 = points[(i + 1) % num_points][POINT_X], y2 = points[(i + 1) % num_points][POINT_Y];
+      if (y1 == y2) {
+        if (y1 == y) {
+          render_fast_horiz_line(&t, x1, x2, y, color); // Horizontal edges don't cross anything, draw them as they are
         }
-      } else if (edges[j][EDGE_BOT][POINT_Y] == i) { // reached the bottom of an edge
-        x_coords[x_coords_idx++] = edges[j][EDGE_BOT][POINT_X];
-      } else { // somewhere in the middle
-        x_coords[x_coords_idx++] = 1;
-
-        // point slope (y - y1) = m(x - x1) -> (y - y1)/m + x1 = x TODO
+        continue;
       }
-    }
-
-    if (x_coords_idx < 2 || x_coords_idx % 2 != 0) {
-      // this should never happen with a legal polygon
-      continue;
-    }
-
-    // sort x coordinates ascending (selection sort)
-    for (j = 0; j < num_points - 1u; j++) {
-      uint32_t k              = j + 1;
-      uint32_t smallest_x_idx = k;
-      for (; k < num_points; k++) {
-        if (x_coords[k] < x_coords[smallest_x_idx]) {
-          smallest_x_idx = k;
-        }
+      if (y1 > y2) {
+        SWAP(x1, x2);
+        SWAP(y1, y2);
       }
-      if (smallest_x_idx != j) {
-        SWAP(x_coords[j], x_coords[smallest_x_idx]);
+      if (y < y1 || y > y2 || (y == y2 && y2 != bottom)) continue;
+
+      // Insertion sort, left to right
+      int32_t x = x1 + (x2 - x1) * (y - y1) / (y2 - y1);
+      uint32_t j = num_x++;
+      for (; j > 0 && x_coords[j - 1] > x; j--) {
+        x_coords[j] = x_coords[j - 1];
       }
+      x_coords[j] = x;
     }
 
-    // draw between each pair of points
-    for (j = 0; j < x_coords_idx; j += 2) {
-      render_fast_horiz_line(x_coords[j], x_coords[j + 1], i, color);
+    for (uint32_t j = 0; j + 1 < num_x; j += 2) {
+      render_fast_horiz_line(&t, x_coords[j], x_coords[j + 1], y, color);
     }
   }
 }
@@ -416,33 +417,77 @@ void render2d_polygon_filled(uint16_t points[][2], const uint16_t num_points, vg
 void render2d_string(char * str, uint16_t x1, uint16_t y, uint16_t x2, bool wrap, vga_color_t color) {
   uint16_t cursor_x = x1; // in pixels
   uint16_t cursor_y = y;
+  render_target_t t;
+  render_get_target(&t);
   for (int i = 0; str[i] != '\0'; i++) {
-    for (int bit_y = 0; bit_y < FONT_HEIGHT; bit_y++) {
+    // Skip glyph rows outside of the rows being rendered (everything but one row during line interpolation)
+    int bit_y_start = MAX(0, (int) t.clip.y1 - cursor_y);
+    int bit_y_end   = MIN(FONT_HEIGHT, (int) t.clip.y2 - cursor_y + 1);
+    for (int bit_y = bit_y_start; bit_y < bit_y_end; bit_y++) {
       for (int bit_x = 0; bit_x < FONT_WIDTH; bit_x++) {
-        if (GET_BIT(draw2d_get_font()[i], bit_x)) {
+        if (GET_BIT(draw2d_get_font()[(uint8_t) str[i] * FONT_HEIGHT + bit_y], bit_x)) {
           // bits are grabbed right -> left (0 -> 5), but need to be rendered left -> right
-          render_pixel(cursor_y + bit_y, cursor_x + (FONT_WIDTH - bit_x), color);
+          render_clipped_pixel(&t, cursor_x + (FONT_WIDTH - bit_x), cursor_y + bit_y, color);
         }
       }
     }
     cursor_x = (cursor_x + FONT_WIDTH + FONT_SPACING);
     if (wrap) {
       if (cursor_x > x2) {
-        cursor_x = x2;
+        cursor_x = x1;
         cursor_y += FONT_HEIGHT;
       }
-    } else if (cursor_x > vga_get_width()) { // Make sure we can't run off into random memory
-      cursor_x = vga_get_width();
+    } else if (cursor_x > vga_get_playfield_width()) { // Make sure we can't run off into random memory
+      cursor_x = vga_get_playfield_width();
     }
   }
 }
 
+// Sprite without any null color pixels, copied in a row at a time
+void render2d_blit(vga_color_t * sprite, uint16_t x, uint16_t y, uint16_t size_x, uint16_t size_y) {
+  render_target_t t;
+  render_get_target(&t);
+  int32_t i_start = MAX(0, (int32_t) t.clip.y1 - y);
+  int32_t i_end   = MIN(size_y, (int32_t) t.clip.y2 - y + 1);
+  int32_t j_start = MAX(0, (int32_t) t.clip.x1 - x);
+  int32_t j_end   = MIN(size_x, (int32_t) t.clip.x2 - x + 1);
+  if (i_start >= i_end || j_start >= j_end) return;
+  if (!t.base) {
+    for (int32_t i = i_start; i < i_end; i++) {
+      for (int32_t j = j_start; j < j_end; j++) {
+        render_pixel(y + i, x + j, sprite[i * size_x + j]);
+      }
+    }
+    return;
+  }
+
+  const vga_color_t * src = sprite + i_start * size_x + j_start;
+  uint8_t * dst           = t.base + (y + i_start - t.clip.y1) * t.stride + (x + j_start - t.clip.x1);
+  uint16_t width          = j_end - j_start;
+  uint16_t height         = i_end - i_start;
+  if (t.async && width * height >= DMA_MIN_PIXELS) {
+    render_dma_blit(dst, t.stride, src, size_x, width, height, (vga_rect_t) { x + j_start, y + i_start, x + j_end - 1, y + i_end - 1 });
+    return;
+  }
+  for (uint16_t i = 0; i < height; i++, dst += t.stride, src += size_x) {
+    memcpy(dst, src, width);
+  }
+  render_count_pixels((uint32_t) width * height);
+}
+
 void render2d_sprite(vga_color_t * sprite, uint16_t x, uint16_t y, uint16_t size_x, uint16_t size_y, vga_color_t null_color) {
-  for (uint32_t i = 0; i < size_y; i++) {
-    for (uint32_t j = 0; j < size_x; j++) {
+  // Only the part of the sprite inside the clip area
+  render_target_t t;
+  render_get_target(&t);
+  int32_t i_start = MAX(0, (int32_t) t.clip.y1 - y);
+  int32_t i_end   = MIN(size_y, (int32_t) t.clip.y2 - y + 1);
+  int32_t j_start = MAX(0, (int32_t) t.clip.x1 - x);
+  int32_t j_end   = MIN(size_x, (int32_t) t.clip.x2 - x + 1);
+  for (int32_t i = i_start; i < i_end; i++) {
+    for (int32_t j = j_start; j < j_end; j++) {
       vga_color_t color = *((sprite + size_x * i) + j);
       if (color != null_color) {
-        render_pixel(y + i, x + j, color);
+        render_target_pixel(&t, x + j, y + i, color);
       }
     }
   }
@@ -0,0 +1,194 @@
+#include "../common.h"
+#include "hardware/dma.h"
+#include "pico/platform.h"
+#include "render.h"
+#include "vga.h"
+
+/************************************
+ * EXTERN VARIABLES
+ ************************************/
+
+/************************************
+ * PRIVATE MACROS AND DEFINES
+ ************************************/
+
+/************************************
+ * PRIVATE TYPEDEFS
+ ************************************/
+
+// One row of a fill or blit, laid out like a DMA channel's alias 3 registers (CTRL, WRITE_ADDR, TRANS_COUNT,
+// READ_ADDR_TRIG). The control channel copies it into the data channel, and writing read_addr starts the row.
+// Addresses are 32 bit words like the registers they go into, not pointers.
+typedef struct {
+  uint32_t ctrl;
+  uint32_t write_addr;
+  uint32_t count;
+  uint32_t read_addr; // 0 ends the chain
+} dma_row_t;
+
+/************************************
+ * STATIC VARIABLES
+ ************************************/
+
+static int data_chan = -1; // Does the copying, one row per transfer, at normal bus priority (below the scanout)
+static int ctrl_chan = -1; // Loads the next row into data_chan every time it finishes
+
+static dma_row_t rows[PV_RENDER_DMA_ROWS + 1]; // +1 for the NULL at the end
+static uint32_t fill_color32;                  // What fills read from, the color in all 4 bytes
+
+// Screen area the DMA is writing to, while pending is set
+static volatile bool pending = false;
+static vga_rect_t pending_area;
+
+/************************************
+ * STATIC FUNCTIONS
+ ************************************/
+
+static uint32_t row_ctrl(enum dma_channel_transfer_size size, bool read_increment) {
+  dma_channel_config c = dma_channel_get_default_config(data_chan); // Unpaced, normal priority
+  channel_config_set_transfer_data_size(&c, size);
+  channel_config_set_read_increment(&c, read_increment);
+  channel_config_set_write_increment(&c, true);
+  channel_config_set_chain_to(&c, ctrl_chan);
+  channel_config_set_irq_quiet(&c, true); // Only the NULL at the end raises the (unused) IRQ flag, see render_dma_wait()
+  return channel_config_get_ctrl_value(&c);
+}
+
+// End the chain after num_rows and start it. Whatever was queued before has to be done.
+static void kick(uint16_t num_rows, uint32_t ctrl, vga_rect_t area) {
+  rows[num_rows] = (dma_row_t) { ctrl, 0, 0, 0 };
+
+  pending_area = area;
+  pending      = true;
+  dma_hw->intr = 1u << data_chan;
+  __compiler_memory_barrier(); // Rows have to be written out before the DMA reads them
+  dma_channel_set_read_addr(ctrl_chan, rows, true);
+}
+
+static inline bool is_done() {
+  return !pending || (dma_hw->intr & (1u << data_chan));
+}
+
+/************************************
+ * GLOBAL FUNCTIONS
+ ************************************/
+
+/**
+ * @brief Claim the DMA engine's channels the first time, and stop anything left running from before a vga_deinit().
+ *
+ */
+void render_dma_init() {
+  if (data_chan < 0) {
+    data_chan = dma_claim_unused_channel(true); // Kept across vga_deinit()/vga_init()
+    ctrl_chan = dma_claim_unused_channel(true);
+  }
+  dma_channel_abort(ctrl_chan);
+  dma_channel_abort(data_chan);
+  pending = false;
+
+  // Copies one dma_row_t into data_chan's alias 3 registers, wrapping the writes around them
+  dma_channel_config c = dma_channel_get_default_config(ctrl_chan);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, true);
+  channel_config_set_ring(&c, true, 4); // 16 bytes
+  dma_channel_configure(ctrl_chan, &c, &dma_hw->ch[data_chan].al3_ctrl, rows, 4, false);
+}
+
+/**
+ * @brief Fill a rectangle of 8 bit pixels in the background. Returns as soon as the DMA has started on it (or on
+ * the last PV_RENDER_DMA_ROWS rows of it). The DMA does the word aligned middle of each row, the CPU does the few
+ * bytes on either end right away.
+ *
+ * @param dst Top left pixel
+ * @param stride Bytes from one row to the next
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param color Color to fill with
+ * @param area Screen area this covers, for render_dma_wait_for()
+ */
+void render_dma_fill(uint8_t * dst, uint32_t stride, uint16_t width, uint16_t height, vga_color_t color, vga_rect_t area) {
+  render_dma_wait();
+  fill_color32 = color * 0x01010101u;
+
+  // Rows that follow straight on from each other are one long row
+  uint32_t len = width;
+  if (stride == width) {
+    len    = (uint32_t) width * height;
+    height = 1;
+  }
+
+  uint32_t ctrl   = row_ctrl(DMA_SIZE_32, false);
+  uint16_t queued = 0;
+  for (uint16_t y = 0; y < height; y++, dst += stride) {
+    uint32_t head  = MIN(-(uintptr_t) dst & 3, len);
+    uint32_t words = (len - head) / 4;
+    uint32_t tail  = len - head - words * 4;
+    if (head) render_fill_span(dst, color, head);
+    if (tail) render_fill_span(dst + head + words * 4, color, tail);
+    if (!words) continue;
+
+    if (queued == PV_RENDER_DMA_ROWS) {
+      kick(queued, ctrl, area);
+      render_dma_wait();
+      queued = 0;
+    }
+    rows[queued++] = (dma_row_t) { ctrl, (uintptr_t) (dst + head), words, (uintptr_t) &fill_color32 };
+    render_count_pixels(words * 4); // The head and tail count themselves
+  }
+  if (queued) kick(queued, ctrl, area);
+}
+
+/**
+ * @brief Copy a rectangle of 8 bit pixels in the background, like render_dma_fill(). The source can't change until
+ * the copy is done. Copies a word at a time when everything lines up, a byte at a time otherwise.
+ *
+ * @param dst Top left pixel to copy to
+ * @param stride Bytes from one destination row to the next
+ * @param src Top left pixel to copy from
+ * @param src_stride Bytes from one source row to the next
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param area Screen area this covers, for render_dma_wait_for()
+ */
+void render_dma_blit(uint8_t * dst, uint32_t stride, const uint8_t * src, uint32_t src_stride, uint16_t width, uint16_t height, vga_rect_t area) {
+  render_dma_wait();
+
+  bool by_word    = (((uintptr_t) dst | (uintptr_t) src | stride | src_stride | width) & 3) == 0;
+  uint32_t ctrl   = row_ctrl(by_word ? DMA_SIZE_32 : DMA_SIZE_8, true);
+  uint32_t count  = by_word ? width / 4 : width;
+  uint16_t queued = 0;
+  for (uint16_t y = 0; y < height; y++, dst += stride, src += src_stride) {
+    if (queued == PV_RENDER_DMA_ROWS) {
+      kick(queued, ctrl, area);
+      render_dma_wait();
+      queued = 0;
+    }
+    rows[queued++] = (dma_row_t) { ctrl, (uintptr_t) dst, count, (uintptr_t) src };
+  }
+  render_count_pixels((uint32_t) width * height);
+  if (queued) kick(queued, ctrl, area);
+}
+
+/**
+ * @brief Wait for the DMA engine to finish whatever it's doing.
+ *
+ */
+void render_dma_wait() {
+  while (!is_done()) {
+    tight_loop_contents();
+  }
+  pending = false;
+}
+
+/**
+ * @brief Wait for the DMA engine only if it's writing somewhere in area, so drawing over it keeps the render queue order.
+ *
+ * @param area Screen area about to be drawn to
+ */
+void render_dma_wait_for(vga_rect_t area) {
+  if (!pending) return;
+  if (area.x1 <= pending_area.x2 && pending_area.x1 <= area.x2 && area.y1 <= pending_area.y2 && pending_area.y1 <= area.y2) {
+    render_dma_wait();
+  }
+}
@@ -0,0 +1,416 @@
+#include "render.h"
+
+#include "../common.h"
+#include "font.h"
+#include "pico/assert.h"
+#include "vga.h"
+
+#include <string.h>
+
+/************************************
+ * EXTERN VARIABLES
+ ************************************/
+
+/************************************
+ * PRIVATE MACROS AND DEFINES
+ ************************************/
+
+/************************************
+ * PRIVATE TYPEDEFS
+ ************************************/
+
+/************************************
+ * STATIC VARIABLES
+ ************************************/
+
+// Rows each render queue item covers, computed once per frame
+static uint16_t item_top[PV_SCANLINE_MAX_ITEMS];
+static uint16_t item_bottom[PV_SCANLINE_MAX_ITEMS];
+
+// Shown items sorted by top row, and how far down that list the renderer has gotten this frame
+static uint16_t by_top[PV_SCANLINE_MAX_ITEMS];
+static uint16_t num_items = 0;
+static uint16_t next_item = 0;
+
+// Items that cover the current row, in render queue order (so layering still works)
+static uint16_t active[PV_SCANLINE_MAX_ITEMS];
+static uint16_t num_active = 0;
+
+static int32_t last_y = -1;
+
+/************************************
+ * STATIC FUNCTIONS
+ ************************************/
+
+// Integer square root (no hardware divider/FPU help for this on the RP2040)
+static uint32_t isqrt(uint32_t n) {
+  uint32_t root = 0;
+  uint32_t bit  = 1u << 30;
+  while (bit > n) bit >>= 2;
+  while (bit) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+static inline void span(uint8_t * line, int32_t x1, int32_t x2, vga_color_t color) {
+  x1 = MAX(x1, 0);
+  x2 = MIN(x2, (int32_t) vga_get_width() - 1);
+  if (x1 > x2) return;
+  memset(line + x1, color, x2 - x1 + 1);
+  render_count_pixels(x2 - x1 + 1);
+}
+
+static inline void dot(uint8_t * line, int32_t x, vga_color_t color) {
+  if (x >= 0 && x < vga_get_width()) {
+    line[x] = color;
+    render_count_pixels(1);
+  }
+}
+
+// The part of a line that crosses row y
+static void line_span(uint8_t * line, int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t y, vga_color_t color) {
+  if (y < MIN(y1, y2) || y > MAX(y1, y2)) return;
+  if (y1 == y2) {
+    span(line, MIN(x1, x2), MAX(x1, x2), color);
+    return;
+  }
+  if (y1 > y2) {
+    SWAP(x1, x2);
+    SWAP(y1, y2);
+  }
+
+  // x where the line crosses the top and bottom edges of this row (half a pixel above and below the center)
+  int32_t dx = x2 - x1;
+  int32_t dy = y2 - y1;
+  int32_t xa = RANGE(x1 + (dx * (2 * (y - y1) - 1)) / (2 * dy), MIN(x1, x2), MAX(x1, x2));
+  int32_t xb = RANGE(x1 + (dx * (2 * (y - y1) + 1)) / (2 * dy), MIN(x1, x2), MAX(x1, x2));
+
+  // The pixel on the edge belongs to the next row
+  if (xb > xa) {
+    xb--;
+  } else if (xb < xa) {
+    xb++;
+  }
+  span(line, MIN(xa, xb), MAX(xa, xb), color);
+}
+
+static void triangle_span(uint8_t * line, const vga_render_item_t * item, int32_t y) {
+  int32_t x_min = INT32_MAX;
+  int32_t x_max = INT32_MIN;
+  for (int i = 0; i < 3; i++) {
+    int32_t x1 = item->item_2d.point.x[i], y1 = item->item_2d.point.y[i];
+    int32_t x2 = item->item_2d.point.x[(i + 1) % 3], y2 = item->item_2d.point.y[(i + 1) % 3];
+    if (y < MIN(y1, y2) || y > MAX(y1, y2)) continue;
+
+    if (y1 == y2) {
+      x_min = MIN(x_min, MIN(x1, x2));
+      x_max = MAX(x_max, MAX(x1, x2));
+    } else {
+      int32_t x = x1 + (x2 - x1) * (y - y1) / (y2 - y1);
+      x_min     = MIN(x_min, x);
+      x_max     = MAX(x_max, x);
+    }
+  }
+  span(line, x_min, x_max, item->item_2d.color);
+}
+
+static void circle_span(uint8_t * line, const vga_render_item_t * item, int32_t y, bool filled) {
+  int32_t r  = item->item_2d.point.x[0];
+  int32_t d  = ABS(y - (int32_t) item->item_2d.y);
+  int32_t cx = item->item_2d.x;
+  if (d > r) return;
+
+  int32_t half_width = isqrt(r * r - d * d);
+  if (filled) {
+    span(line, cx - half_width, cx + half_width, item->item_2d.color);
+    return;
+  }
+
+  // Fill the gap between this row's edge and the next row out, so steep parts of the circle stay connected
+  int32_t outer = d < r ? (int32_t) isqrt(r * r - (d + 1) * (d + 1)) : -1;
+  int32_t inner = MIN(outer + 1, half_width);
+  span(line, cx - half_width, cx - inner, item->item_2d.color);
+  span(line, cx + inner, cx + half_width, item->item_2d.color);
+}
+
+static void polygon_filled_span(uint8_t * line, const vga_render_item_t * item, int32_t y) {
+  uint16_t(*points)[2] = item->item_2d.points_arr.points;
+  uint16_t num_points  = item->item_2d.points_arr.num_points;
+  int32_t x_coords[num_points]; // !!! can be large !!!
+  uint32_t num_x = 0;
+
+  // Even-odd rule: find every edge the row crosses (top inclusive, bottom exclusive so vertices aren't counted twice)
+  for (uint32_t i = 0; i < num_points; i++) {
+    int32_t x1 = points[i][POINT_X], y1 = points[i][POINT_Y];
+    int32_t x2 = points[(i + 1) % num_points][POINT_X], y2 = points[(i + 1) % num_points][POINT_Y];
+    if (y1 == y2 || y < MIN(y1, y2) || y >= MAX(y1, y2)) continue;
+
+    int32_t x = x1 + (x2 - x1) * (y - y1) / (y2 - y1);
+
+    // insertion sort, ascending
+    uint32_t j = num_x++;
+    for (; j > 0 && x_coords[j - 1] > x; j--) {
+      x_coords[j] = x_coords[j - 1];
+    }
+    x_coords[j] = x;
+  }
+
+  for (uint32_t i = 0; i + 1 < num_x; i += 2) {
+    span(line, x_coords[i], x_coords[i + 1], item->item_2d.color);
+  }
+}
+
+static void string_span(uint8_t * line, const vga_render_item_t * item, int32_t y) {
+  const char * str  = item->item_2d.str.str;
+  const uint8_t * f = draw2d_get_font();
+  int32_t cursor_x  = item->item_2d.x;
+  int32_t cursor_y  = item->item_2d.y;
+
+  for (int i = 0; str[i] != '\0' && cursor_y <= y; i++) {
+    int32_t bit_y = y - cursor_y;
+    if (bit_y < FONT_HEIGHT) {
+      uint8_t bits = f[(uint8_t) str[i] * FONT_HEIGHT + bit_y];
+      for (int bit_x = 0; bit_x < FONT_WIDTH; bit_x++) {
+        if (GET_BIT(bits, bit_x)) {
+          // bits are grabbed right -> left (0 -> 5), but need to be rendered left -> right
+          dot(line, cursor_x + (FONT_WIDTH - bit_x), item->item_2d.color);
+        }
+      }
+    }
+
+    // Same cursor movement as render2d_string()
+    cursor_x = cursor_x + FONT_WIDTH + FONT_SPACING;
+    if (item->header.flags.wordwrap && cursor_x > item->item_2d.str.x2) {
+      cursor_x = item->item_2d.x;
+      cursor_y += FONT_HEIGHT;
+    }
+  }
+}
+
+static void sprite_span(uint8_t * line, const vga_render_item_t * item, int32_t y) {
+  const vga_color_t * row = item->item_2d.sprite.sprite + (y - item->item_2d.y) * item->item_2d.sprite.size_x;
+  for (int32_t j = 0; j < item->item_2d.sprite.size_x; j++) {
+    if (row[j] != item->item_2d.sprite.null_color) {
+      dot(line, item->item_2d.x + j, row[j]);
+    }
+  }
+}
+
+// Draw the part of an item that's on row y
+static void item_span(uint8_t * line, const vga_render_item_t * item, int32_t y) {
+  switch (item->header.type) {
+    case VGA_RENDER_ITEM_FILL:
+      span(line, 0, vga_get_width() - 1, item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_PIXEL:
+      dot(line, item->item_2d.x, item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_LINE:
+      line_span(line, item->item_2d.point.x[0], item->item_2d.point.y[0], item->item_2d.point.x[1], item->item_2d.point.y[1], y, item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_RECTANGLE:
+      if (y == item->item_2d.point.y[0] || y == item->item_2d.point.y[1]) {
+        span(line, item->item_2d.point.x[0], item->item_2d.point.x[1], item->item_2d.color);
+      } else {
+        dot(line, item->item_2d.point.x[0], item->item_2d.color);
+        dot(line, item->item_2d.point.x[1], item->item_2d.color);
+      }
+      break;
+    case VGA_RENDER_ITEM_FILLED_RECTANGLE:
+      span(line, item->item_2d.point.x[0], item->item_2d.point.x[1], item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_TRIANGLE:
+      for (int i = 0; i < 3; i++) {
+        line_span(line, item->item_2d.point.x[i], item->item_2d.point.y[i], item->item_2d.point.x[(i + 1) % 3], item->item_2d.point.y[(i + 1) % 3], y, item->item_2d.color);
+      }
+      break;
+    case VGA_RENDER_ITEM_FILLED_TRIANGLE:
+      triangle_span(line, item, y);
+      break;
+    case VGA_RENDER_ITEM_CIRCLE:
+      circle_span(line, item, y, false);
+      break;
+    case VGA_RENDER_ITEM_FILLED_CIRCLE:
+      circle_span(line, item, y, true);
+      break;
+    case VGA_RENDER_ITEM_STRING:
+      string_span(line, item, y);
+      break;
+    case VGA_RENDER_ITEM_SPRITE:
+      sprite_span(line, item, y);
+      break;
+    case VGA_RENDER_ITEM_POLYGON: {
+      uint16_t(*points)[2] = item->item_2d.points_arr.points;
+      uint16_t num_points  = item->item_2d.points_arr.num_points;
+      for (uint32_t i = 0; i < num_points; i++) {
+        line_span(line, points[i][POINT_X], points[i][POINT_Y], points[(i + 1) % num_points][POINT_X], points[(i + 1) % num_points][POINT_Y], y, item->item_2d.color);
+      }
+      break;
+    }
+    case VGA_RENDER_ITEM_FILLED_POLYGON:
+      polygon_filled_span(line, item, y);
+      break;
+    case VGA_RENDER_ITEM_BITMAP:
+    case VGA_RENDER_ITEM_LIGHT:
+    case VGA_RENDER_ITEM_SVG:
+    case VGA_RENDER_ITEM_MAX:
+    default:
+      break;
+  }
+}
+
+// True if the item's span on a row covers the whole row (everything under it is hidden)
+static bool item_covers_row(const vga_render_item_t * item) {
+  return item->header.type == VGA_RENDER_ITEM_FILL
+      || (item->header.type == VGA_RENDER_ITEM_FILLED_RECTANGLE && item->item_2d.point.x[0] == 0 && item->item_2d.point.x[1] >= vga_get_width() - 1);
+}
+
+// Rows an item covers. Returns false if it doesn't cover any.
+static bool item_rows(const vga_render_item_t * item, int32_t * top, int32_t * bottom) {
+  switch (item->header.type) {
+    case VGA_RENDER_ITEM_FILL:
+      *top    = 0;
+      *bottom = vga_get_height() - 1;
+      break;
+    case VGA_RENDER_ITEM_PIXEL:
+      *top    = item->item_2d.y;
+      *bottom = item->item_2d.y;
+      break;
+    case VGA_RENDER_ITEM_LINE:
+    case VGA_RENDER_ITEM_RECTANGLE:
+    case VGA_RENDER_ITEM_FILLED_RECTANGLE:
+      *top    = MIN(item->item_2d.point.y[0], item->item_2d.point.y[1]);
+      *bottom = MAX(item->item_2d.point.y[0], item->item_2d.point.y[1]);
+      break;
+    case VGA_RENDER_ITEM_TRIANGLE:
+    case VGA_RENDER_ITEM_FILLED_TRIANGLE:
+      *top    = MIN(item->item_2d.point.y[0], MIN(item->item_2d.point.y[1], item->item_2d.point.y[2]));
+      *bottom = MAX(item->item_2d.point.y[0], MAX(item->item_2d.point.y[1], item->item_2d.point.y[2]));
+      break;
+    case VGA_RENDER_ITEM_CIRCLE:
+    case VGA_RENDER_ITEM_FILLED_CIRCLE:
+      *top    = (int32_t) item->item_2d.y - item->item_2d.point.x[0];
+      *bottom = (int32_t) item->item_2d.y + item->item_2d.point.x[0];
+      break;
+    case VGA_RENDER_ITEM_STRING:
+      *top    = item->item_2d.y;
+      *bottom = item->header.flags.wordwrap ? vga_get_height() - 1 : item->item_2d.y + FONT_HEIGHT - 1; // Don't know how far it wraps
+      break;
+    case VGA_RENDER_ITEM_SPRITE:
+      *top    = item->item_2d.y;
+      *bottom = (int32_t) item->item_2d.y + item->item_2d.sprite.size_y - 1;
+      break;
+    case VGA_RENDER_ITEM_POLYGON:
+    case VGA_RENDER_ITEM_FILLED_POLYGON:
+      *top    = INT32_MAX;
+      *bottom = INT32_MIN;
+      for (uint32_t i = 0; i < item->item_2d.points_arr.num_points; i++) {
+        *top    = MIN(*top, item->item_2d.points_arr.points[i][POINT_Y]);
+        *bottom = MAX(*bottom, item->item_2d.points_arr.points[i][POINT_Y]);
+      }
+      break;
+    default:
+      return false;
+  }
+
+  *top    = MAX(*top, 0);
+  *bottom = MIN(*bottom, vga_get_height() - 1);
+  return *top <= *bottom;
+}
+
+// Start of a new frame: run animations, then sort everything that's shown by its top row
+static void build_item_list() {
+  const vga_config_t * config = vga_get_config();
+  vga_render_item_t * rq      = config->render_queue;
+
+  // vga_init() won't take a longer render queue, so this only goes off if it grew afterwards
+  assert(config->render_queue_len <= PV_SCANLINE_MAX_ITEMS);
+
+  num_items  = 0;
+  next_item  = 0;
+  num_active = 0;
+  for (uint16_t i = 0; i < MIN(config->render_queue_len, PV_SCANLINE_MAX_ITEMS); i++) {
+    if (rq[i].animate) {
+      rq[i].animate((struct vga_render_item_t *) &rq[i]);
+    }
+    rq[i].header.flags.update = false;
+
+    int32_t top, bottom;
+    if (!rq[i].header.flags.shown || !item_rows(&rq[i], &top, &bottom)) continue;
+    item_top[i]    = top;
+    item_bottom[i] = bottom;
+
+    // insertion sort by top row
+    uint16_t j = num_items++;
+    for (; j > 0 && item_top[by_top[j - 1]] > top; j--) {
+      by_top[j] = by_top[j - 1];
+    }
+    by_top[j] = i;
+  }
+}
+
+/************************************
+ * GLOBAL FUNCTIONS
+ ************************************/
+
+/**
+ * @brief Renderer v2. Draws one line of the screen straight from the render queue, only
+ * looking at the items that cover that line. Called from the line interpolation IRQ,
+ * once per line, top to bottom.
+ *
+ * @param y Row to render, in screen space
+ * @param line Line buffer to write into (vga_get_width() bytes)
+ */
+void __not_in_flash_func(render_scanline)(uint16_t y, uint8_t * line) {
+  vga_render_item_t * rq = vga_get_config()->render_queue;
+
+  if ((int32_t) y <= last_y) {
+    build_item_list();
+  }
+  last_y = y;
+
+  // Drop items that ended above this row
+  uint16_t kept = 0;
+  for (uint16_t i = 0; i < num_active; i++) {
+    if (item_bottom[active[i]] >= y) {
+      active[kept++] = active[i];
+    }
+  }
+  num_active = kept;
+
+  // Add items that start on this row (or on a row that got skipped), keeping render queue order
+  for (; next_item < num_items && item_top[by_top[next_item]] <= y; next_item++) {
+    uint16_t item = by_top[next_item];
+    if (item_bottom[item] < y) continue;
+
+    uint16_t j = num_active++;
+    for (; j > 0 && active[j - 1] > item; j--) {
+      active[j] = active[j - 1];
+    }
+    active[j] = item;
+  }
+
+  // Anything under the last item that covers the whole row is hidden, don't bother drawing it
+  int32_t start = 0;
+  for (int32_t i = num_active - 1; i >= 0; i--) {
+    if (item_covers_row(&rq[active[i]])) {
+      start = i;
+      break;
+    }
+  }
+  if (start == 0 && (num_active == 0 || !item_covers_row(&rq[active[0]]))) {
+    memset(line, COLOR_BLACK, vga_get_width());
+    render_count_pixels(vga_get_width());
+  }
+
+  for (int32_t i = start; i < num_active; i++) {
+    item_span(line, &rq[active[i]], y);
+  }
+}
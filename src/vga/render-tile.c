@@ -0,0 +1,60 @@
+#include "render.h"
+
+#include "../common.h"
+#include "vga.h"
+
+#include <string.h>
+
+/************************************
+ * EXTERN VARIABLES
+ ************************************/
+
+/************************************
+ * PRIVATE MACROS AND DEFINES
+ ************************************/
+
+/************************************
+ * PRIVATE TYPEDEFS
+ ************************************/
+
+/************************************
+ * STATIC VARIABLES
+ ************************************/
+
+/************************************
+ * STATIC FUNCTIONS
+ ************************************/
+
+/************************************
+ * GLOBAL FUNCTIONS
+ ************************************/
+
+/**
+ * @brief Build one line of the screen from the tilemap. Called from the line interpolation IRQ.
+ *
+ * @param y Row to build, in screen space
+ * @param line Line buffer to write into (vga_get_width() bytes)
+ */
+void __not_in_flash_func(render_tile_line)(uint16_t y, uint8_t * line) {
+  const vga_tilemap_t * tm = vga_get_config()->tilemap;
+  uint16_t width           = vga_get_width();
+  uint32_t map_width_px    = tm->map_width * PV_TILE_SIZE;
+
+  // Everything wraps around, so the map can be smaller than the screen and scrolling never runs off the end
+  uint32_t map_y           = (y + tm->scroll_y) % (tm->map_height * PV_TILE_SIZE);
+  const uint8_t * map_row  = tm->map + (map_y / PV_TILE_SIZE) * tm->map_width;
+  const vga_color_t * rows = tm->tiles + (map_y % PV_TILE_SIZE) * PV_TILE_SIZE; // This row in tile 0
+  uint32_t map_x           = tm->scroll_x % map_width_px;
+
+  // Copy one tile row at a time. Only the first and last tiles can be partial (horizontal scrolling).
+  for (uint16_t x = 0; x < width;) {
+    uint32_t offset = map_x % PV_TILE_SIZE;
+    uint32_t len    = MIN(PV_TILE_SIZE - offset, width - x);
+    memcpy(line + x, rows + map_row[map_x / PV_TILE_SIZE] * (PV_TILE_SIZE * PV_TILE_SIZE) + offset, len);
+    render_count_pixels(len);
+
+    x += len;
+    map_x += len;
+    if (map_x >= map_width_px) map_x = 0;
+  }
+}
@@ -1,33 +1,944 @@
 #include "render.h"
 
+#include "../common.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "vga.h"
+#include <string.h>
 
 /************************************
  * EXTERN VARIABLES
  ************************************/
 
-// TODO: Add interpolation back in
-// volatile uint8_t interpolatedLine        = 0;
-// volatile uint8_t interpolationIncomplete = 0;
-
 /************************************
  * PRIVATE MACROS AND DEFINES
  ************************************/
 
+#if PV_MAX_RENDER_ITEMS > 1024
+#error "PV_MAX_RENDER_ITEMS can be at most 1024 (32 words of dirty bits)"
+#endif
+
+#define DIRTY_WORDS ((PV_MAX_RENDER_ITEMS + 31) / 32)
+
+#define MIN_BAND_ROWS 8 // Damaged areas aren't split into bands thinner than this (with dual_core_render)
+
+#define MAX_OCCLUDERS 4 // Opaque rectangles occlusion culling keeps track of at once (the biggest ones)
+
+#if PV_SPAN_CACHE_SPANS > UINT16_MAX - 1
+#error "PV_SPAN_CACHE_SPANS can be at most 65534"
+#endif
+
+#define SPANS_NONE UINT32_MAX // Item has nothing in the span cache
+
+#define BIN_MAX_ITEMS 256 // Items a band's bin can hold with binned_render. Past that, every tile checks the whole render queue.
+
 /************************************
  * PRIVATE TYPEDEFS
  ************************************/
 
+// A run of pixels of one color on one row, inclusive
+typedef struct {
+  uint16_t y;
+  uint16_t x1;
+  uint16_t x2;
+  vga_color_t color;
+} span_t;
+
+// What one core saw while drawing one band, added to the profile in one go once the band is done
+typedef struct {
+  uint32_t clear_us;
+  uint32_t culled_items;
+  uint32_t items;
+  uint16_t slowest_item;
+  uint32_t slowest_item_us;
+  vga_render_type_profile_t types[VGA_RENDER_ITEM_SVG + 1];
+} profile_band_t;
+
 /************************************
  * STATIC VARIABLES
  ************************************/
 
 static volatile bool update = 0;
 
+// Shared between the cores: the dirty bits, the band counters and the render profile
+static spin_lock_t * render_lock = NULL;
+
+// Render queue items marked as updated since the last pass (1 bit per item), and which words of that have any bits set.
+// Set from either core by render_mark_dirty() and drained by render().
+static uint32_t dirty[DIRTY_WORDS];
+static volatile uint32_t dirty_words = 0;
+
+// Render queue items with an animate() function, and which words of that have any bits set. Picked up by update_item()
+// whenever an item changes, and only touched by render() (core 1), so AutoRender doesn't have to walk the render queue.
+static uint32_t animated[DIRTY_WORDS];
+static uint32_t animated_words = 0;
+
+// Area render_pixel() is allowed to write to, per core. The whole screen normally, one damaged area (or band of one)
+// at a time while render() redraws what changed, and a single row while rendering an interpolated line
+static volatile uint16_t clip_top[2]    = { 0, 0 };
+static volatile uint16_t clip_bottom[2] = { UINT16_MAX, UINT16_MAX };
+static volatile uint16_t clip_left[2]   = { 0, 0 };
+static volatile uint16_t clip_right[2]  = { UINT16_MAX, UINT16_MAX };
+
+// Parts of the screen that changed since the last render() pass, merged so they don't overlap
+static vga_rect_t damage[PV_MAX_DAMAGE_RECTS];
+static uint8_t num_damage = 0;
+
+// Damaged areas cut up into horizontal bands, handed out to whichever core asks first (see take_band())
+static vga_rect_t bands[PV_MAX_DAMAGE_RECTS * PV_RENDER_BANDS];
+static volatile uint16_t num_bands  = 0;
+static volatile uint16_t next_band  = 0;
+static volatile uint16_t bands_done = 0;
+
+// Occlusion culling, 1 bit per item (or per binned item) the current band/tile can skip
+static uint32_t hidden[2][DIRTY_WORDS];
+
+// Binned rendering: the items that overlap the band each core is on, and the tile each core is drawing into.
+// While tile_target is set, render_pixel() writes into it instead of the framebuffer (the clip area is the tile).
+static uint16_t bin[2][BIN_MAX_ITEMS];
+static uint8_t __scratch_y("pv_tile") __aligned(4) tile_buf[2][PV_BIN_TILE_WIDTH * PV_BIN_TILE_HEIGHT];
+static uint8_t * volatile tile_target[2] = { NULL, NULL };
+
+#if PV_SPAN_CACHE_SPANS
+// Span cache (AutoRender only). span_items[i] is (count << 16) | first for render_queue[i], or SPANS_NONE.
+// Spans only ever get appended. Once enough of the cache is left over from items that got recorded again, it's emptied
+// out and everything gets recorded again.
+static span_t spans[PV_SPAN_CACHE_SPANS];
+static uint16_t spans_used = 0; // Including the ones nothing uses any more
+static uint16_t spans_live = 0;
+static volatile uint32_t span_items[PV_MAX_RENDER_ITEMS];
+static bool span_refill             = true;  // Record everything that isn't in the cache at the next pass
+static volatile bool span_recording = false; // render_pixel() adds to the span being recorded instead of drawing (core 1 only)
+static bool span_overflow           = false;
+#endif
+
+static volatile bool dma_band = false; // Core 1 is drawing a band for render(), fills and blits can go to the DMA engine
+
+static volatile bool interp_line_active = false; // True while the line interpolation handler is rendering a line (core 1 only)
+static int16_t line_interp_irq          = -1;
+static uint32_t interp_frame_start      = 0; // Absolute line number of the start of the frame being interpolated
+static uint16_t interp_row              = 0; // Next row to check for interpolation
+
+#if PV_RENDER_PROFILING
+// render() timing, see vga_get_render_profile(). Written by the rendering core(s) holding render_lock, and read from core 0
+// without a lock: profile_seq is odd while something is changing, so a reader that sees it change has to try again.
+static volatile uint32_t profile_seq = 0;
+static vga_render_profile_t profile;
+static uint32_t profile_window[PV_RENDER_PROFILE_WINDOW]; // Last few pass times, for min/avg/max
+static uint16_t profile_window_pos         = 0;
+static uint32_t * volatile profile_item_us = NULL;
+static volatile bool profile_reset         = false;
+static profile_band_t profile_band[2]; // Per core, only touched by that core
+volatile uint32_t render_pixels_written[2] = { 0, 0 }; // Per core, so neither core has to lock to count
+#endif
+
 /************************************
  * STATIC FUNCTIONS
  ************************************/
 
+// Check if a line (from frame_read_addr) is one of the interpolated line buffers
+static inline bool is_interp_line(uint8_t * line) {
+  uint8_t * ring = __vga_get_interp_ring();
+  return ring && line >= ring && line < ring + vga_get_config()->num_interpolated_lines * vga_get_width();
+}
+
+/*
+  Span cache. Recording runs the item's rasterizer with render_pixel() adding each pixel onto the last span (or starting
+  a new one). Only the item types that take real work to rasterize get recorded.
+*/
+
+static bool span_cacheable(vga_render_item_type_t type) {
+  switch (type) {
+    case VGA_RENDER_ITEM_LINE:
+    case VGA_RENDER_ITEM_RECTANGLE:
+    case VGA_RENDER_ITEM_TRIANGLE:
+    case VGA_RENDER_ITEM_FILLED_TRIANGLE:
+    case VGA_RENDER_ITEM_CIRCLE:
+    case VGA_RENDER_ITEM_FILLED_CIRCLE:
+    case VGA_RENDER_ITEM_STRING:
+    case VGA_RENDER_ITEM_POLYGON:
+    case VGA_RENDER_ITEM_FILLED_POLYGON:
+      return true;
+    default:
+      return false;
+  }
+}
+
+#if PV_SPAN_CACHE_SPANS
+static void span_add(uint16_t y, uint16_t x, vga_color_t color) {
+  if (span_overflow) return;
+  if (spans_used > 0) {
+    span_t * last = &spans[spans_used - 1];
+    if (last->y == y && last->color == color && x >= last->x1 && x <= last->x2 + 1) {
+      last->x2 = MAX(last->x2, x);
+      return;
+    }
+  }
+  if (spans_used == PV_SPAN_CACHE_SPANS) {
+    span_overflow = true;
+    return;
+  }
+  spans[spans_used++] = (span_t) { y, x, x, color };
+}
+#endif
+
+// Drop an item from the span cache
+static void span_forget(uint16_t i) {
+#if PV_SPAN_CACHE_SPANS
+  if (i >= PV_MAX_RENDER_ITEMS || span_items[i] == SPANS_NONE) return;
+  spans_live -= span_items[i] >> 16;
+  span_items[i] = SPANS_NONE;
+#endif
+}
+
+static void span_clear() {
+#if PV_SPAN_CACHE_SPANS
+  for (int i = 0; i < PV_MAX_RENDER_ITEMS; i++) {
+    span_items[i] = SPANS_NONE; // Before any spans get reused, the line interpolation handler could draw at any time
+  }
+  spans_used  = 0;
+  spans_live  = 0;
+  span_refill = true;
+#endif
+}
+
+static void render_item_rasterize(vga_render_item_t * item);
+
+// Record an item into the span cache (if it's worth it, and it fits). Core 1 only, and never while bands are being drawn.
+static void span_record(vga_render_item_t * rq, uint16_t i) {
+#if PV_SPAN_CACHE_SPANS
+  span_forget(i);
+  if (!vga_get_config()->auto_render || i >= PV_MAX_RENDER_ITEMS || !rq[i].header.flags.shown || !span_cacheable(rq[i].header.type)) return;
+
+  uint16_t first = spans_used;
+  span_overflow  = false;
+  span_recording = true;
+  render_item_rasterize(&rq[i]);
+  span_recording = false;
+
+  if (span_overflow) {
+    spans_used = first;
+    // Mostly leftovers, start over. Otherwise it's just full, and the item gets drawn the slow way.
+    if (spans_used - spans_live >= PV_SPAN_CACHE_SPANS / 2) span_clear();
+    return;
+  }
+  spans_live    += spans_used - first;
+  span_items[i] = ((uint32_t) (spans_used - first) << 16) | first;
+#endif
+}
+
+// Record everything that should be in the span cache but isn't, after it got emptied out
+static void span_record_missing(vga_render_item_t * rq, uint16_t rq_len) {
+#if PV_SPAN_CACHE_SPANS
+  if (!span_refill) return;
+  for (uint16_t i = 0; i < MIN(rq_len, PV_MAX_RENDER_ITEMS); i++) {
+    if (span_items[i] == SPANS_NONE) span_record(rq, i);
+  }
+  span_refill = false; // Anything that didn't fit waits until it changes
+#endif
+}
+
+// Fill an item's spans back in, clipped to this core's clip area. Returns false if it isn't in the span cache.
+static bool span_replay(uint16_t i) {
+#if PV_SPAN_CACHE_SPANS
+  if (i >= PV_MAX_RENDER_ITEMS) return false;
+  uint32_t entry = span_items[i];
+  if (entry == SPANS_NONE) return false;
+
+  uint16_t top       = render_get_clip_top();
+  uint16_t bottom    = render_get_clip_bottom();
+  uint16_t left      = render_get_clip_left();
+  uint16_t right     = render_get_clip_right();
+  const span_t * s   = &spans[entry & 0xFFFF];
+  const span_t * end = s + (entry >> 16);
+  for (; s < end; s++) {
+    if (s->y < top || s->y > bottom) continue;
+    uint16_t x1 = MAX(s->x1, left);
+    uint16_t x2 = MIN(s->x2, right);
+    if (x1 <= x2) render_span(s->y, x1, x2, s->color);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+static void render_item(vga_render_item_t * item) {
+  if (!span_replay(item - vga_get_config()->render_queue)) render_item_rasterize(item);
+}
+
+static void render_item_rasterize(vga_render_item_t * item) {
+  switch (item->header.type) {
+    case VGA_RENDER_ITEM_FILL:
+      render2d_fill(item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_PIXEL:
+      render_pixel(item->item_2d.y, item->item_2d.x, item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_LINE:
+      render2d_line(item->item_2d.point.x[0], item->item_2d.point.y[0], item->item_2d.point.x[1], item->item_2d.point.y[1], item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_RECTANGLE:
+      render2d_rectangle(item->item_2d.point.x[0], item->item_2d.point.y[0], item->item_2d.point.x[1], item->item_2d.point.y[1], item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_FILLED_RECTANGLE:
+      render2d_rectangle_filled(item->item_2d.point.x[0], item->item_2d.point.y[0], item->item_2d.point.x[1], item->item_2d.point.y[1], item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_TRIANGLE:
+      render2d_triangle(item->item_2d.point.x[0], item->item_2d.point.y[0], item->item_2d.point.x[1], item->item_2d.point.y[1], item->item_2d.point.x[2], item->item_2d.point.y[2], item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_FILLED_TRIANGLE:
+      render2d_triangle_filled(item->item_2d.point.x[0], item->item_2d.point.y[0], item->item_2d.point.x[1], item->item_2d.point.y[1], item->item_2d.point.x[2], item->item_2d.point.y[2], item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_CIRCLE:
+      render2d_circle(item->item_2d.x, item->item_2d.y, item->item_2d.point.x[0], item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_FILLED_CIRCLE:
+      render2d_circle_filled(item->item_2d.x, item->item_2d.y, item->item_2d.point.x[0], item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_STRING:
+      render2d_string(item->item_2d.str.str, item->item_2d.x, item->item_2d.y, item->item_2d.str.x2, item->header.flags.wordwrap, item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_SPRITE:
+      if (item->header.flags.opaque) { // Nothing to skip, copy it straight in
+        render2d_blit(item->item_2d.sprite.sprite, item->item_2d.x, item->item_2d.y, item->item_2d.sprite.size_x, item->item_2d.sprite.size_y);
+        break;
+      }
+      render2d_sprite(item->item_2d.sprite.sprite, item->item_2d.x, item->item_2d.y, item->item_2d.sprite.size_x, item->item_2d.sprite.size_y, item->item_2d.sprite.null_color);
+      break;
+    case VGA_RENDER_ITEM_BITMAP:
+      break;
+    case VGA_RENDER_ITEM_POLYGON:
+      render2d_polygon(item->item_2d.points_arr.points, item->item_2d.points_arr.num_points, item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_FILLED_POLYGON:
+      render2d_polygon_filled(item->item_2d.points_arr.points, item->item_2d.points_arr.num_points, item->item_2d.color);
+      break;
+    case VGA_RENDER_ITEM_LIGHT:
+      break;
+    case VGA_RENDER_ITEM_SVG:
+      break;
+    case VGA_RENDER_ITEM_MAX:
+    default:
+      break;
+  }
+}
+
+/*
+  Render profiling. All of these compile down to nothing without PV_RENDER_PROFILING.
+  Every change to the profile is wrapped in profile_write_begin()/profile_write_end().
+*/
+
+static inline uint32_t profile_time() {
+  return PV_RENDER_PROFILING ? time_us_32() : 0;
+}
+
+#if PV_RENDER_PROFILING
+static inline uint32_t profile_write_begin() {
+  uint32_t save = spin_lock_blocking(render_lock);
+  profile_seq++;
+  __dmb();
+  return save;
+}
+
+static inline void profile_write_end(uint32_t save) {
+  __dmb();
+  profile_seq++;
+  spin_unlock(render_lock, save);
+}
+#endif
+
+static void profile_pass_begin() {
+#if PV_RENDER_PROFILING
+  uint32_t save = profile_write_begin();
+  if (profile_reset) {
+    memset(&profile, 0, sizeof(profile));
+    profile_window_pos = 0;
+    profile_reset      = false;
+  }
+  profile.clear_us        = 0;
+  profile.culled_items    = 0;
+  profile.slowest_item_us = 0;
+  profile_write_end(save);
+#endif
+}
+
+static void profile_clear(uint32_t us) {
+#if PV_RENDER_PROFILING
+  profile_band[get_core_num()].clear_us += us;
+#endif
+}
+
+static void profile_cull(uint16_t culled) {
+#if PV_RENDER_PROFILING
+  profile_band[get_core_num()].culled_items += culled;
+#endif
+}
+
+static void profile_item(uint16_t i, vga_render_item_type_t type, uint32_t us) {
+#if PV_RENDER_PROFILING
+  uint32_t * item_us = profile_item_us;
+  if (item_us) {
+    item_us[i] = us;
+  }
+
+  profile_band_t * band = &profile_band[get_core_num()];
+  band->items++;
+  if (us >= band->slowest_item_us) {
+    band->slowest_item    = i;
+    band->slowest_item_us = us;
+  }
+  if (type <= VGA_RENDER_ITEM_SVG) {
+    vga_render_type_profile_t * t = &band->types[type];
+    t->count++;
+    t->total_us += us;
+    t->max_us = MAX(t->max_us, us);
+  }
+#endif
+}
+
+// Add what this core collected over the band it just drew to the profile
+static void profile_band_end() {
+#if PV_RENDER_PROFILING
+  profile_band_t * band = &profile_band[get_core_num()];
+
+  uint32_t save = profile_write_begin();
+  profile.clear_us += band->clear_us;
+  profile.culled_items += band->culled_items;
+  if (band->items && band->slowest_item_us >= profile.slowest_item_us) {
+    profile.slowest_item    = band->slowest_item;
+    profile.slowest_item_us = band->slowest_item_us;
+  }
+  for (int i = 0; i <= VGA_RENDER_ITEM_SVG; i++) {
+    vga_render_type_profile_t * t = &band->types[i];
+    if (!t->count) continue;
+    profile.types[i].count += t->count;
+    profile.types[i].total_us += t->total_us;
+    profile.types[i].max_us = MAX(profile.types[i].max_us, t->max_us);
+  }
+  profile_write_end(save);
+
+  memset(band, 0, sizeof(*band));
+#endif
+}
+
+static void profile_pass_end(uint32_t us) {
+#if PV_RENDER_PROFILING
+  uint32_t budget = __vga_get_frame_period_us();
+  uint32_t bin    = (uint64_t) us * 8 / budget;
+
+  uint32_t save = profile_write_begin();
+  profile.budget_us = budget;
+  profile.last_us   = us;
+  profile.histogram[MIN(bin, VGA_RENDER_PROFILE_BINS - 1)]++;
+  if (us > budget) {
+    profile.over_budget++;
+  }
+  profile_window[profile_window_pos] = us;
+  profile_window_pos                 = (profile_window_pos + 1) % PV_RENDER_PROFILE_WINDOW;
+  profile.passes++;
+  profile_write_end(save);
+#endif
+}
+
+/*
+  Damage tracking (AutoRender). Every item that changed damages the area it was last drawn in and the area it covers
+  now, and only those areas get cleared and redrawn (with everything that overlaps them, in render queue order).
+*/
+
+static inline bool rect_empty(vga_rect_t r) {
+  return r.x1 > r.x2 || r.y1 > r.y2;
+}
+
+// True if the rectangles overlap
+static inline bool rect_intersects(vga_rect_t a, vga_rect_t b) {
+  return a.x1 <= b.x2 && b.x1 <= a.x2 && a.y1 <= b.y2 && b.y1 <= a.y2;
+}
+
+// True if the rectangles overlap or share an edge, so drawing their union doesn't cost much extra
+static inline bool rect_touches(vga_rect_t a, vga_rect_t b) {
+  return (int32_t) a.x1 <= b.x2 + 1 && (int32_t) b.x1 <= a.x2 + 1 && (int32_t) a.y1 <= b.y2 + 1 && (int32_t) b.y1 <= a.y2 + 1;
+}
+
+// True if a covers all of b
+static inline bool rect_contains(vga_rect_t a, vga_rect_t b) {
+  return a.x1 <= b.x1 && a.y1 <= b.y1 && a.x2 >= b.x2 && a.y2 >= b.y2;
+}
+
+static inline vga_rect_t rect_intersection(vga_rect_t a, vga_rect_t b) {
+  return (vga_rect_t) { MAX(a.x1, b.x1), MAX(a.y1, b.y1), MIN(a.x2, b.x2), MIN(a.y2, b.y2) };
+}
+
+static inline vga_rect_t rect_union(vga_rect_t a, vga_rect_t b) {
+  return (vga_rect_t) { MIN(a.x1, b.x1), MIN(a.y1, b.y1), MAX(a.x2, b.x2), MAX(a.y2, b.y2) };
+}
+
+static inline uint32_t rect_area(vga_rect_t r) {
+  return rect_empty(r) ? 0 : (uint32_t) (r.x2 - r.x1 + 1) * (r.y2 - r.y1 + 1);
+}
+
+static void add_damage(vga_rect_t r) {
+  r.x2 = MIN(r.x2, vga_get_playfield_width() - 1);
+  r.y2 = MIN(r.y2, vga_get_playfield_height() - 1);
+  if (rect_empty(r)) return;
+
+  // Merge it with anything it touches. The merged rectangle can touch others, so start over after every merge.
+  for (int j = 0; j < num_damage; j++) {
+    if (rect_touches(r, damage[j])) {
+      r         = rect_union(r, damage[j]);
+      damage[j] = damage[--num_damage];
+      j         = -1;
+    }
+  }
+
+  // Out of room, merge it into whichever one grows the least
+  if (num_damage == PV_MAX_DAMAGE_RECTS) {
+    uint8_t best       = 0;
+    uint32_t best_cost = UINT32_MAX;
+    for (int j = 0; j < num_damage; j++) {
+      uint32_t cost = rect_area(rect_union(r, damage[j])) - rect_area(damage[j]);
+      if (cost < best_cost) {
+        best      = j;
+        best_cost = cost;
+      }
+    }
+    r            = rect_union(r, damage[best]);
+    damage[best] = damage[--num_damage];
+    add_damage(r);
+    return;
+  }
+
+  damage[num_damage++] = r;
+}
+
+// Take every dirty bit at once (so items marked while drawing get picked up next time). Returns which words of
+// items are set, the bits themselves go into words.
+static uint32_t take_dirty(uint32_t words[DIRTY_WORDS]) {
+  uint32_t save = spin_lock_blocking(render_lock);
+  uint32_t mask = dirty_words;
+  for (uint32_t m = mask; m; m &= m - 1) {
+    int w    = __builtin_ctz(m);
+    words[w] = dirty[w];
+    dirty[w] = 0;
+  }
+  dirty_words = 0;
+  spin_unlock(render_lock, save);
+  return mask;
+}
+
+// Catch the renderer's copy of an item (bounding box, where it was drawn) up with any changes, and damage what changed
+static void update_item(vga_render_item_t * item, bool damage) {
+  item->header.flags.update = false;
+  draw2d_update_bbox(item); // In case the item got changed by hand
+
+  uint32_t i = item - vga_get_config()->render_queue;
+  if (i < PV_MAX_RENDER_ITEMS) {
+    if (item->animate) {
+      animated[i / 32] |= 1u << (i % 32);
+      animated_words |= 1u << (i / 32);
+    } else if ((animated[i / 32] &= ~(1u << (i % 32))) == 0) {
+      animated_words &= ~(1u << (i / 32));
+    }
+  }
+  if (damage) {
+    add_damage(item->drawn_bbox);
+    if (item->header.flags.shown) add_damage(item->bbox);
+  }
+  item->drawn_bbox = item->header.flags.shown ? item->bbox : VGA_RECT_EMPTY;
+}
+
+// Work out which parts of the screen need redrawing, from the items marked as updated. Everything is damaged if full is set.
+static void collect_damage(vga_render_item_t * rq, uint16_t rq_len, bool full) {
+  uint32_t words[DIRTY_WORDS];
+  uint32_t mask = take_dirty(words);
+
+  num_damage = 0;
+  if (full) {
+    add_damage((vga_rect_t) { 0, 0, UINT16_MAX, UINT16_MAX });
+    for (int i = 0; i < rq_len; i++) {
+      update_item(&rq[i], false);
+    }
+  }
+
+  // Only look at the items that changed, however long the render queue is
+  for (; mask; mask &= mask - 1) {
+    int w = __builtin_ctz(mask);
+    for (uint32_t bits = words[w]; bits; bits &= bits - 1) {
+      uint16_t i = w * 32 + __builtin_ctz(bits);
+      if (i >= rq_len) continue;
+      if (!full) update_item(&rq[i], true);
+      span_record(rq, i);
+    }
+  }
+  span_record_missing(rq, rq_len);
+}
+
+static void animate_item(vga_render_item_t * item) {
+  if (!item->animate) return;
+  item->animate((struct vga_render_item_t *) item);
+  if (item->header.flags.update) {
+    render_mark_dirty(item); // Setting flags.update by hand in animate() still redraws the item, like it always did
+  }
+}
+
+// Run the animated items' animate() functions, every item's if all is set (manual rendering, where render queues can be
+// longer than the bits go)
+static void animate_items(vga_render_item_t * rq, uint16_t rq_len, bool all) {
+  if (all) {
+    for (int i = 0; i < rq_len; i++) {
+      animate_item(&rq[i]);
+    }
+    return;
+  }
+  for (uint32_t mask = animated_words; mask; mask &= mask - 1) {
+    int w = __builtin_ctz(mask);
+    for (uint32_t bits = animated[w]; bits; bits &= bits - 1) {
+      uint16_t i = w * 32 + __builtin_ctz(bits);
+      if (i < rq_len) animate_item(&rq[i]);
+    }
+  }
+}
+
+// Cut the damaged areas up into the bands the cores draw. Without dual_core_render every damaged area is one band.
+static void split_bands() {
+  uint16_t n = 0;
+  for (int d = 0; d < num_damage; d++) {
+    uint16_t height = damage[d].y2 - damage[d].y1 + 1;
+    uint16_t rows   = vga_get_config()->dual_core_render ? MAX(MIN_BAND_ROWS, (height + PV_RENDER_BANDS - 1) / PV_RENDER_BANDS) : height;
+    for (uint32_t y = damage[d].y1; y <= damage[d].y2; y += rows) {
+      bands[n]    = damage[d];
+      bands[n].y1 = y;
+      bands[n].y2 = MIN(y + rows - 1, damage[d].y2);
+      n++;
+    }
+  }
+
+  // Hand them out. Both cores are done with the last pass's bands by now, see render().
+  uint32_t save = spin_lock_blocking(render_lock);
+  num_bands     = n;
+  next_band     = 0;
+  bands_done    = 0;
+  spin_unlock(render_lock, save);
+  __sev(); // Wake up core 0 if it's in vga_render_help()
+}
+
+// Get the next band nobody has started on, or -1 if they're all taken
+static int32_t take_band() {
+  uint32_t save = spin_lock_blocking(render_lock);
+  int32_t b     = next_band < num_bands ? next_band++ : -1;
+  spin_unlock(render_lock, save);
+  return b;
+}
+
+// Number of the first count items (see cull()) that are shown and overlap r
+static uint16_t count_overlapping(vga_rect_t r, const uint16_t * items, uint16_t count) {
+  vga_render_item_t * rq = vga_get_config()->render_queue;
+  uint16_t n             = 0;
+  for (uint16_t j = 0; j < count; j++) {
+    vga_render_item_t * item = &rq[items ? items[j] : j];
+    n += item->header.flags.shown && rect_intersects(item->drawn_bbox, r);
+  }
+  return n;
+}
+
+/**
+ * @brief Occlusion culling. Walks the items that overlap an area back to front, keeping track of the biggest few opaque
+ * rectangles seen so far (see flags.opaque). Anything entirely inside one of them can't be seen, so its bit gets set in
+ * hidden[core], and once an opaque item covers the whole area nothing under it (not even the background) is needed.
+ *
+ * @param r Area being drawn
+ * @param items Render queue indices to look at, in render queue order. NULL for the whole render queue.
+ * @param count Number of items
+ * @param clear Set to false if something covers the whole area, so it doesn't have to be cleared first
+ * @return uint16_t First item (position in items) that needs drawing
+ */
+static uint16_t cull(vga_rect_t r, const uint16_t * items, uint16_t count, bool * clear) {
+  vga_render_item_t * rq = vga_get_config()->render_queue;
+  uint32_t * bits        = hidden[get_core_num()];
+  vga_rect_t occluders[MAX_OCCLUDERS];
+  uint8_t num_occluders = 0;
+  uint16_t culled       = 0;
+
+  memset(bits, 0, sizeof(hidden[0]));
+  *clear = true;
+  for (int32_t j = count - 1; j >= 0; j--) {
+    vga_render_item_t * item = &rq[items ? items[j] : j];
+    if (!item->header.flags.shown || !rect_intersects(item->drawn_bbox, r)) continue;
+
+    vga_rect_t visible = rect_intersection(item->drawn_bbox, r);
+    bool covered       = false;
+    for (int k = 0; k < num_occluders && !covered; k++) {
+      covered = rect_contains(occluders[k], visible);
+    }
+    if (covered && j < PV_MAX_RENDER_ITEMS) {
+      bits[j / 32] |= 1u << (j % 32);
+      culled++;
+      continue;
+    }
+
+    if (item->header.flags.opaque) {
+      if (rect_contains(item->drawn_bbox, r)) { // Covers everything, nothing before this shows up
+        *clear = false;
+        profile_cull(culled + (PV_RENDER_PROFILING ? count_overlapping(r, items, j) : 0));
+        return j;
+      }
+
+      // Keep the biggest ones
+      uint8_t k = num_occluders;
+      if (num_occluders < MAX_OCCLUDERS) {
+        num_occluders++;
+      } else {
+        k = 0;
+        for (int m = 1; m < MAX_OCCLUDERS; m++) {
+          if (rect_area(occluders[m]) < rect_area(occluders[k])) k = m;
+        }
+        if (rect_area(occluders[k]) >= rect_area(visible)) continue;
+      }
+      occluders[k] = visible;
+    }
+  }
+  profile_cull(culled);
+  return 0;
+}
+
+static inline bool is_hidden(uint16_t j) {
+  return j < PV_MAX_RENDER_ITEMS && (hidden[get_core_num()][j / 32] & (1u << (j % 32)));
+}
+
+static inline void set_clip(uint core, vga_rect_t r) {
+  clip_left[core]   = r.x1;
+  clip_top[core]    = r.y1;
+  clip_right[core]  = r.x2;
+  clip_bottom[core] = r.y2;
+}
+
+// Copy a finished tile out to the framebuffer (or the playfield), a row at a time
+static void copy_tile(const uint8_t * tile, vga_rect_t r) {
+  uint8_t * playfield = __vga_get_playfield();
+  uint16_t width      = r.x2 - r.x1 + 1;
+  for (uint16_t y = r.y1; y <= r.y2; y++) {
+    const uint8_t * src = tile + (y - r.y1) * PV_BIN_TILE_WIDTH;
+    if (playfield) {
+      memcpy(playfield + y * vga_get_playfield_width() + r.x1, src, width);
+      render_count_pixels(width);
+      continue;
+    }
+    uint8_t * line = __vga_get_frame_draw_addr()[__vga_get_row_line(y)];
+    if (!is_interp_line(line)) { // Those get drawn by the line interpolation handler
+      memcpy(line + r.x1, src, width);
+      render_count_pixels(width);
+    }
+  }
+}
+
+// Binned version of render_band(): sort out which items overlap the band once, then draw the band a tile at a time into
+// this core's tile buffer. Everything drawn in a tile stays in SCRATCH_Y, and each framebuffer pixel gets written once.
+static void render_band_binned(vga_rect_t band) {
+  const vga_config_t * config = vga_get_config();
+  vga_render_item_t * rq      = config->render_queue;
+  uint core                   = get_core_num();
+  uint8_t * tile              = tile_buf[core];
+
+  uint16_t num_binned = 0;
+  bool overflow       = false;
+  for (uint16_t i = 0; i < config->render_queue_len && !overflow; i++) {
+    if (rq[i].header.flags.shown && rect_intersects(rq[i].drawn_bbox, band)) {
+      if (num_binned == BIN_MAX_ITEMS) {
+        overflow = true;
+      } else {
+        bin[core][num_binned++] = i;
+      }
+    }
+  }
+  uint16_t count = overflow ? config->render_queue_len : num_binned;
+
+  for (uint32_t y = band.y1; y <= band.y2; y += PV_BIN_TILE_HEIGHT) {
+    for (uint32_t x = band.x1; x <= band.x2; x += PV_BIN_TILE_WIDTH) {
+      vga_rect_t r = { x, y, MIN(x + PV_BIN_TILE_WIDTH - 1, band.x2), MIN(y + PV_BIN_TILE_HEIGHT - 1, band.y2) };
+      set_clip(core, r);
+
+      bool clear;
+      uint16_t first = cull(r, overflow ? NULL : bin[core], count, &clear);
+      if (clear) {
+        uint32_t clear_start = profile_time();
+        render_fill_span(tile, COLOR_BLACK, sizeof(tile_buf[0]));
+        profile_clear(profile_time() - clear_start);
+      }
+
+      tile_target[core] = tile;
+      for (uint16_t j = first; j < count; j++) {
+        uint16_t i = overflow ? j : bin[core][j];
+        if (rq[i].header.flags.shown && !is_hidden(j) && rect_intersects(rq[i].drawn_bbox, r)) {
+          uint32_t item_start = profile_time();
+          render_item(&rq[i]);
+          profile_item(i, rq[i].header.type, profile_time() - item_start);
+        }
+      }
+      tile_target[core] = NULL;
+
+      copy_tile(tile, r);
+    }
+  }
+}
+
+// Clear one band and redraw everything that overlaps it, in render queue order, clipped to the band
+static void render_band(vga_rect_t band) {
+  const vga_config_t * config = vga_get_config();
+  vga_render_item_t * rq      = config->render_queue;
+  uint core                   = get_core_num();
+
+  if (config->binned_render) {
+    render_band_binned(band);
+    set_clip(core, (vga_rect_t) { 0, 0, UINT16_MAX, UINT16_MAX });
+    profile_band_end();
+    return;
+  }
+
+  set_clip(core, band);
+  dma_band = config->dma_render && core == 1;
+
+  bool clear;
+  uint16_t first = cull(band, NULL, config->render_queue_len, &clear);
+  if (clear) {
+    uint32_t clear_start = profile_time();
+    render2d_rectangle_filled(band.x1, band.y1, band.x2, band.y2, COLOR_BLACK); // wipe the damaged area
+    profile_clear(profile_time() - clear_start);
+  }
+
+  for (int i = first; i < config->render_queue_len; i++) {
+    if (rq[i].header.flags.shown && !is_hidden(i) && rect_intersects(rq[i].drawn_bbox, band)) {
+      render_dma_wait_for(rq[i].drawn_bbox); // Still being filled in under it
+      uint32_t item_start = profile_time();
+      render_item(&rq[i]);
+      profile_item(i, rq[i].header.type, profile_time() - item_start);
+    }
+  }
+
+  dma_band = false;
+  set_clip(core, (vga_rect_t) { 0, 0, UINT16_MAX, UINT16_MAX });
+  profile_band_end();
+}
+
+// Draw bands until there are none left to take. Returns the number of bands this core drew.
+static uint16_t render_bands() {
+  uint16_t drawn = 0;
+  for (int32_t b; (b = take_band()) >= 0; drawn++) {
+    render_band(bands[b]);
+
+    uint32_t save = spin_lock_blocking(render_lock);
+    bands_done++;
+    spin_unlock(render_lock, save);
+    __sev(); // render() might be waiting on this one
+  }
+  return drawn;
+}
+
+/**
+ * @brief Render a single row of the frame (the whole render queue, clipped to that row)
+ * into whatever buffer frame_read_addr points at for that row.
+ *
+ * @param y Row to render, in screen space
+ */
+static void render_line(uint16_t y) {
+  const vga_config_t * config = vga_get_config();
+
+  // Might have interrupted render(), so put everything back the way it was afterwards
+  uint16_t old_top    = clip_top[1];
+  uint16_t old_bottom = clip_bottom[1];
+  uint16_t old_left   = clip_left[1];
+  uint16_t old_right  = clip_right[1];
+  clip_top[1]         = y;
+  clip_bottom[1]      = y;
+  clip_left[1]        = 0;
+  clip_right[1]       = UINT16_MAX;
+  interp_line_active  = true;
+
+  render2d_fill(COLOR_BLACK);
+  for (int i = 0; i < config->render_queue_len; i++) {
+    if (config->render_queue[i].header.flags.shown) {
+      render_item(&config->render_queue[i]);
+    }
+  }
+
+  interp_line_active = false;
+  clip_top[1]        = old_top;
+  clip_bottom[1]     = old_bottom;
+  clip_left[1]       = old_left;
+  clip_right[1]      = old_right;
+}
+
+// Number of lines the row starting on an absolute line is shown on. Rows don't all get the same number when the base
+// resolution isn't a multiple of the height (see __vga_get_row_line()).
+static uint16_t interp_row_copies(uint32_t abs_line) {
+  int32_t line = (int32_t) (abs_line - interp_frame_start);
+  if (line < 0) line += __vga_get_frame_read_addr_len(); // Still from the frame before
+  if (line < 0) return 0;                                // Long gone
+
+  uint16_t height      = vga_get_height();
+  uint16_t base_height = __vga_get_row_line(height);
+  uint16_t y           = (uint32_t) line * height / base_height;
+  return __vga_get_row_line(y + 1) - __vga_get_row_line(y);
+}
+
+// Line interpolation IRQ, pended by the DMA IRQ every line. Renders interpolated lines (every line
+// in tile mode) into the line buffer ring as far ahead of the DMA as the ring allows.
+static void line_interpolation_handler() {
+  irq_clear(line_interp_irq);
+
+  const vga_config_t * config = vga_get_config();
+  uint8_t ** frame_read_addr  = __vga_get_frame_read_addr();
+  uint8_t * ring              = __vga_get_interp_ring();
+  uint16_t frame_len          = __vga_get_frame_read_addr_len();
+
+  while (true) {
+    uint32_t now = __vga_get_scanout_abs_line();
+
+    // Fell more than a frame behind (or just started up), jump to the frame currently being scanned out
+    if ((int32_t) (now - interp_frame_start) >= frame_len) {
+      interp_frame_start = now - (now - interp_frame_start) % frame_len;
+      interp_row         = 0;
+    }
+
+    // Find the next interpolated row
+    while (interp_row < vga_get_height() && !is_interp_line(frame_read_addr[__vga_get_row_line(interp_row)])) {
+      interp_row++;
+    }
+    if (interp_row >= vga_get_height()) {
+      interp_frame_start += frame_len;
+      interp_row = 0;
+      continue;
+    }
+
+    uint16_t row_line = __vga_get_row_line(interp_row);
+    uint32_t target   = interp_frame_start + row_line;
+    if ((int32_t) (target - now) <= 0) {
+      // Too late, the DMA already grabbed this one. Skip it and try to catch up.
+      interp_row++;
+      continue;
+    }
+
+    // Wait until the DMA is done with every copy (line doubling) of whatever is in this buffer
+    uint8_t * line = frame_read_addr[row_line];
+    uint8_t slot   = (line - ring) / vga_get_width();
+    uint32_t held  = __vga_get_interp_slot_line(slot);
+    if (held != INTERP_SLOT_EMPTY && (int32_t) (held + interp_row_copies(held) - 1 - now) >= 0) {
+      break;
+    }
+
+    if (config->color_depth != VGA_COLOR_DEPTH_8BPP) {
+      render_packed_line(interp_row, line);
+    } else if (config->tilemap) {
+      render_tile_line(interp_row, line);
+    } else if (config->scanline_render) {
+      render_scanline(interp_row, line);
+    } else {
+      render_line(interp_row);
+    }
+    __vga_set_interp_slot_line(slot, target);
+    interp_row++;
+  }
+}
+
 /************************************
  * GLOBAL FUNCTIONS
  ************************************/
@@ -42,87 +953,57 @@ void render() {
   vga_render_item_t * rq      = config->render_queue;
   uint16_t rq_len             = config->render_queue_len;
 
-  int i = 0;
+  vga_reset_render_profile(); // Starts over with vga_init()
+  uint32_t animated_frame = vga_get_frame_count();
 
   while (true) {
+    // Resolution changes happen between passes, when neither core is drawing (vga_set_resolution() sends an event)
+    __vga_switch_resolution();
+
+    bool full = true;
     if (config->auto_render) {
-      // look for the first item that needs an update, render that item and everything after it
-      i = 0;
-      while (!rq[i].header.flags.update && !update) {
-        i = (i + 1) % rq_len;
-      }
-      // if the update is to hide an item or a force-refresh, rerender the whole thing
-      if (!rq[i].header.flags.shown || update) {
-        i = 0;
+      // sleep until an item is marked as updated (draw_mark_updated() sends an event), then only redraw the parts of the screen that changed.
+      // Animated items get animated once a frame in the meantime (the frame IRQ sends an event every vertical blanking period).
+      while (!dirty_words && !update && !__vga_resolution_pending()) {
+        if (animated_words && vga_get_frame_count() != animated_frame) {
+          animated_frame = vga_get_frame_count();
+          animate_items(rq, rq_len, false);
+          continue;
+        }
+        __wfe();
       }
+      // a force-refresh rerenders the whole thing
+      // the back buffer is 2 frames old when double buffering, so that always needs the whole thing too
+      full = update || config->double_buffered;
     } else { // manual rendering
-      while (!update);
-      i = 0;
-    }
-
-    render2d_fill(COLOR_BLACK); // wipe the display
-    for (; i < rq_len; i++) {
-      if (rq[i].header.flags.shown) {
-        switch (rq[i].header.type) {
-          case VGA_RENDER_ITEM_FILL:
-            render2d_fill(rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_PIXEL:
-            render_pixel(rq[i].item_2d.y, rq[i].item_2d.x, rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_LINE:
-            render2d_line(rq[i].item_2d.point.x[0], rq[i].item_2d.point.y[0], rq[i].item_2d.point.x[1], rq[i].item_2d.point.y[1], rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_RECTANGLE:
-            render2d_rectangle(rq[i].item_2d.point.x[0], rq[i].item_2d.point.y[0], rq[i].item_2d.point.x[1], rq[i].item_2d.point.y[1], rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_FILLED_RECTANGLE:
-            render2d_rectangle_filled(rq[i].item_2d.point.x[0], rq[i].item_2d.point.y[0], rq[i].item_2d.point.x[1], rq[i].item_2d.point.y[1], rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_TRIANGLE:
-            render2d_triangle(rq[i].item_2d.point.x[0], rq[i].item_2d.point.y[0], rq[i].item_2d.point.x[1], rq[i].item_2d.point.y[1], rq[i].item_2d.point.x[2], rq[i].item_2d.point.y[2], rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_FILLED_TRIANGLE:
-            render2d_triangle_filled(rq[i].item_2d.point.x[0], rq[i].item_2d.point.y[0], rq[i].item_2d.point.x[1], rq[i].item_2d.point.y[1], rq[i].item_2d.point.x[2], rq[i].item_2d.point.y[2], rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_CIRCLE:
-            render2d_circle(rq[i].item_2d.x, rq[i].item_2d.y, rq[i].item_2d.point.x[0], rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_FILLED_CIRCLE:
-            render2d_circle_filled(rq[i].item_2d.x, rq[i].item_2d.y, rq[i].item_2d.point.x[0], rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_STRING:
-            render2d_string(rq[i].item_2d.str.str, rq[i].item_2d.x, rq[i].item_2d.y, rq[i].item_2d.str.x2, rq[i].header.flags.wordwrap, rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_SPRITE:
-            render2d_sprite(rq[i].item_2d.sprite.sprite, rq[i].item_2d.x, rq[i].item_2d.y, rq[i].item_2d.sprite.size_x, rq[i].item_2d.sprite.size_y, rq[i].item_2d.sprite.null_color);
-            break;
-          case VGA_RENDER_ITEM_BITMAP:
-            break;
-          case VGA_RENDER_ITEM_POLYGON:
-            render2d_polygon(rq[i].item_2d.points_arr.points, rq[i].item_2d.points_arr.num_points, rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_FILLED_POLYGON:
-            render2d_polygon_filled(rq[i].item_2d.points_arr.points, rq[i].item_2d.points_arr.num_points, rq[i].item_2d.color);
-            break;
-          case VGA_RENDER_ITEM_LIGHT:
-            break;
-          case VGA_RENDER_ITEM_SVG:
-            break;
-          case VGA_RENDER_ITEM_MAX:
-          default:
-            break;
-        }
+      while (!update && !__vga_resolution_pending()) {
+        __wfe(); // vga_refresh() sends an event
       }
+    }
+    if (__vga_resolution_pending()) continue;
+    update = false;
 
-      if (rq[i].animate) {
-        rq[i].animate((struct vga_render_item_t *) &rq[i]);
-      }
+    uint32_t pass_start = profile_time();
+    profile_pass_begin();
+    collect_damage(rq, rq_len, full);
 
-      rq[i].header.flags.update = false;
+    // draw the damaged areas, with core 0's help if it's in vga_render_help()
+    split_bands();
+    render_bands();
+    while (bands_done < num_bands) {
+      __wfe(); // core 0 is still on its last band
     }
+    render_dma_wait();
 
-    update = false;
+    animate_items(rq, rq_len, !config->auto_render);
+    animated_frame = vga_get_frame_count();
+
+    profile_pass_end(profile_time() - pass_start);
+
+    // put the finished frame on the screen during the next vertical blanking period
+    if (config->double_buffered) {
+      __vga_flip();
+    }
   }
 }
 
@@ -134,8 +1015,49 @@ void render() {
  * @param color Color to write
  */
 void render_pixel(uint16_t y, uint16_t x, vga_color_t color) {
-  if (x >= vga_get_width() || y >= vga_get_height())
+  uint core = get_core_num();
+  if (x >= vga_get_playfield_width() || y >= vga_get_playfield_height() || y < clip_top[core] || y > clip_bottom[core] || x < clip_left[core] || x > clip_right[core])
+    return;
+
+#if PV_SPAN_CACHE_SPANS
+  if (span_recording && core == 1 && !interp_line_active) {
+    span_add(y, x, color);
     return;
+  }
+#endif
+
+  // Binned rendering, the clip area is the tile (unless this is the line interpolation handler interrupting it)
+  uint8_t * tile = tile_target[core];
+  if (tile && !(interp_line_active && core == 1)) {
+    tile[(y - clip_top[core]) * PV_BIN_TILE_WIDTH + (x - clip_left[core])] = color;
+    render_count_pixels(1);
+    return;
+  }
+
+  // Scrolling playfield, drawn in playfield coordinates. The scroll regions pick which part of it is on screen.
+  uint8_t * playfield = __vga_get_playfield();
+  if (playfield) {
+    playfield[y * vga_get_playfield_width() + x] = color;
+    render_count_pixels(1);
+    return;
+  }
+
+  // Packed framebuffer, color is a palette index. Pixels are packed left -> right from the lowest bits up.
+  uint8_t * packed = __vga_get_packed_framebuffer();
+  if (packed) {
+    uint8_t * byte = packed + y * __vga_get_packed_stride();
+    if (vga_get_config()->color_depth == VGA_COLOR_DEPTH_4BPP) {
+      uint8_t shift = (x & 1) * 4;
+      byte += x >> 1;
+      *byte = (*byte & ~(0xF << shift)) | ((color & 0xF) << shift);
+    } else {
+      uint8_t shift = (x & 3) * 2;
+      byte += x >> 2;
+      *byte = (*byte & ~(0x3 << shift)) | ((color & 0x3) << shift);
+    }
+    render_count_pixels(1);
+    return;
+  }
 
   // Write out to the screen, but also handle line doubling.
   // Line doubling (for scaled resolutions) is done by writing the same
@@ -143,15 +1065,276 @@ void render_pixel(uint16_t y, uint16_t x, vga_color_t color) {
   // data written to that pointer will automatically be duped to the line(s)
   // below it. Pixel doubling is handled by clocking the color PIO slower.
   // i.e. line 2 on a 400x300 scaled display -> frame_read_addr[4] at base 800x600 resolution
-  __vga_get_frame_read_addr()[y * vga_get_config()->scaled_resolution][x] = color;
+  uint8_t * line = __vga_get_frame_draw_addr()[__vga_get_row_line(y)];
+
+  // Interpolated lines share a handful of line buffers, so they can only be drawn when
+  // the line interpolation handler (on core 1) is rendering that exact line
+  if (!(interp_line_active && core == 1) && is_interp_line(line))
+    return;
+
+  line[x] = color;
+  render_count_pixels(1);
+}
+
+/**
+ * @brief Fills x1 to x2 (inclusive) on one row with a color. Same clipping as render_pixel(), but 8 bit
+ * targets get the whole row at once.
+ *
+ * @param y Y coordinate in screen space
+ * @param x1 Left end of the span
+ * @param x2 Right end of the span
+ * @param color Color to write
+ */
+void render_span(uint16_t y, uint16_t x1, uint16_t x2, vga_color_t color) {
+  uint core = get_core_num();
+  if (y >= vga_get_playfield_height() || y < clip_top[core] || y > clip_bottom[core]) return;
+  x1 = MAX(x1, clip_left[core]);
+  x2 = MIN(x2, MIN(clip_right[core], vga_get_playfield_width() - 1));
+  if (x1 > x2) return;
+
+  uint8_t * tile = tile_target[core];
+  if (tile && !(interp_line_active && core == 1)) {
+    render_fill_span(tile + (y - clip_top[core]) * PV_BIN_TILE_WIDTH + (x1 - clip_left[core]), color, x2 - x1 + 1);
+    return;
+  }
+
+  uint8_t * playfield = __vga_get_playfield();
+  if (playfield) {
+    render_fill_span(playfield + y * vga_get_playfield_width() + x1, color, x2 - x1 + 1);
+    return;
+  }
+
+  if (__vga_get_packed_framebuffer()) {
+    for (uint16_t x = x1; x <= x2; x++) {
+      render_pixel(y, x, color);
+    }
+    return;
+  }
+
+  uint8_t * line = __vga_get_frame_draw_addr()[__vga_get_row_line(y)];
+  if (!(interp_line_active && core == 1) && is_interp_line(line))
+    return;
+
+  render_fill_span(line + x1, color, x2 - x1 + 1);
+}
+
+/**
+ * @brief The span fill kernel everything that fills rows goes through. Writes single bytes up to a word boundary,
+ * then the color repeated 4 times a word at a time (8 words per loop), then whatever is left. Lives in RAM so it
+ * isn't waiting on XIP cache misses while clearing the screen.
+ *
+ * @param dst First pixel
+ * @param color Color to write
+ * @param len Number of pixels
+ */
+void __not_in_flash_func(render_fill_span)(uint8_t * dst, vga_color_t color, uint32_t len) {
+  render_count_pixels(len);
+  uint32_t color32 = color * 0x01010101u;
+  for (; len && ((uintptr_t) dst & 3); len--) {
+    *dst++ = color;
+  }
+
+  uint32_t * word = (uint32_t *) dst;
+  for (; len >= 32; len -= 32, word += 8) {
+    word[0] = color32;
+    word[1] = color32;
+    word[2] = color32;
+    word[3] = color32;
+    word[4] = color32;
+    word[5] = color32;
+    word[6] = color32;
+    word[7] = color32;
+  }
+  for (; len >= 4; len -= 4) {
+    *word++ = color32;
+  }
+
+  dst = (uint8_t *) word;
+  for (; len; len--) {
+    *dst++ = color;
+  }
+}
+
+/**
+ * @brief Work out where the 2D rasterizers on this core draw: the clip area cut down to the playfield, and a pointer
+ * to its top left pixel if it's 8 bit with evenly spaced rows. That covers tile buffers, the playfield, the line being
+ * interpolated and a framebuffer without interpolated lines. Anything else (packed framebuffers, a framebuffer with
+ * interpolated lines in it, recording the span cache) gets a NULL base and goes through render_pixel().
+ * Called once per primitive, it's the same for every pixel.
+ *
+ * @param t Filled with the target
+ */
+void render_get_target(render_target_t * t) {
+  uint core       = get_core_num();
+  bool interp     = interp_line_active && core == 1;
+  uint16_t width  = vga_get_playfield_width();
+  uint16_t height = vga_get_playfield_height();
+  t->clip         = (vga_rect_t) { clip_left[core], clip_top[core], MIN(clip_right[core], width - 1), MIN(clip_bottom[core], height - 1) };
+  t->base         = NULL;
+  t->stride       = 0;
+  t->async        = false;
+  if (rect_empty(t->clip)) return;
+#if PV_SPAN_CACHE_SPANS
+  if (span_recording && core == 1 && !interp) return; // Every pixel has to be recorded
+#endif
+
+  uint8_t * tile      = tile_target[core];
+  uint8_t * playfield = __vga_get_playfield();
+  if (tile && !interp) {
+    t->base   = tile; // The clip area is the tile
+    t->stride = PV_BIN_TILE_WIDTH;
+  } else if (playfield) {
+    t->base   = playfield + (uint32_t) t->clip.y1 * width + t->clip.x1;
+    t->stride = width;
+  } else if (__vga_get_packed_framebuffer()) {
+    return;
+  } else if (interp) {
+    t->base = __vga_get_frame_draw_addr()[__vga_get_row_line(t->clip.y1)] + t->clip.x1; // One row
+  } else if (!__vga_get_interp_ring()) {
+    t->base   = __vga_get_frame_draw_addr()[0] + (uint32_t) t->clip.y1 * width + t->clip.x1;
+    t->stride = width;
+  }
+  t->async = t->base && dma_band && core == 1 && !interp;
+}
+
+/**
+ * @brief Expand one row of the packed (4 or 2 bits per pixel) framebuffer into 8 bit color through the palette.
+ * Called from the line interpolation IRQ.
+ *
+ * @param y Row to expand, in screen space
+ * @param line Line buffer to write into (vga_get_width() bytes)
+ */
+void __not_in_flash_func(render_packed_line)(uint16_t y, uint8_t * line) {
+  uint16_t stride      = __vga_get_packed_stride();
+  const uint8_t * row  = __vga_get_packed_framebuffer() + y * stride;
+  const uint32_t * lut = __vga_get_palette_lut();
+
+  // One table lookup per packed byte, written out as a halfword (2 pixels) or word (4 pixels)
+  if (vga_get_config()->color_depth == VGA_COLOR_DEPTH_4BPP) {
+    uint16_t * out = (uint16_t *) line;
+    for (uint16_t i = 0; i < stride; i++) {
+      out[i] = lut[row[i]];
+    }
+  } else {
+    uint32_t * out = (uint32_t *) line;
+    for (uint16_t i = 0; i < stride; i++) {
+      out[i] = lut[row[i]];
+    }
+  }
+}
+
+uint16_t render_get_clip_top() {
+  return clip_top[get_core_num()];
+}
+
+uint16_t render_get_clip_bottom() {
+  return clip_bottom[get_core_num()];
+}
+
+uint16_t render_get_clip_left() {
+  return clip_left[get_core_num()];
+}
+
+uint16_t render_get_clip_right() {
+  return clip_right[get_core_num()];
 }
 
 uint8_t * render_get_pixel_ptr(uint16_t y, uint16_t x) {
-  return &(__vga_get_frame_read_addr()[y][x]);
+  return &(__vga_get_frame_draw_addr()[y][x]);
 }
 
 void vga_refresh() {
   update = true;
+  __sev();
+}
+
+/**
+ * @brief Forget everything the renderer knows about what's on the screen (the span cache, every item's bounding box and
+ * where it was drawn) and redraw all of it. For after the frame size changes. Core 1 only, between passes.
+ *
+ */
+void render_invalidate() {
+  const vga_config_t * config = vga_get_config();
+  for (uint16_t i = 0; i < config->render_queue_len; i++) {
+    update_item(&config->render_queue[i], false);
+  }
+  span_clear();
+  vga_refresh();
+}
+
+void render_init() {
+  if (!render_lock) {
+    render_lock = spin_lock_instance(spin_lock_claim_unused(true)); // Kept across vga_deinit()/vga_init()
+  }
+  memset(dirty, 0, sizeof(dirty));
+  memset(animated, 0, sizeof(animated));
+  span_clear();
+  render_dma_init();
+  dirty_words    = 0;
+  animated_words = 0;
+  num_bands      = 0;
+  next_band      = 0;
+  bands_done     = 0;
+}
+
+void render_mark_dirty(vga_render_item_t * item) {
+  const vga_config_t * config = vga_get_config();
+  if (!render_lock || !config || item < config->render_queue || item >= config->render_queue + MIN(config->render_queue_len, PV_MAX_RENDER_ITEMS)) return;
+
+  uint16_t i    = item - config->render_queue;
+  uint32_t save = spin_lock_blocking(render_lock);
+  dirty[i / 32] |= 1u << (i % 32);
+  dirty_words |= 1u << (i / 32);
+  spin_unlock(render_lock, save);
+  __sev(); // Wake the renderer up
+}
+
+void vga_render_help() {
+  // If there aren't any bands to draw, sleep until render() (or anything else) sends an event
+  const vga_config_t * config = vga_get_config();
+  if (!render_lock || !config || !config->dual_core_render || !render_bands()) {
+    __wfe();
+  }
+}
+
+void vga_get_render_profile(vga_render_profile_t * out) {
+  memset(out, 0, sizeof(*out));
+#if PV_RENDER_PROFILING
+  uint32_t window[PV_RENDER_PROFILE_WINDOW];
+  uint32_t seq;
+  do {
+    seq = profile_seq;
+    __dmb();
+    *out = profile;
+    memcpy(window, profile_window, sizeof(window));
+    __dmb();
+  } while ((seq & 1) || seq != profile_seq);
+
+  uint16_t n = MIN(out->passes, PV_RENDER_PROFILE_WINDOW);
+  if (n) {
+    uint64_t sum = 0;
+    out->min_us  = UINT32_MAX;
+    for (uint16_t j = 0; j < n; j++) {
+      out->min_us = MIN(out->min_us, window[j]);
+      out->max_us = MAX(out->max_us, window[j]);
+      sum += window[j];
+    }
+    out->avg_us = sum / n;
+  }
+  out->pixels_written = render_pixels_written[0] + render_pixels_written[1];
+#endif
+}
+
+void vga_reset_render_profile() {
+#if PV_RENDER_PROFILING
+  profile_reset = true;
+#endif
+}
+
+void vga_set_render_profile_items(uint32_t * item_us) {
+#if PV_RENDER_PROFILING
+  profile_item_us = item_us;
+#endif
 }
 
 /*
@@ -159,22 +1342,24 @@ void vga_refresh() {
 ==================================
 */
 
-// TODO: Add this back in
-/*
-volatile uint8_t lineInterpolationIRQ = 0;
+void render_interp_init() {
+  if (line_interp_irq < 0) {
+    line_interp_irq = user_irq_claim_unused(true); // Claimed on core 1, and kept across vga_deinit()/vga_init()
+  }
+  interp_frame_start = 0;
+  interp_row         = 0;
 
-static irq_handler_t lineInterpolationHandler() {
-  irq_clear(lineInterpolationIRQ);
+  irq_set_priority(line_interp_irq, PICO_LOWEST_IRQ_PRIORITY); // Must be lower than the DMA IRQ
+  irq_set_exclusive_handler(line_interp_irq, (irq_handler_t) line_interpolation_handler);
+  irq_set_enabled(line_interp_irq, true);
 }
 
-void initLineInterpolation() {
-  lineInterpolationIRQ = user_irq_claim_unused(true);
-  irq_set_priority(lineInterpolationIRQ, 255); // set to lowest priority, might change later based on testing
-  irq_set_exclusive_handler(lineInterpolationIRQ, (irq_handler_t) lineInterpolationHandler);
-  irq_set_enabled(31, true);
+void render_interp_stop() {
+  if (line_interp_irq >= 0) {
+    irq_set_enabled(line_interp_irq, false);
+  }
 }
 
-void deInitLineInterpolation() {
-  irq_set_enabled(31, false);
-  user_irq_unclaim(lineInterpolationIRQ);
-}*/
\ No newline at end of file
+void render_interp_trigger() {
+  irq_set_pending(line_interp_irq);
+}
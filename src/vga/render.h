@@ -3,9 +3,53 @@
 
 #include "vga.h"
 
+// Marks an interpolated line buffer that hasn't been rendered into yet
+#define INTERP_SLOT_EMPTY (UINT32_MAX)
+
+// Where the 2D rasterizers are drawing right now (see render_get_target()). Rasterizers clip to clip once, and then
+// write straight through base without any more checks. base is NULL when pixels have to go through render_pixel().
+typedef struct {
+  uint8_t * base;  // Pixel (clip.x1, clip.y1)
+  uint32_t stride; // Bytes from one row to the next
+  vga_rect_t clip; // Area that can be drawn to, already cut down to the playfield. Can be empty.
+  bool async;      // Fills and blits can go to the DMA engine (render_dma_fill()) and finish in the background
+} render_target_t;
+
+#if PV_RENDER_PROFILING
+extern volatile uint32_t render_pixels_written[2];
+#endif
+
+// Count pixels a renderer wrote, for vga_render_profile_t.pixels_written. Nothing without PV_RENDER_PROFILING.
+static inline void render_count_pixels(uint32_t count) {
+#if PV_RENDER_PROFILING
+  render_pixels_written[get_core_num()] += count;
+#endif
+}
+
 void render();
 void render_pixel(uint16_t y, uint16_t x, vga_color_t color);
+void render_span(uint16_t y, uint16_t x1, uint16_t x2, vga_color_t color);
+void render_fill_span(uint8_t * dst, vga_color_t color, uint32_t len);
+void render_get_target(render_target_t * t);
 uint8_t * render_get_pixel_ptr(uint16_t y, uint16_t x);
+uint16_t render_get_clip_top();
+uint16_t render_get_clip_bottom();
+uint16_t render_get_clip_left();
+uint16_t render_get_clip_right();
+
+void render_init();
+void render_invalidate();
+void render_mark_dirty(vga_render_item_t * item);
+
+void render_dma_init();
+void render_dma_fill(uint8_t * dst, uint32_t stride, uint16_t width, uint16_t height, vga_color_t color, vga_rect_t area);
+void render_dma_blit(uint8_t * dst, uint32_t stride, const uint8_t * src, uint32_t src_stride, uint16_t width, uint16_t height, vga_rect_t area);
+void render_dma_wait();
+void render_dma_wait_for(vga_rect_t area);
+
+void render_interp_init();
+void render_interp_stop();
+void render_interp_trigger();
 
 void render2d_fill(vga_color_t color);
 void render2d_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, vga_color_t color);
@@ -19,5 +63,20 @@ void render2d_polygon(uint16_t points[][2], uint16_t num_points, vga_color_t col
 void render2d_polygon_filled(uint16_t points[][2], const uint16_t num_points, vga_color_t color);
 void render2d_string(char * str, uint16_t x1, uint16_t y, uint16_t x2, bool wrap, vga_color_t color);
 void render2d_sprite(vga_color_t * sprite, uint16_t x, uint16_t y, uint16_t size_x, uint16_t size_y, vga_color_t null_color);
+void render2d_blit(vga_color_t * sprite, uint16_t x, uint16_t y, uint16_t size_x, uint16_t size_y);
+
+void render_packed_line(uint16_t y, uint8_t * line);
+void render_tile_line(uint16_t y, uint8_t * line);
+void render_scanline(uint16_t y, uint8_t * line);
+
+// Write a pixel inside t->clip, no checks
+static inline void render_target_pixel(const render_target_t * t, int32_t x, int32_t y, vga_color_t color) {
+  if (t->base) {
+    t->base[(y - t->clip.y1) * t->stride + (x - t->clip.x1)] = color;
+    render_count_pixels(1);
+  } else {
+    render_pixel(y, x, color);
+  }
+}
 
 #endif
\ No newline at end of file
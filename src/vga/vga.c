@@ -8,6 +8,7 @@
 #include "hardware/irq.h"
 #include "hardware/pio.h"
 #include "hardware/pwm.h"
+#include "hardware/sync.h"
 #include "pico/multicore.h"
 #include "render.h"
 
@@ -21,78 +22,531 @@
 
 #define SECOND_CORE_MAGIC (13)
 
+// PLL limits, see scripts/vcocalc.py
+#define PLL_REF_KHZ     (12000)
+#define PLL_VCO_MIN_KHZ (750000)
+#define PLL_VCO_MAX_KHZ (1600000)
+
+// Transfer size of the DMA channels that move pointers around (frame_read_addr). The host build's pointers are 64 bits.
+#ifndef DMA_SIZE_PTR
+#define DMA_SIZE_PTR DMA_SIZE_32
+#endif
+
 /************************************
  * PRIVATE TYPEDEFS
  ************************************/
 
+// Frame size for a config, see calc_frame_size()
+typedef struct {
+  uint16_t width;
+  uint16_t height;
+  uint16_t width_full;  // Including horizontal blanking, at the scaled pixel clock
+  uint16_t height_full; // Including vertical blanking
+} frame_size_t;
+
 /************************************
  * STATIC VARIABLES
  ************************************/
 
 static volatile vga_config_t * vga_config; // Can't pass params to irq handler, so we're doing this
 
-enum {
-  FRAME_WIDTH_IDX = 0,
-  FRAME_HEIGHT_IDX,
-  FRAME_WIDTH_FULL_IDX,
-  FRAME_HEIGHT_FULL_IDX,
+// Video modes for the base resolutions. Sources for the 640x480 timings, because they are slightly different
+// (for a 25MHz pixel clock, not 25.175MHz):
+// https://www.eevblog.com/forum/microcontrollers/implementing-a-vga-controller-on-spartan-3-board-with-25-0-mhz-clock/
+// pg 24: https://docs.xilinx.com/v/u/en-US/ug130
+static const vga_mode_t vga_modes[] = {
+  [RES_800x600]  = { .pixel_clock_khz = 40000, .clock_div = 3, // 120MHz system clock
+                     .h_visible = 800, .h_front_porch = 40, .h_sync = 128, .h_back_porch = 88, .h_sync_negative = false,
+                     .v_visible = 600, .v_front_porch = 1, .v_sync = 4, .v_back_porch = 23, .v_sync_negative = false },
+  [RES_640x480]  = { .pixel_clock_khz = 25000, .clock_div = 5, // 125MHz system clock
+                     .h_visible = 640, .h_front_porch = 16, .h_sync = 96, .h_back_porch = 48, .h_sync_negative = true,
+                     .v_visible = 480, .v_front_porch = 10, .v_sync = 2, .v_back_porch = 29, .v_sync_negative = true },
+  [RES_1024x768] = { .pixel_clock_khz = 65000, .clock_div = 2, // 130MHz system clock
+                     .h_visible = 1024, .h_front_porch = 24, .h_sync = 136, .h_back_porch = 160, .h_sync_negative = true,
+                     .v_visible = 768, .v_front_porch = 3, .v_sync = 6, .v_back_porch = 29, .v_sync_negative = true },
 };
-// Widths and heights for the three base resolutions
-static const uint16_t frame_size[3][4] = { { 800, 600, 1056, 628 },
-                                           { 640, 480, 800, 521 },
-                                           { 1024, 768, 1344, 806 } };
-#define LARGEST_FRAME_WIDTH       (768)
-#define LARGEST_FRAME_FULL_HEIGHT (1344)
+
+// One row for every vga_resolution_base_t. The rows themselves can't be checked at compile time (C doesn't treat a const
+// array's fields as constants), check_timing() refuses any that don't work and host/tests/test-mode-timings.c checks them all.
+_Static_assert(sizeof(vga_modes) / sizeof(vga_modes[0]) == RES_BASE_COUNT, "vga_modes needs exactly one row per vga_resolution_base_t");
+
+// Biggest visible area any mode can have (sizes the DMA tables)
+#define LARGEST_FRAME_WIDTH  (1024)
+#define LARGEST_FRAME_HEIGHT (768)
 
 static volatile uint16_t frame_width       = 0;
 static volatile uint16_t frame_height      = 0;
 static volatile uint16_t frame_width_full  = 0;
 static volatile uint16_t frame_height_full = 0;
 
-static volatile uint8_t frame_ctrl_dma = 0;
-static volatile uint8_t frame_data_dma = 0;
-static volatile uint8_t blank_data_dma = 0;
+static volatile uint8_t frame_ctrl_dma   = 0;
+static volatile uint8_t frame_data_dma   = 0;
+static volatile uint8_t blank_data_dma   = 0;
+static volatile uint8_t frame_reload_dma = 0;
+static volatile uint8_t frame_rearm_dma  = 0;
 
-static volatile uint8_t color_pio_sm = 0;
+static volatile uint8_t color_pio_sm     = 0;
+static volatile uint8_t color_pio_offset = 0;
 
-static volatile uint8_t framebuffer[PV_FRAMEBUFFER_BYTES];
+// Sync PWM counter values at the first visible pixel of a line (hsync) and the first visible line of a frame (vsync)
+static uint16_t hsync_visible_start = 0;
+static uint16_t vsync_visible_start = 0;
+static uint16_t sync_ticks_per_line = 16; // vsync and the frame slice count this much per line, see find_sync_ticks()
+
+static volatile uint8_t framebuffer[PV_FRAMEBUFFER_BYTES] __aligned(4);
 static const volatile uint8_t blank[LARGEST_FRAME_WIDTH]             = { 0 }; // ~0.7kB
-static volatile uint8_t * frame_read_addr[LARGEST_FRAME_FULL_HEIGHT] = { 0 }; // ~5.2kB
+// Line pointers for the DMA: every visible line, then a NULL that stops the DMA until the next frame
+static volatile uint8_t * frame_read_addr_bufs[2][LARGEST_FRAME_HEIGHT + 1] = { 0 }; // ~6.1kB
+
+// Double buffering. frame_read_addr is the table the DMA is sending out (front buffer), frame_draw_addr is the
+// one the renderer draws into (back buffer). They're the same table if double buffering is off.
+static volatile uint8_t ** volatile frame_read_addr = frame_read_addr_bufs[0];
+static volatile uint8_t ** volatile frame_draw_addr = frame_read_addr_bufs[0];
+static volatile bool flip_pending                   = false;
+static void (*volatile frame_done_callback)()       = NULL;
+static const uint32_t reload_trans_count            = 1; // frame_rearm_dma copies this to frame_reload_dma to arm it again
+
+// Line interpolation. If the whole frame doesn't fit in PV_FRAMEBUFFER_BYTES, the start of the framebuffer
+// is used as a ring of num_interpolated_lines line buffers, and the renderer fills them in just ahead of the DMA.
+static volatile uint8_t * interp_ring      = NULL; // NULL if the whole frame is buffered
+static volatile uint16_t num_buffered_lines = 0;
+
+// Absolute (never reset, wraps at 2^32) base resolution line number of the line that frame_ctrl_dma just
+// handed to frame_data_dma, and of the first line of the current frame
+static volatile uint32_t scanout_abs_line = 0;
+static volatile uint32_t scanout_frame_start = 0;
+
+// The absolute line number of the line currently held in each interpolated line buffer
+static volatile uint32_t interp_slot_line[UINT8_MAX + 1];
+static volatile uint32_t interp_late_lines = 0; // Interpolated lines the DMA read before they were rendered
+
+// Scanout health, see vga_get_scanout_stats(). Checked by the DMA IRQ.
+static volatile vga_scanout_stats_t scanout_stats = { .first_underrun_line = -1 };
+static volatile uint16_t last_irq_line            = 0; // Line the last line IRQ saw, to notice missed ones
+
+// Packed (4/2 bits per pixel) framebuffer, stored after the interpolated line ring. Every line is expanded
+// into the ring through palette_lut just before it's sent out.
+static volatile uint8_t * packed_fb = NULL; // NULL at 8 bits per pixel
+static uint16_t packed_stride       = 0;    // Bytes per row
+static vga_color_t palette[16]      = { COLOR_BLACK, COLOR_WHITE, COLOR_RED, COLOR_LIME, COLOR_BLUE, COLOR_YELLOW, COLOR_CYAN, COLOR_MAGENTA,
+                                        COLOR_SILVER, COLOR_GRAY, COLOR_MAROON, COLOR_OLIVE, COLOR_GREEN, COLOR_TEAL, COLOR_NAVY, COLOR_PURPLE };
+static uint32_t palette_lut[256]; // ~1kB
+
+// Scrolling playfield, see vga_scroll_region_t. Stored at the start of the framebuffer, playfield_width bytes per row.
+static volatile uint8_t * playfield = NULL; // NULL if there's no playfield
+static uint16_t playfield_width     = 0;
+static uint16_t playfield_height    = 0;
+static vga_scroll_region_t scroll_regions[PV_MAX_SCROLL_REGIONS];
+static volatile bool scroll_dirty = false; // Scroll changed, rewrite frame_read_addr at the start of vertical blanking
+
+// Vertical blanking. frame_count goes up by 1 at the start of every vertical blanking period, and the vblank
+// callback runs from DMA_IRQ_1 (forced by the DMA IRQ) on whichever core has it enabled.
+static volatile uint32_t frame_count      = 0;
+static void (*volatile vblank_callback)() = NULL;
+static volatile int8_t vblank_core        = -1;    // Core the callback should run on, -1 for none
+static volatile bool vblank_core1_enabled = false; // DMA_IRQ_1 enabled on core 1 (only core 1 can change it)
+
+// Live resolution switching, see vga_set_resolution()
+static volatile bool resolution_pending = false;
+static vga_resolution_base_t pending_base;
+static vga_resolution_scaled_t pending_scaled;
 
 /************************************
  * STATIC FUNCTIONS
  ************************************/
 
-// DMA Interrupt Callback
+static void apply_scroll();
+
+static inline uint16_t mode_width_full(const vga_mode_t * mode) {
+  return mode->h_visible + mode->h_front_porch + mode->h_sync + mode->h_back_porch;
+}
+
+static inline uint16_t mode_height_full(const vga_mode_t * mode) {
+  return mode->v_visible + mode->v_front_porch + mode->v_sync + mode->v_back_porch;
+}
+
+// System clock cycles per pixel for a config, before scaling
+static uint8_t config_clock_div(const vga_config_t * config) {
+  return config->pixel_clock_div ? config->pixel_clock_div : vga_modes[config->base_resolution].clock_div;
+}
+
+// Sticky "color state machine stalled on an empty TX FIFO" bit in FDEBUG. Nothing is pulled during vertical
+// blanking (see color.pio), so only an underrun can set it.
+static inline uint32_t color_txstall_bit() {
+  return 1u << (PIO_FDEBUG_TXSTALL_LSB + color_pio_sm);
+}
+
+// frame_ctrl_dma just handed frame_data_dma a line. Only enabled with line interpolation, which has to know where
+// the DMA is every line. Everything else happens once a frame in frame_irq().
+static void line_irq() {
+  // Grab the element in frame_read_addr that frame_ctrl_dma just wrote (hence the -1)
+  uint32_t line = ((volatile uint8_t **) dma_hw->ch[frame_ctrl_dma].read_addr - frame_read_addr) - 1;
+  if (line >= vga_modes[vga_config->base_resolution].v_visible) {
+    return; // The NULL at the end of the table, frame_irq() takes care of it
+  }
+  scanout_abs_line = scanout_frame_start + line;
+
+  // Scanout health: the DMA got more than a line ahead of this IRQ, or the color PIO just ran dry
+  if (line != 0 && line != last_irq_line + 1) {
+    scanout_stats.late_irqs++;
+  }
+  last_irq_line = line;
+  if ((vga_config->pio->fdebug & color_txstall_bit()) && scanout_stats.underrun_frames == 0 && scanout_stats.first_underrun_line < 0) {
+    scanout_stats.first_underrun_line = line;
+  }
+
+  // See if this line was an interpolated line. If it was, make sure the renderer actually got to it in time.
+  volatile uint8_t * line_ptr = frame_read_addr[line];
+  if (line_ptr >= interp_ring && line_ptr < interp_ring + vga_config->num_interpolated_lines * frame_width) {
+    uint8_t slot      = (line_ptr - interp_ring) / frame_width;
+    uint16_t row_line = __vga_get_row_line(line * frame_height / vga_modes[vga_config->base_resolution].v_visible);
+    if (interp_slot_line[slot] != scanout_abs_line - (line - row_line)) {
+      interp_late_lines++;
+    }
+  }
+
+  // Kick the renderer so it can start on the next interpolated line
+  render_interp_trigger();
+}
+
+// End of the visible part of the frame. frame_ctrl_dma wrote the NULL at the end of frame_read_addr to frame_data_dma,
+// which stops the DMA chain and (frame_data_dma is IRQ quiet) raises this, once a frame. The color state machine counts
+// out vertical blanking by itself and frame_reload_dma restarts the chain just before the next frame, so there's nothing
+// here the color signal has to wait on.
+static void frame_irq() {
+  uint16_t height = vga_modes[vga_config->base_resolution].v_visible;
+  bool restarted  = dma_hw->ch[frame_ctrl_dma].read_addr != (io_rw_32) &frame_read_addr[height + 1];
+
+  // Scanout health, once a frame
+  scanout_stats.frames++;
+  if (restarted) {
+    scanout_stats.late_irqs++; // frame_reload_dma already restarted the DMA for the next frame
+  }
+  if (vga_config->pio->fdebug & color_txstall_bit()) {
+    if (scanout_stats.underrun_frames++ == 0) {
+      scanout_stats.first_underrun_frame = frame_count;
+    }
+    vga_config->pio->fdebug = color_txstall_bit(); // Write 1 to clear
+  }
+  const uint8_t scanout_dma[] = { frame_ctrl_dma, frame_data_dma, blank_data_dma, frame_reload_dma, frame_rearm_dma };
+  bool dma_error              = false;
+  for (int i = 0; i < sizeof(scanout_dma); i++) {
+    if (dma_hw->ch[scanout_dma[i]].al1_ctrl & DMA_CH0_CTRL_TRIG_AHB_ERROR_BITS) {
+      dma_error = true;
+      hw_set_bits(&dma_hw->ch[scanout_dma[i]].al1_ctrl, DMA_CH0_CTRL_TRIG_READ_ERROR_BITS | DMA_CH0_CTRL_TRIG_WRITE_ERROR_BITS); // Write 1 to clear
+    }
+  }
+  if (dma_error) {
+    scanout_stats.dma_errors++;
+  }
+
+  // The DMA is stopped until a line before the next frame, so this is the only place the buffers can be flipped without
+  // the DMA sending out half of each. If this IRQ was held up until frame_reload_dma already restarted it, wait a frame.
+  if (flip_pending && !restarted) {
+    volatile uint8_t ** temp = frame_read_addr;
+    frame_read_addr          = frame_draw_addr;
+    frame_draw_addr          = temp;
+    flip_pending             = false;
+  }
+
+  // The renderer doesn't hear from line_irq() until the next frame, let it fill up the line buffers in the meantime
+  if (interp_ring) {
+    scanout_abs_line = scanout_frame_start + height;
+    render_interp_trigger();
+  }
+
+  // Start of vertical blanking: count the frame, run the callback and wake up anything in vga_wait_vblank()
+  scanout_frame_start += mode_height_full(&vga_modes[vga_config->base_resolution]);
+  frame_count++;
+  if (scroll_dirty) {
+    apply_scroll(); // None of the visible lines are being read right now
+  }
+  if (vblank_callback) {
+    dma_hw->intf1 = 1u << frame_ctrl_dma;
+  }
+  __sev();
+
+  // Only core 1 can enable its own IRQs, so vga_set_vblank_callback() leaves that to this IRQ
+  if (vblank_core1_enabled != (vblank_core == 1)) {
+    vblank_core1_enabled = vblank_core == 1;
+    irq_set_enabled(DMA_IRQ_1, vblank_core1_enabled);
+  }
+}
+
+// DMA Interrupt Callback. Line first: it belongs to the frame that's ending.
 static void update_frame_ptr() {
-  dma_channel_acknowledge_irq0(frame_ctrl_dma);
+  if (dma_hw->ints0 & (1u << frame_ctrl_dma)) {
+    dma_channel_acknowledge_irq0(frame_ctrl_dma);
+    line_irq();
+  }
+  if (dma_hw->ints0 & (1u << frame_data_dma)) {
+    dma_channel_acknowledge_irq0(frame_data_dma);
+    frame_irq();
+  }
+}
+
+// Find the color PIO clock divider (in 1/256ths of a cycle) that gets closest to a scaled width.
+// The DMA sends whole words every line, and each line (including blanking) has to take exactly as many
+// system clock cycles as it does at the base resolution or the picture drifts. Not every width can do that,
+// so the width gets rounded to the closest one that can. Only even dividers work, the color PIO takes 2 cycles a pixel.
+static uint32_t find_color_div(const vga_mode_t * mode, uint8_t clock_div, uint16_t width) {
+  uint32_t line_cycles    = mode_width_full(mode) * clock_div * 256;
+  uint32_t visible_cycles = mode->h_visible * clock_div * 256;
+  uint32_t best_div       = clock_div * 256;
+  uint32_t best_err       = UINT32_MAX;
+
+  for (uint32_t div = clock_div * 256; div <= clock_div * 256 * 8; div += 2) {
+    if (line_cycles % div != 0 || (line_cycles / div) % 4 != 0) continue;
+
+    uint32_t err = ABS((int32_t) ((visible_cycles / div) & ~3u) - (int32_t) width);
+    if (err < best_err) {
+      best_err = err;
+      best_div = div;
+    }
+  }
+  return best_div;
+}
 
-  // TODO: Add this back in
-  // Grab the element in frameReadAddr that frame_ctrl_dma just wrote (hence the -1) and see if it was an
-  // interpolated line. If so, incrememt the interpolated line counter and flag the renderer so it can start
-  // re-rendering it.
-  // if (config->interpolated_mode && (((uint8_t *) dma_hw->ch[frame_ctrl_dma].read_addr) - 1) < frameBufferStart && (((uint8_t *) dma_hw->ch[frame_ctrl_dma].read_addr) - 1) >= (blankLineStart + frame_width)) {
-  //   interpolatedLine = (interpolatedLine + 1) % config->num_interpolated_lines;
-  //   irq_set_pending(lineInterpolationIRQ);
-  // }
+// Work out the frame size for a config.
+// Returns the color PIO clock divider in 1/256ths, which sets the horizontal scale.
+static uint32_t calc_frame_size(const vga_config_t * config, frame_size_t * size) {
+  const vga_mode_t * mode = &vga_modes[config->base_resolution];
+  uint16_t width_full     = mode_width_full(mode);
+  uint16_t height_full    = mode_height_full(mode);
+  uint32_t base_div       = config_clock_div(config) * 256;
+
+  if (config->scaled_width && config->scaled_height) {
+    uint32_t color_div = find_color_div(mode, config_clock_div(config), config->scaled_width);
+    size->width        = ((mode->h_visible * base_div) / color_div) & ~3u;
+    size->width_full   = (width_full * base_div) / color_div;
+    size->height       = MIN(config->scaled_height, mode->v_visible);
+    size->height_full  = height_full * size->height / mode->v_visible;
+    return color_div;
+  }
+
+  size->width       = mode->h_visible / config->scaled_resolution;
+  size->height      = mode->v_visible / config->scaled_resolution;
+  size->width_full  = width_full / config->scaled_resolution;
+  size->height_full = height_full / config->scaled_resolution;
+  return base_div * config->scaled_resolution;
+}
+
+// C port of scripts/vcocalc.py: PLL settings for a system clock, from the 12MHz crystal. Goes through the VCO frequencies
+// from the top down and prefers a bigger PD1 like the script does, but only takes exact matches (every line has to be a
+// whole number of system clock cycles). Returns nonzero if there aren't any.
+static int find_sys_pll(uint32_t sys_khz, uint32_t * vco_hz, uint * pd1, uint * pd2) {
+  for (uint fbdiv = 320; fbdiv >= 16; fbdiv--) {
+    uint32_t vco_khz = PLL_REF_KHZ * fbdiv;
+    if (vco_khz < PLL_VCO_MIN_KHZ || vco_khz > PLL_VCO_MAX_KHZ) continue;
+
+    for (uint post_div2 = 1; post_div2 <= 7; post_div2++) {
+      for (uint post_div1 = 1; post_div1 <= 7; post_div1++) {
+        if (vco_khz == sys_khz * post_div1 * post_div2) {
+          *vco_hz = vco_khz * 1000;
+          *pd1    = post_div1;
+          *pd2    = post_div2;
+          return 0;
+        }
+      }
+    }
+  }
+  return 1;
+}
 
-  // If the DMA read "cursor" is past the end of the frame data, reset it to the beginning
-  if (dma_hw->ch[frame_ctrl_dma].read_addr >= (io_rw_32) &frame_read_addr[frame_size[vga_config->base_resolution][FRAME_HEIGHT_FULL_IDX]]) {
-    dma_hw->ch[frame_ctrl_dma].read_addr = (io_rw_32) frame_read_addr;
+// Ticks per line for vsync and the frame slice. A whole line is too long for the PWM clock divider (max /256, 4 fraction
+// bits), so they count a few times a line: the fewest ticks (at least 16) that divide a line exactly, with the whole frame
+// still fitting in the 16 bit counter. Returns 0 if nothing works.
+static uint16_t find_sync_ticks(uint32_t line_cycles, uint16_t height_full) {
+  for (uint16_t ticks = 16; ticks <= 256 && (uint32_t) height_full * ticks <= 0x10000; ticks *= 2) {
+    if (line_cycles / ticks < 256 && (line_cycles * 16) % ticks == 0) return ticks;
+  }
+  return 0;
+}
+
+// Returns nonzero if a mode can't be done at clock_div system clock cycles per pixel: the PLL has to hit the system clock
+// exactly, the sync PWM slices have to be able to count out a frame, and the color PIO needs 2 cycles a pixel.
+// Gets the PLL settings if it can.
+static int check_timing(const vga_mode_t * mode, uint8_t clock_div, uint32_t * vco_hz, uint * pd1, uint * pd2) {
+  if (clock_div < 2 || mode->h_visible > LARGEST_FRAME_WIDTH || mode->v_visible > LARGEST_FRAME_HEIGHT || mode->h_visible % 4) return 1;
+  if (find_sync_ticks(mode_width_full(mode) * clock_div, mode_height_full(mode)) == 0) return 1;
+  return find_sys_pll(mode->pixel_clock_khz * clock_div, vco_hz, pd1, pd2);
+}
+
+// Returns nonzero if a config can't be done: the mode's timing doesn't work (see check_timing()) or it doesn't
+// fit in the framebuffer at this frame size
+static int check_mode(const vga_config_t * config, const frame_size_t * size) {
+  uint16_t width  = size->width;
+  uint16_t height = size->height;
+  bool line_mode  = config->tilemap || config->scanline_render || config->color_depth != VGA_COLOR_DEPTH_8BPP; // Every line built on the fly
+
+  uint32_t vco_hz;
+  uint pd1, pd2;
+  if (check_timing(&vga_modes[config->base_resolution], config_clock_div(config), &vco_hz, &pd1, &pd2)) return 1;
+
+  // Fail if the frame buffer is too small to hold the interpolated lines and a few buffered lines (tile mode only needs the interpolated lines)
+  if (PV_FRAMEBUFFER_BYTES < width * (config->num_interpolated_lines + (line_mode ? 0 : 3))) return 1;
+
+  // The whole playfield has to be buffered, and be at least as big as the screen
+  if (config->playfield_width || config->playfield_height) {
+    if (line_mode || config->double_buffered || config->playfield_width < width || config->playfield_height < height || config->playfield_width % 4) return 1;
+    if ((uint32_t) config->playfield_width * config->playfield_height > PV_FRAMEBUFFER_BYTES) return 1;
+  }
+  if (config->scanline_render && config->render_queue_len > PV_SCANLINE_MAX_ITEMS) return 1;
+  if (config->auto_render && config->render_queue_len > PV_MAX_RENDER_ITEMS) return 1;
+  if (config->binned_render && config->color_depth != VGA_COLOR_DEPTH_8BPP) return 1;
+
+  // Double buffering needs 2 full frames, no interpolation
+  if (config->double_buffered && (line_mode || 2 * (uint32_t) width * height > PV_FRAMEBUFFER_BYTES)) return 1;
+
+  if (config->color_depth != VGA_COLOR_DEPTH_8BPP) {
+    // The whole packed frame has to fit after the line buffers
+    if (config->tilemap || config->scanline_render) return 1;
+    uint16_t stride = config->color_depth == VGA_COLOR_DEPTH_4BPP ? width / 2 : width / 4;
+    if (config->num_interpolated_lines * width + (uint32_t) stride * height > PV_FRAMEBUFFER_BYTES) return 1;
+  }
+  return 0;
+}
+
+// Point every visible line in frame_read_addr at the playfield row and column its scroll region is showing
+static void apply_scroll() {
+  scroll_dirty = false;
+  for (uint16_t y = 0; y < frame_height; y++) {
+    uint16_t src_y = y;
+    uint16_t src_x = 0;
+    for (int r = 0; r < PV_MAX_SCROLL_REGIONS; r++) {
+      const vga_scroll_region_t * region = &scroll_regions[r];
+      if (region->top <= region->bottom && y >= region->top && y <= region->bottom && region->src_height) {
+        src_y = region->src_top + (y - region->top + region->scroll_y) % region->src_height;
+        src_x = MIN(region->scroll_x, playfield_width - frame_width) & ~3u;
+        break;
+      }
+    }
+
+    volatile uint8_t * line_ptr = playfield + (uint32_t) MIN(src_y, playfield_height - 1) * playfield_width + src_x;
+    for (int l = __vga_get_row_line(y); l < __vga_get_row_line(y + 1); l++) {
+      frame_read_addr[l] = line_ptr;
+    }
+  }
+}
+
+// DMA_IRQ_1, only ever forced by update_frame_ptr() at the start of vertical blanking
+static void vblank_irq_handler() {
+  dma_hw->intf1 = 0;
+  if (vblank_callback) {
+    vblank_callback();
+  }
+}
+
+// Fill frame_read_addr for the current config (which has to pass check_mode()). Buffers as much of the frame
+// as PV_FRAMEBUFFER_BYTES allows and spreads the rest of the lines (interpolated lines) evenly through the frame.
+static void build_frame_read_addr(vga_config_t * config) {
+  uint16_t num_interp_lines = 0;
+  uint16_t base_height      = vga_modes[config->base_resolution].v_visible;
+  frame_read_addr           = frame_read_addr_bufs[0];
+  frame_draw_addr           = frame_read_addr_bufs[0];
+  flip_pending              = false;
+  packed_fb                 = NULL;
+  playfield                 = NULL;
+
+  if (config->color_depth != VGA_COLOR_DEPTH_8BPP) {
+    packed_stride = config->color_depth == VGA_COLOR_DEPTH_4BPP ? frame_width / 2 : frame_width / 4;
+    packed_fb     = framebuffer + config->num_interpolated_lines * frame_width;
+    vga_set_palette(palette, 16); // Build the lookup table for this color depth
+  }
+
+  if (config->tilemap || config->scanline_render || packed_fb) {
+    // Tile mode/scanline renderer/packed framebuffer, every line is built on the fly
+    interp_ring        = framebuffer;
+    num_buffered_lines = 0;
+    num_interp_lines   = frame_height;
+    for (int i = 0; i <= UINT8_MAX; i++) {
+      interp_slot_line[i] = INTERP_SLOT_EMPTY;
+    }
+  } else if ((uint32_t) frame_width * frame_height <= PV_FRAMEBUFFER_BYTES) {
+    // Whole frame fits, no interpolation
+    interp_ring        = NULL;
+    num_buffered_lines = frame_height;
+  } else {
+    interp_ring        = framebuffer;
+    num_buffered_lines = (PV_FRAMEBUFFER_BYTES - config->num_interpolated_lines * frame_width) / frame_width;
+    num_interp_lines   = frame_height - num_buffered_lines;
+    for (int i = 0; i <= UINT8_MAX; i++) {
+      interp_slot_line[i] = INTERP_SLOT_EMPTY;
+    }
+  }
+  volatile uint8_t * buffered_start = framebuffer + (interp_ring ? config->num_interpolated_lines * frame_width : 0);
+
+  /*
+      Even distribution algorithm:
+  - Splits the frame into num_interp_lines segments, and the first line of every segment is interpolated.
+  - The length of each segment is segment_len, but since the number of interpolated lines will almost never
+    perfectly divide into the number of total lines there are num_spares lines left over.
+  - Instead of putting all of the spares at the end (making the CPU work harder in the beginning of the
+    frame), this adds 1 line to the first num_spares segments.
+  - This reddit post explains it: https://www.reddit.com/r/learnprogramming/comments/31ns44/splitting_the_contents_of_an_array_into_as_evenly/
+  - i = line in frame, j = buffered line counter, k = interpolated line counter, l = line doubling counter
+  */
+  uint16_t segment_len  = num_interp_lines ? frame_height / num_interp_lines : 0;
+  uint16_t num_spares   = num_interp_lines ? frame_height % num_interp_lines : 0;
+  uint16_t segment_left = 0; // Lines left in the current segment
+  for (int i = 0, j = 0, k = 0; i < frame_height; i++) {
+    volatile uint8_t * line_ptr;
+    if (num_interp_lines && segment_left == 0) {
+      // Start of a new segment, interpolate this line
+      segment_left = segment_len;
+      if (num_spares) {
+        segment_left++;
+        num_spares--;
+      }
+      line_ptr = interp_ring + k * frame_width;
+      k        = (k + 1) % config->num_interpolated_lines;
+    } else {
+      // If this line isn't interpolated, grab the next buffered line from the framebuffer
+      line_ptr = buffered_start + frame_width * j;
+      j++;
+    }
+    segment_left--;
+
+    // Line doubling, see render_pixel()
+    for (int l = __vga_get_row_line(i); l < __vga_get_row_line(i + 1); l++) {
+      frame_read_addr[l] = line_ptr;
+    }
+  }
+
+  // Playfield: whole thing is buffered, the scroll regions decide which lines go where
+  if (config->playfield_width) {
+    playfield        = framebuffer;
+    playfield_width  = config->playfield_width;
+    playfield_height = config->playfield_height;
+    apply_scroll();
+  }
+
+  // Nothing gets sent for vertical blanking (see color.pio), the NULL stops the DMA chain until the next frame
+  frame_read_addr[base_height] = NULL;
+
+  // Back buffer: same layout, pointing at the second frame in the framebuffer
+  if (config->double_buffered) {
+    for (int i = 0; i < base_height; i++) {
+      frame_read_addr_bufs[1][i] = frame_read_addr_bufs[0][i] + frame_width * frame_height;
+    }
+    frame_read_addr_bufs[1][base_height] = NULL;
+    frame_draw_addr                      = frame_read_addr_bufs[1];
   }
 }
 
 static void dma_init(vga_config_t * config) {
-  frame_ctrl_dma = dma_claim_unused_channel(true);
-  frame_data_dma = dma_claim_unused_channel(true);
-  blank_data_dma = dma_claim_unused_channel(true);
+  frame_ctrl_dma   = dma_claim_unused_channel(true);
+  frame_data_dma   = dma_claim_unused_channel(true);
+  blank_data_dma   = dma_claim_unused_channel(true);
+  frame_reload_dma = dma_claim_unused_channel(true);
+  frame_rearm_dma  = dma_claim_unused_channel(true);
 
   // Default channel config is **NOT** the same as the register reset values. See pg 106 of C SDK docs for info.
 
   // &frame_read_addr[i] -> frame_data_dma.read_addr (tell frame_data_dma where to read from)
   dma_channel_config frame_ctrl_config = dma_channel_get_default_config(frame_ctrl_dma);
   channel_config_set_high_priority(&frame_ctrl_config, true);
-  channel_config_set_transfer_data_size(&frame_ctrl_config, DMA_SIZE_32);
+  channel_config_set_transfer_data_size(&frame_ctrl_config, DMA_SIZE_PTR);
   dma_channel_configure(frame_ctrl_dma, &frame_ctrl_config, &dma_hw->ch[frame_data_dma].al3_read_addr_trig, frame_read_addr, 1, false);
 
   // frame_read_addr[i] -> pioX->txfifo (read from the address in frame_read_addr, send to PIO)
@@ -114,23 +568,145 @@ static void dma_init(vga_config_t * config) {
   channel_config_set_irq_quiet(&blank_data_config, true);
   dma_channel_configure(blank_data_dma, &blank_data_config, &(config->pio)->txf[color_pio_sm], blank, (frame_width_full - frame_width) / 4, false);
 
-  dma_channel_set_irq0_enabled(frame_ctrl_dma, true);
+  // frame_read_addr -> frame_ctrl_dma.read_addr (restart the chain at the top of the frame, once a frame when the frame PWM slice wraps)
+  dma_channel_config frame_reload_config = dma_channel_get_default_config(frame_reload_dma);
+  channel_config_set_high_priority(&frame_reload_config, true);
+  channel_config_set_transfer_data_size(&frame_reload_config, DMA_SIZE_PTR);
+  channel_config_set_read_increment(&frame_reload_config, false);
+  channel_config_set_chain_to(&frame_reload_config, frame_rearm_dma);
+  channel_config_set_dreq(&frame_reload_config, pwm_get_dreq(FRAME_PWM_SLICE));
+  channel_config_set_irq_quiet(&frame_reload_config, true);
+  dma_channel_configure(frame_reload_dma, &frame_reload_config, &dma_hw->ch[frame_ctrl_dma].al3_read_addr_trig, &frame_read_addr, 1, true); // Armed, waits for the PWM
+
+  // 1 -> frame_reload_dma.transfer_count (arm frame_reload_dma again for the next frame)
+  dma_channel_config frame_rearm_config = dma_channel_get_default_config(frame_rearm_dma);
+  channel_config_set_transfer_data_size(&frame_rearm_config, DMA_SIZE_32);
+  channel_config_set_read_increment(&frame_rearm_config, false);
+  channel_config_set_irq_quiet(&frame_rearm_config, true);
+  dma_channel_configure(frame_rearm_dma, &frame_rearm_config, &dma_hw->ch[frame_reload_dma].al1_transfer_count_trig, &reload_trans_count, 1, false);
+
+  // Once a frame: frame_data_dma gets the NULL at the end of the table. Every line: only for line interpolation.
+  dma_channel_set_irq0_enabled(frame_data_dma, true);
+  dma_channel_set_irq0_enabled(frame_ctrl_dma, interp_ring != NULL);
   irq_set_priority(DMA_IRQ_0, 0); // Set the DMA interrupt to the highest priority
 
   irq_set_exclusive_handler(DMA_IRQ_0, (irq_handler_t) update_frame_ptr);
   irq_set_enabled(DMA_IRQ_0, true);
+  irq_set_priority(DMA_IRQ_1, PICO_LOWEST_IRQ_PRIORITY); // vblank callback, if it's on this core. Enabled by update_frame_ptr().
+  vblank_core1_enabled = false;
 
   dma_channel_start(frame_ctrl_dma); // Start!
 }
 
-static void second_core_init() {
-  dma_init(vga_config); // Must be run here so the IRQ runs on the second core
+// Start the scanout with everything set up for the current mode (sync_init(), color_program_init() and
+// build_frame_read_addr() done). Core 1 only, so the IRQs run there.
+static void start_scanout() {
+  if (interp_ring) {
+    render_interp_init(); // Before dma_init() starts the DMA, the first line IRQ pends it
+  }
+  dma_init(vga_config);
+
+  vga_config->pio->fdebug = color_txstall_bit();                    // Clear any old underrun (see vga_get_scanout_stats())
+  pio_enable_sm_mask_in_sync(vga_config->pio, 1u << color_pio_sm); // start color state machine and clock
+  pwm_set_mask_enabled(pwm_hw->en | (1u << HSYNC_PWM_SLICE) | (1u << VSYNC_PWM_SLICE) | (1u << FRAME_PWM_SLICE)); // DO NOT use pwm_set_enabled, it breaks things
+}
+
+// Stop the scanout and give back the DMA channels dma_init() claimed. The color state machine stays loaded.
+static void stop_scanout() {
+  irq_set_enabled(DMA_IRQ_0, false); // Disable IRQ first, see pg 93 of C SDK docs
+  render_interp_stop();
+  dma_channel_abort(frame_reload_dma); // Before frame_ctrl_dma so it can't restart it
+  dma_channel_abort(frame_rearm_dma);
+  dma_channel_abort(frame_ctrl_dma);
+  dma_channel_abort(frame_data_dma);
+  dma_channel_abort(blank_data_dma);
+  dma_channel_acknowledge_irq0(frame_ctrl_dma); // Aborting can raise a spurious IRQ
+  dma_channel_acknowledge_irq0(frame_data_dma);
+
+  dma_unclaim_mask((1 << frame_ctrl_dma) | (1 << frame_data_dma) | (1 << blank_data_dma) | (1 << frame_reload_dma) | (1 << frame_rearm_dma));
+
+  pio_sm_set_enabled(vga_config->pio, color_pio_sm, false);
+  pio_sm_clear_fifos(vga_config->pio, color_pio_sm);
+
+  pwm_set_enabled(HSYNC_PWM_SLICE, false);
+  pwm_set_enabled(VSYNC_PWM_SLICE, false);
+  pwm_set_enabled(FRAME_PWM_SLICE, false);
+}
+
+// Stop just the color signal, at the start of vertical blanking (the pins are already low). The system clock and the
+// sync PWM slices keep running and the DMA channels stay claimed, see resume_color().
+static void pause_color() {
+  irq_set_enabled(DMA_IRQ_0, false);
+  render_interp_stop();
+  pio_sm_set_enabled(vga_config->pio, color_pio_sm, false);
+}
 
-  pio_enable_sm_mask_in_sync(vga_config->pio, 1u << color_pio_sm);         // start color state machine and clock
-  pwm_set_mask_enabled((1u << HSYNC_PWM_SLICE) | (1u << VSYNC_PWM_SLICE)); // DO NOT use pwm_set_enabled, it breaks things
+// Start the DMA chain over for the current frame size, armed for the next time the frame PWM slice wraps. The color
+// state machine has to be stopped.
+static void arm_color_dma() {
+  dma_channel_abort(frame_reload_dma); // Before frame_ctrl_dma so it can't restart it
+  dma_channel_abort(frame_rearm_dma);
+  dma_channel_abort(frame_ctrl_dma);
+  dma_channel_abort(frame_data_dma);
+  dma_channel_abort(blank_data_dma);
+  dma_channel_acknowledge_irq0(frame_ctrl_dma); // Aborting can raise a spurious IRQ
+  dma_channel_acknowledge_irq0(frame_data_dma);
+  pio_sm_clear_fifos(vga_config->pio, color_pio_sm);
+
+  dma_channel_set_trans_count(frame_ctrl_dma, 1, false);
+  dma_channel_set_trans_count(frame_data_dma, frame_width / 4, false);
+  dma_channel_set_trans_count(blank_data_dma, (frame_width_full - frame_width) / 4, false);
+  dma_channel_set_irq0_enabled(frame_ctrl_dma, interp_ring != NULL);
+  dma_channel_set_trans_count(frame_reload_dma, 1, true); // Armed again, waits for the frame PWM slice
+}
+
+// Start the color signal again after pause_color(), once color_program_init() and build_frame_read_addr() are done for
+// the new size. The sync signals never stopped, so the color state machine has to start right on the first visible
+// pixel of a frame: when the frame slice counts up to sync_ticks_per_line (see sync_init()), a line after it wrapped
+// and restarted the DMA, so the TX FIFO is full by then.
+static void resume_color() {
+  // Fill up the line buffers now. Nothing triggers the renderer again until the DMA IRQ is back on, so it can't hold
+  // up the wait below.
+  if (interp_ring) {
+    render_interp_init();
+    render_interp_trigger();
+  }
+  vga_config->pio->fdebug = color_txstall_bit(); // Clear any old underrun (see vga_get_scanout_stats())
+
+  while (true) {
+    arm_color_dma();
+    uint16_t last  = pwm_get_counter(FRAME_PWM_SLICE);
+    uint16_t count = last;
+    while (count >= last) { // Until the frame slice wraps
+      last  = count;
+      count = pwm_get_counter(FRAME_PWM_SLICE);
+      tight_loop_contents();
+    }
+    while (count < sync_ticks_per_line) {
+      count = pwm_get_counter(FRAME_PWM_SLICE);
+    }
+    if (count == sync_ticks_per_line) break;
+    // Vertical blanking is plenty of time to get here, but something held this up past the first pixel and the DMA
+    // went ahead without the color state machine. Start it over and try again with the next frame.
+  }
+  pio_sm_set_enabled(vga_config->pio, color_pio_sm, true);
+  irq_set_enabled(DMA_IRQ_0, true); // The first line IRQ is pending by now
+}
+
+static void second_core_init() {
+  start_scanout(); // Must be run here so the IRQs run on the second core
 
   multicore_fifo_push_blocking(SECOND_CORE_MAGIC);
 
+  // Tile mode and the scanline renderer don't need the render loop, everything happens in the line interpolation IRQ.
+  // Core 1 just waits around for resolution changes (vga_set_resolution() sends an event).
+  if (vga_config->tilemap || vga_config->scanline_render) {
+    while (true) {
+      __wfe();
+      __vga_switch_resolution();
+    }
+  }
+
   if (vga_config->antialiasing) {
     render(); // TODO: add antialiasing support
   } else {
@@ -138,162 +714,139 @@ static void second_core_init() {
   }
 }
 
+// Set the system clock and the sync PWM slices up for a base resolution at clock_div system clock cycles per pixel
+// (PWM slices are left disabled). Returns nonzero if the timing can't be done, see check_timing().
+static int sync_init(vga_resolution_base_t base, uint8_t clock_div) {
+  const vga_mode_t * mode = &vga_modes[base];
+  uint32_t vco_hz;
+  uint pd1, pd2;
+  if (check_timing(mode, clock_div, &vco_hz, &pd1, &pd2)) return 1;
+
+  pwm_config default_pwm_conf = pwm_get_default_config();
+  pwm_init(HSYNC_PWM_SLICE, &default_pwm_conf, false); // reset to known state
+  pwm_init(VSYNC_PWM_SLICE, &default_pwm_conf, false);
+  pwm_init(FRAME_PWM_SLICE, &default_pwm_conf, false);
+
+  set_sys_clock_pll(vco_hz, pd1, pd2); // System clock is a multiple of the pixel clock
+
+  uint16_t height_full = mode_height_full(mode);
+  uint32_t line_cycles = mode_width_full(mode) * clock_div;
+  sync_ticks_per_line  = find_sync_ticks(line_cycles, height_full);
+  uint8_t tick_div     = line_cycles / sync_ticks_per_line;
+  uint8_t tick_frac    = (line_cycles * 16 / sync_ticks_per_line) % 16;
+
+  // hsync counts pixels, 0 is the start of the sync pulse
+  pwm_set_output_polarity(HSYNC_PWM_SLICE, mode->h_sync_negative, mode->h_sync_negative);
+  pwm_set_clkdiv_int_frac(HSYNC_PWM_SLICE, clock_div, 0);            // pixel clock
+  pwm_set_wrap(HSYNC_PWM_SLICE, mode_width_full(mode) - 1);          // full line width - 1
+  hsync_visible_start = mode->h_sync + mode->h_back_porch;           // sync pulse + back porch
+  pwm_set_counter(HSYNC_PWM_SLICE, hsync_visible_start);
+  pwm_set_chan_level(HSYNC_PWM_SLICE, HSYNC_PWM_CHAN, mode->h_sync); // sync pulse
+
+  // vsync counts sync_ticks_per_line a line, 0 is the start of the sync pulse
+  pwm_set_output_polarity(VSYNC_PWM_SLICE, mode->v_sync_negative, mode->v_sync_negative);
+  pwm_set_clkdiv_int_frac(VSYNC_PWM_SLICE, tick_div, tick_frac);
+  pwm_set_wrap(VSYNC_PWM_SLICE, height_full * sync_ticks_per_line - 1);                  // full frame height - 1
+  vsync_visible_start = (mode->v_sync + mode->v_back_porch) * sync_ticks_per_line;       // sync pulse + back porch
+  pwm_set_counter(VSYNC_PWM_SLICE, vsync_visible_start);
+  pwm_set_chan_level(VSYNC_PWM_SLICE, VSYNC_PWM_CHAN, mode->v_sync * sync_ticks_per_line); // sync pulse
+
+  // Frame slice, no pin. Same clock as vsync, wraps once a frame a line before the first visible line, which triggers
+  // frame_reload_dma. The color state machine counts out vertical blanking by itself, the DMA just has to be going by then.
+  pwm_set_clkdiv_int_frac(FRAME_PWM_SLICE, tick_div, tick_frac);
+  pwm_set_wrap(FRAME_PWM_SLICE, height_full * sync_ticks_per_line - 1);
+  pwm_set_counter(FRAME_PWM_SLICE, sync_ticks_per_line); // Lined up with hsync and vsync (first visible pixel)
+  return 0;
+}
+
+// Switch to the pending resolution at the start of vertical blanking. Runs on core 1 in thread mode (see
+// __vga_switch_resolution()). A new scale at the same base resolution only touches the color signal: the system clock
+// and the sync PWM slices keep running, and the color state machine and the DMA pick up the new size with the next
+// frame, so the monitor doesn't notice. A new base resolution stops the scanout, reclocks, sets the sync signals up for
+// the new mode and starts everything again in sync like vga_init() does. Only then does the monitor have to resync.
+static void switch_resolution() {
+  vga_wait_vblank(); // Don't cut a frame off halfway down the screen
+  bool base_changed = pending_base != vga_config->base_resolution;
+  if (base_changed) {
+    stop_scanout();
+  } else {
+    pause_color();
+  }
+
+  vga_config->base_resolution   = pending_base;
+  vga_config->scaled_resolution = pending_scaled;
+  vga_config->scaled_width      = 0;
+  vga_config->scaled_height     = 0;
+
+  frame_size_t size;
+  uint32_t color_div = calc_frame_size((vga_config_t *) vga_config, &size);
+  frame_width        = size.width;
+  frame_height       = size.height;
+  frame_width_full   = size.width_full;
+  frame_height_full  = size.height_full;
+  if (base_changed) {
+    sync_init(pending_base, config_clock_div((vga_config_t *) vga_config)); // Already checked by vga_set_resolution()
+  }
+
+  uint16_t height      = vga_modes[pending_base].v_visible;
+  uint16_t full_height = mode_height_full(&vga_modes[pending_base]);
+  color_program_init(vga_config->pio, color_pio_sm, color_pio_offset, COLOR_LSB_PIN, color_div, (uint32_t) height * frame_width_full, (uint32_t) (full_height - height) * frame_width_full);
+
+  if (base_changed) {
+    scanout_abs_line    = 0;
+    scanout_frame_start = 0;
+    build_frame_read_addr((vga_config_t *) vga_config);
+    start_scanout();
+  } else {
+    build_frame_read_addr((vga_config_t *) vga_config); // The line count keeps going, it's the same frame length
+    resume_color();
+  }
+
+  resolution_pending = false;
+  render_invalidate(); // Everything the renderer knows about the screen is the wrong size now
+}
+
 /************************************
  * GLOBAL FUNCTIONS
  ************************************/
 
 int vga_init(vga_config_t * config) {
+  if (config->base_resolution >= RES_BASE_COUNT) return 1;
+
   clocks_init();
-  vga_config        = config;
-  frame_width       = frame_size[config->base_resolution][FRAME_WIDTH_IDX] / config->scaled_resolution;
-  frame_height      = frame_size[config->base_resolution][FRAME_HEIGHT_IDX] / config->scaled_resolution;
-  frame_width_full  = frame_size[config->base_resolution][FRAME_WIDTH_FULL_IDX] / config->scaled_resolution;
-  frame_height_full = frame_size[config->base_resolution][FRAME_HEIGHT_FULL_IDX] / config->scaled_resolution;
+  vga_config = config;
 
   // Override if there are less than 2 interpolated lines
   if (config->num_interpolated_lines < 2) config->num_interpolated_lines = 2;
 
+  frame_size_t size;
+  uint32_t color_div = calc_frame_size(config, &size);
+  if (check_mode(config, &size)) return 1;
+  frame_width       = size.width;
+  frame_height      = size.height;
+  frame_width_full  = size.width_full;
+  frame_height_full = size.height_full;
+
   color_pio_sm = pio_claim_unused_sm(config->pio, true);
 
   // Add PIO program to PIO instruction memory. SDK will find location and
   // return with the memory offset of the program.
-  uint offset = pio_add_program(config->pio, &color_program);
+  color_pio_offset = pio_add_program(config->pio, &color_program);
 
   gpio_set_function(HSYNC_PIN, GPIO_FUNC_PWM);
   gpio_set_function(VSYNC_PIN, GPIO_FUNC_PWM);
-  pwm_config default_pwm_conf = pwm_get_default_config();
-  pwm_init(HSYNC_PWM_SLICE, &default_pwm_conf, false); // reset to known state
-  pwm_init(VSYNC_PWM_SLICE, &default_pwm_conf, false);
-
-  if (config->base_resolution == RES_800x600) {
-    // 120MHz system clock frequency (multiple of 40MHz pixel clock)
-    set_sys_clock_pll(1440000000, 6, 2); // VCO frequency (MHz), PD1, PD2 -- see vcocalc.py
-
-    // Initialize color pio program, but DON'T enable PIO state machine
-    // CPU Base clock (after reconfig): 120.0 MHz. 120/3 = 40Mhz pixel clock
-    color_program_init(config->pio, color_pio_sm, offset, COLOR_LSB_PIN, 3 * config->scaled_resolution);
-
-    pwm_set_clkdiv(HSYNC_PWM_SLICE, 3.0);                     // pixel clock
-    pwm_set_wrap(HSYNC_PWM_SLICE, 1056 - 1);                  // full line width - 1
-    pwm_set_counter(HSYNC_PWM_SLICE, 128 + 88);               // sync pulse + back porch
-    pwm_set_chan_level(HSYNC_PWM_SLICE, HSYNC_PWM_CHAN, 128); // sync pulse
-
-    pwm_set_clkdiv(VSYNC_PWM_SLICE, 198.0);                      // clkdiv maxes out at /256, so this (pixel clock * full line width)/16 = (3*1056)/16, dividing by 16 to compensate
-    pwm_set_wrap(VSYNC_PWM_SLICE, (628 * 16) - 1);               // full frame height, adjusted for clkdiv fix
-    pwm_set_counter(VSYNC_PWM_SLICE, (4 + 23) * 16);             // sync pulse + back porch
-    pwm_set_chan_level(VSYNC_PWM_SLICE, VSYNC_PWM_CHAN, 4 * 16); // sync pulse
-  } else if (config->base_resolution == RES_640x480) {
-    // 125MHz system clock frequency -- possibly bump to 150MHz later
-    set_sys_clock_pll(1500000000, 6, 2);
-
-    color_program_init(config->pio, color_pio_sm, offset, COLOR_LSB_PIN, 5 * config->scaled_resolution);
-
-    // Sources for these timings, because they are slightly different (for a 25MHz pixel clock, not 25.175MHz)
-    // https://www.eevblog.com/forum/microcontrollers/implementing-a-vga-controller-on-spartan-3-board-with-25-0-mhz-clock/
-    // pg 24: https://docs.xilinx.com/v/u/en-US/ug130
-
-    // Sync polarity is inverted
-    pwm_set_output_polarity(HSYNC_PWM_SLICE, true, true);
-    pwm_set_clkdiv(HSYNC_PWM_SLICE, 5.0);
-    pwm_set_wrap(HSYNC_PWM_SLICE, 800 - 1);
-    pwm_set_counter(HSYNC_PWM_SLICE, 96 + 48);
-    pwm_set_chan_level(HSYNC_PWM_SLICE, HSYNC_PWM_CHAN, 96);
-
-    pwm_set_output_polarity(VSYNC_PWM_SLICE, true, true);
-    pwm_set_clkdiv(VSYNC_PWM_SLICE, 250.0); // see above for reasoning behind this -- (5*800)/16
-    pwm_set_wrap(VSYNC_PWM_SLICE, (521 * 16) - 1);
-    pwm_set_counter(VSYNC_PWM_SLICE, (2 + 29) * 16);
-    pwm_set_chan_level(VSYNC_PWM_SLICE, VSYNC_PWM_CHAN, 2 * 16);
-  } else if (config->base_resolution == RES_1024x768) {
-    // 130MHz system clock frequency
-    set_sys_clock_pll(1560000000, 6, 2);
-
-    color_program_init(config->pio, color_pio_sm, offset, COLOR_LSB_PIN, 2 * config->scaled_resolution);
-
-    // Sync polarity is inverted
-    pwm_set_output_polarity(HSYNC_PWM_SLICE, true, true);
-    pwm_set_clkdiv(HSYNC_PWM_SLICE, 2.0);
-    pwm_set_wrap(HSYNC_PWM_SLICE, 1344 - 1);
-    pwm_set_counter(HSYNC_PWM_SLICE, 136 + 160);
-    pwm_set_chan_level(HSYNC_PWM_SLICE, HSYNC_PWM_CHAN, 136);
-
-    pwm_set_output_polarity(VSYNC_PWM_SLICE, true, true);
-    pwm_set_clkdiv(VSYNC_PWM_SLICE, 168.0); // see above for reasoning behind this -- (2*1344)/16
-    pwm_set_wrap(VSYNC_PWM_SLICE, (806 * 16) - 1);
-    pwm_set_counter(VSYNC_PWM_SLICE, (6 + 29) * 16);
-    pwm_set_chan_level(VSYNC_PWM_SLICE, VSYNC_PWM_CHAN, 6 * 16);
-  } else {
-    return 1;
-  }
-
-  // Fail if the frame buffer is too small
-  if (PV_FRAMEBUFFER_BYTES < frame_width * 5) return 1;
-
-  // uint32_t num_buffered_lines = PV_FRAMEBUFFER_BYTES / frame_width;
-
-  // TODO: Add interpolation back
-  /*
-  if (num_buffered_lines >= frame_height) {
-  } else {
-    frameBufferStart      = frameBufferEnd - num_buffered_lines * frame_width;
-    interpolatedLineStart = frameBufferStart - config->num_interpolated_lines * frame_width;
-    blankLineStart        = interpolatedLineStart - frame_width;
-  }
-
-  if (num_buffered_lines != frame_height) {
-    /*
-        Even distribution algorithm:
-    - Finds the distance between each of the interpolated lines (segmentLen)
-    - There will always be spares, since the number of interpolated lines will almost never perfectly
-      divide into the number of total lines. This is numSpares.
-    - Instead of putting an interpolated line every segmentLen and putting all of the spares at the end
-      (making the CPU work harder in the beginning of the frame) this adds 1 element to numSpares
-      number of segments.
-    - This algorithm interpolates a line every (segmentLen + 1) lines until it runs out of spares, then
-      interpolates every segmentLen lines.
-    - This reddit post explains it: https://www.reddit.com/r/learnprogramming/comments/31ns44/splitting_the_contents_of_an_array_into_as_evenly/
-    - i = line in frame, j = buffer line counter, k = interpolated line counter, l = frameReadAddr index counter
-    */
-  /*
-uint16_t segmentLen = frame_height / (frame_height - num_buffered_lines);
-uint16_t numSpares  = frame_height % (frame_height - num_buffered_lines);
-for (int i = 0, j = 0, k = 0; i < frame_height; i++) {
-  if (numSpares != 0 && i % (segmentLen + 1) == 0) {
-    for (int l = 0; l < config->scaled_resolution; l++) {
-      ((uint8_t **) frameReadAddrStart)[(i * config->scaled_resolution) + l] = interpolatedLineStart + k * frame_width;
-    }
-    k = (k + 1) % config->num_interpolated_lines;
-    numSpares--;
-  } else if (numSpares == 0 && i % segmentLen == 0) {
-    for (int l = 0; l < config->scaled_resolution; l++) {
-      ((uint8_t **) frameReadAddrStart)[(i * config->scaled_resolution) + l] = interpolatedLineStart + k * frame_width;
-    }
-    k = (k + 1) % config->num_interpolated_lines;
-  } else {
-    // If this line isn't interpolated, grab the next buffered line from the framebuffer
-    for (int l = 0; l < config->scaled_resolution; l++) {
-      ((uint8_t **) frameReadAddrStart)[(i * config->scaled_resolution) + l] = (uint8_t *) (frameBufferStart + frame_width * j);
-    }
-    j++;
-  }
-}
-} else {
-// No interpolation
-}
-*/
+  sync_init(config->base_resolution, config_clock_div(config));
 
-  for (int i = 0; i < frame_height * config->scaled_resolution; i++) {
-    frame_read_addr[i] = (uint8_t *) framebuffer + frame_width * (i / config->scaled_resolution);
-  }
+  // Initialize color pio program, but DON'T enable PIO state machine
+  uint16_t base_height      = vga_modes[config->base_resolution].v_visible;
+  uint16_t base_height_full = mode_height_full(&vga_modes[config->base_resolution]);
+  color_program_init(config->pio, color_pio_sm, color_pio_offset, COLOR_LSB_PIN, color_div, (uint32_t) base_height * frame_width_full, (uint32_t) (base_height_full - base_height) * frame_width_full);
 
-  // Fill in blanking time at the bottom of the screen
-  for (int i = frame_height * config->scaled_resolution; i < frame_height_full * config->scaled_resolution; i++) {
-    frame_read_addr[i] = blank;
-  }
-  // Hacky fix: Since the true height of 640x480 is 525 lines, integer division becomes an issue. This is the fix
-  if (config->base_resolution == RES_640x480) {
-    frame_read_addr[frame_size[RES_640x480][FRAME_HEIGHT_FULL_IDX] - 1] = blank;
-  }
+  scanout_abs_line    = 0;
+  scanout_frame_start = 0;
+  resolution_pending  = false;
+  build_frame_read_addr(config);
+  render_init();
 
   multicore_launch_core1(second_core_init);
   while (multicore_fifo_pop_blocking() != SECOND_CORE_MAGIC); // busy wait while the core is initializing
@@ -303,18 +856,9 @@ for (int i = 0, j = 0, k = 0; i < frame_height; i++) {
 int vga_deinit(vga_config_t * config) {
   multicore_reset_core1(); // Stop core 1
 
-  irq_set_enabled(DMA_IRQ_0, false); // Disable IRQ first, see pg 93 of C SDK docs
-  dma_channel_abort(frame_ctrl_dma);
-  dma_channel_abort(frame_data_dma);
-  dma_channel_abort(blank_data_dma);
-
-  dma_unclaim_mask((1 << frame_ctrl_dma) | (1 << frame_data_dma) | (1 << blank_data_dma));
-
-  pio_sm_set_enabled(config->pio, color_pio_sm, false);
-  pio_sm_clear_fifos(config->pio, color_pio_sm);
-
-  pwm_set_enabled(HSYNC_PWM_SLICE, false);
-  pwm_set_enabled(VSYNC_PWM_SLICE, false);
+  stop_scanout();
+  pio_remove_program(config->pio, &color_program, color_pio_offset); // vga_init() adds them again
+  pio_sm_unclaim(config->pio, color_pio_sm);
 
   return 0;
 }
@@ -341,4 +885,204 @@ uint16_t vga_get_height_full() {
 
 uint8_t ** __vga_get_frame_read_addr() {
   return (uint8_t **) frame_read_addr; // remove volatile qualifier
+}
+
+uint8_t * __vga_get_interp_ring() {
+  return (uint8_t *) interp_ring;
+}
+
+uint8_t ** __vga_get_frame_draw_addr() {
+  return (uint8_t **) frame_draw_addr;
+}
+
+void __vga_flip() {
+  flip_pending = true;
+  while (flip_pending) {
+    tight_loop_contents(); // Flipped by the DMA IRQ at the end of the frame
+  }
+  if (frame_done_callback) {
+    frame_done_callback();
+  }
+}
+
+void vga_set_frame_done_callback(void (*callback)()) {
+  frame_done_callback = callback;
+}
+
+int vga_set_resolution(vga_resolution_base_t base, vga_resolution_scaled_t scaled) {
+  if (base >= RES_BASE_COUNT || scaled == 0) return 1;
+  if (__get_current_exception()) return 1; // Core 1 does the switch in thread mode, an IRQ could be holding it up
+
+  // Make sure the new mode fits before touching anything
+  vga_config_t new_config      = *(vga_config_t *) vga_config;
+  new_config.base_resolution   = base;
+  new_config.scaled_resolution = scaled;
+  new_config.scaled_width      = 0;
+  new_config.scaled_height     = 0;
+  frame_size_t size;
+  calc_frame_size(&new_config, &size);
+  if (check_mode(&new_config, &size)) return 1;
+
+  // Done by core 1 between render passes (or right away if this is core 1, say from an animate() callback)
+  pending_base       = base;
+  pending_scaled     = scaled;
+  resolution_pending = true;
+  if (get_core_num() == 1) {
+    switch_resolution();
+    return 0;
+  }
+  __sev();
+  while (resolution_pending) {
+    tight_loop_contents();
+  }
+  return 0;
+}
+
+bool __vga_resolution_pending() {
+  return resolution_pending;
+}
+
+void __vga_switch_resolution() {
+  if (resolution_pending) {
+    switch_resolution();
+  }
+}
+
+uint32_t vga_get_frame_count() {
+  return frame_count;
+}
+
+void vga_wait_vblank() {
+  uint32_t start = frame_count;
+  while (frame_count == start) {
+    __wfe(); // The DMA IRQ sends an event at the start of vertical blanking
+  }
+}
+
+int vga_set_vblank_callback(void (*callback)(), uint8_t core) {
+  // Core 0's IRQs can only be changed from core 0. Core 1's get changed by the DMA IRQ (on core 1).
+  if (core > 1 || ((core == 0 || vblank_core == 0) && get_core_num() != 0)) return 1;
+
+  vblank_callback = callback;
+  irq_set_exclusive_handler(DMA_IRQ_1, (irq_handler_t) vblank_irq_handler); // Vector table is shared between the cores
+  if (get_core_num() == 0) {
+    irq_set_priority(DMA_IRQ_1, PICO_LOWEST_IRQ_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, callback && core == 0);
+  }
+  vblank_core = callback ? core : -1;
+  return 0;
+}
+
+uint16_t vga_get_playfield_width() {
+  return playfield ? playfield_width : frame_width;
+}
+
+uint16_t vga_get_playfield_height() {
+  return playfield ? playfield_height : frame_height;
+}
+
+int vga_set_scroll_region(uint8_t region, const vga_scroll_region_t * scroll_region) {
+  if (!playfield || region >= PV_MAX_SCROLL_REGIONS || scroll_region->src_top + scroll_region->src_height > playfield_height) return 1;
+
+  scroll_regions[region] = *scroll_region;
+  scroll_dirty           = true;
+  return 0;
+}
+
+int vga_set_scroll(uint8_t region, uint16_t scroll_x, uint16_t scroll_y) {
+  if (!playfield || region >= PV_MAX_SCROLL_REGIONS) return 1;
+
+  scroll_regions[region].scroll_x = scroll_x;
+  scroll_regions[region].scroll_y = scroll_y;
+  scroll_dirty                    = true;
+  return 0;
+}
+
+uint8_t * __vga_get_playfield() {
+  return (uint8_t *) playfield;
+}
+
+uint16_t __vga_get_row_line(uint16_t y) {
+  // Rows get repeated as evenly as possible over the base resolution's lines: line i shows row (i * height) / base_height,
+  // so the first line of row y is ceil(y * base_height / height). Works out to y * scaled_resolution for the normal scales.
+  return ((uint32_t) y * vga_modes[vga_config->base_resolution].v_visible + frame_height - 1) / frame_height;
+}
+
+uint16_t __vga_get_frame_read_addr_len() {
+  return mode_height_full(&vga_modes[vga_config->base_resolution]);
+}
+
+uint32_t __vga_get_frame_period_us() {
+  const vga_mode_t * mode = &vga_modes[vga_config->base_resolution];
+  return (uint64_t) mode_width_full(mode) * mode_height_full(mode) * 1000 / mode->pixel_clock_khz;
+}
+
+uint32_t __vga_get_scanout_abs_line() {
+  return scanout_abs_line;
+}
+
+uint32_t __vga_get_interp_slot_line(uint8_t slot) {
+  return interp_slot_line[slot];
+}
+
+void __vga_set_interp_slot_line(uint8_t slot, uint32_t abs_line) {
+  interp_slot_line[slot] = abs_line;
+}
+
+void vga_set_palette(const vga_color_t * colors, uint8_t num_colors) {
+  for (int i = 0; i < MIN(num_colors, 16); i++) {
+    palette[i] = colors[i];
+  }
+
+  // One entry per possible packed byte, leftmost pixel in the lowest bits of the byte and the lowest byte of the entry
+  for (uint32_t b = 0; b < 256; b++) {
+    if (vga_config && vga_config->color_depth == VGA_COLOR_DEPTH_2BPP) {
+      palette_lut[b] = palette[b & 3] | (palette[(b >> 2) & 3] << 8) | (palette[(b >> 4) & 3] << 16) | (palette[b >> 6] << 24);
+    } else {
+      palette_lut[b] = palette[b & 15] | (palette[b >> 4] << 8);
+    }
+  }
+}
+
+uint8_t * __vga_get_packed_framebuffer() {
+  return (uint8_t *) packed_fb;
+}
+
+uint16_t __vga_get_packed_stride() {
+  return packed_stride;
+}
+
+const uint32_t * __vga_get_palette_lut() {
+  return palette_lut;
+}
+
+uint32_t vga_get_interp_late_lines() {
+  return interp_late_lines;
+}
+
+void vga_get_scanout_stats(vga_scanout_stats_t * stats) {
+  *stats            = *(vga_scanout_stats_t *) &scanout_stats; // remove volatile qualifier
+  stats->late_lines = interp_late_lines;
+}
+
+void vga_reset_scanout_stats() {
+  scanout_stats.frames               = 0;
+  scanout_stats.underrun_frames      = 0;
+  scanout_stats.late_irqs            = 0;
+  scanout_stats.dma_errors           = 0;
+  scanout_stats.first_underrun_frame = 0;
+  scanout_stats.first_underrun_line  = -1;
+  interp_late_lines                  = 0;
+}
+
+uint16_t vga_capture_frame(void (*line_callback)(uint16_t line, const uint8_t * pixels, void * ctx), void * ctx) {
+  uint16_t ring_lines = 0;
+  for (uint16_t line = 0; line < vga_modes[vga_config->base_resolution].v_visible; line++) {
+    const uint8_t * pixels = (const uint8_t *) frame_read_addr[line];
+    if (interp_ring && pixels >= interp_ring && pixels < interp_ring + vga_config->num_interpolated_lines * frame_width) {
+      ring_lines++;
+    }
+    line_callback(line, pixels, ctx);
+  }
+  return ring_lines;
 }
\ No newline at end of file
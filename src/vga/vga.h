@@ -12,16 +12,79 @@
 
 // The maximum size of the frame buffer for the pico-vga renderer. The renderer will use
 // either the allocated size or the size of 1 frame, whichever is smaller.
+// If 1 frame doesn't fit, as many lines as possible are buffered and the rest are rendered
+// on the fly into num_interpolated_lines line buffers (line interpolation).
 // Allocated at compile-time, so be careful of other memory-intensive parts of your program.
 #ifndef PV_FRAMEBUFFER_BYTES
 #define PV_FRAMEBUFFER_BYTES 200000
 #endif
 
+// Width and height of a tile in tile mode (see vga_tilemap_t), in pixels
+#ifndef PV_TILE_SIZE
+#define PV_TILE_SIZE 8
+#endif
+
+// Number of scroll regions (see vga_scroll_region_t)
+#ifndef PV_MAX_SCROLL_REGIONS
+#define PV_MAX_SCROLL_REGIONS 4
+#endif
+
+// Maximum render queue length for the scanline renderer (renderer v2), which keeps a few arrays of item indices
+#ifndef PV_SCANLINE_MAX_ITEMS
+#define PV_SCANLINE_MAX_ITEMS 256
+#endif
+
 // Switch to true if running in peripheral mode
 #ifndef PV_PERIPHERAL_MODE
 #define PV_PERIPHERAL_MODE false
 #endif
 
+// Longest render queue AutoRender can keep track of changes in (1 bit per item, see draw_mark_updated()). Max 1024.
+#ifndef PV_MAX_RENDER_ITEMS
+#define PV_MAX_RENDER_ITEMS 1024
+#endif
+
+// Number of separate damaged areas AutoRender keeps track of between redraws. Past that, damaged areas get merged together.
+#ifndef PV_MAX_DAMAGE_RECTS
+#define PV_MAX_DAMAGE_RECTS 8
+#endif
+
+// Number of horizontal bands each damaged area gets split into with dual_core_render, so the two cores can share the work
+#ifndef PV_RENDER_BANDS
+#define PV_RENDER_BANDS 8
+#endif
+
+// Tile size for binned_render, in pixels. Both cores get a tile buffer in SCRATCH_Y, next to core 0's stack (2kB of the 4kB
+// bank, SCRATCH_X is all core 1's stack), so the two tiles together can't be more than about 2kB.
+#ifndef PV_BIN_TILE_WIDTH
+#define PV_BIN_TILE_WIDTH 32
+#endif
+#ifndef PV_BIN_TILE_HEIGHT
+#define PV_BIN_TILE_HEIGHT 16
+#endif
+
+// Rows the DMA fill/blit engine (dma_render) can have queued at once, 16 bytes each. Bigger rectangles go in chunks.
+#ifndef PV_RENDER_DMA_ROWS
+#define PV_RENDER_DMA_ROWS 64
+#endif
+
+// Number of spans (runs of one color on one row) AutoRender can keep recorded to redraw items without rasterizing them
+// again, 8 bytes each. 0 turns the span cache off.
+#ifndef PV_SPAN_CACHE_SPANS
+#define PV_SPAN_CACHE_SPANS 0
+#endif
+
+// Switch to true to time every render() pass and render queue item (see vga_get_render_profile()).
+// Costs a couple of timer reads per item, and the numbers only cover the framebuffer renderer (apart from the pixel count).
+#ifndef PV_RENDER_PROFILING
+#define PV_RENDER_PROFILING false
+#endif
+
+// Number of render() passes vga_get_render_profile() works out the min/avg/max pass time over
+#ifndef PV_RENDER_PROFILE_WINDOW
+#define PV_RENDER_PROFILE_WINDOW 32
+#endif
+
 /************************************
  * RENDER QUEUE
  ************************************/
@@ -59,9 +122,10 @@ typedef struct __packed {
   union {
     struct __packed {
       uint32_t shown      : 1;
-      uint32_t update     : 1;
+      uint32_t update     : 1; // Set by draw_mark_updated(). Setting it by hand only redraws the item from its animate() function, see draw_mark_updated()
       uint32_t wordwrap   : 1;
-      uint32_t __reserved : 5;
+      uint32_t opaque     : 1; // Covers every pixel of its bbox (set by draw2d_update_bbox()), so anything under it can be skipped
+      uint32_t __reserved : 4;
     } flags;
     uint8_t flags_byte;
   };
@@ -84,6 +148,14 @@ typedef struct __packed {
   uint8_t hidden;
 } vga_triangle_t;
 
+// Rectangle, corners inclusive. Empty if x1 > x2 or y1 > y2.
+typedef struct __packed {
+  uint16_t x1, y1;
+  uint16_t x2, y2;
+} vga_rect_t;
+
+#define VGA_RECT_EMPTY ((vga_rect_t) { UINT16_MAX, UINT16_MAX, 0, 0 })
+
 struct __packed vga_render_item_t; // Predefinition, takes care of warnings later on from the function pointers
 typedef struct __packed {
   vga_render_item_header_t header;
@@ -134,7 +206,14 @@ typedef struct __packed {
     } item_3d;
   };
 
-  // Pointer to a function that modifies the current RenderQueueItem to animate it. Called every frame (60Hz).
+  // Area of the screen the item covers (see draw2d_update_bbox()), and the area it covered the last time the renderer
+  // drew it. AutoRender only clears and redraws the parts of the screen that changed between the two.
+  vga_rect_t bbox;
+  vga_rect_t drawn_bbox;
+
+  // Pointer to a function that modifies the current RenderQueueItem to animate it. Called every frame (60Hz), and after
+  // every render() pass. Set it before the item's draw*_ call (or call draw_mark_updated() after setting it), AutoRender
+  // only looks at items that changed.
   void (*animate)(struct vga_render_item_t *);
 } vga_render_item_t;
 
@@ -146,8 +225,27 @@ typedef enum {
   RES_800x600 = 0, // @ 60Hz, 40MHz pixel clock
   RES_640x480,     // @ 60Hz, 25MHz pixel clock
   RES_1024x768,    // @ 60Hz, 65MHz pixel clock
+  RES_BASE_COUNT,  // Number of base resolutions, not a resolution. New ones go above this and in vga_modes (vga.c).
 } vga_resolution_base_t;
 
+// Video mode timings for a base resolution. Horizontal values are in pixels, vertical values in lines, and each line/frame
+// goes visible, front porch, sync pulse, back porch. The system clock is set to pixel_clock_khz * clock_div (the PLL
+// settings are worked out from that), so it has to be something the PLL can hit exactly.
+typedef struct {
+  uint32_t pixel_clock_khz;
+  uint8_t clock_div; // Default system clock cycles per pixel (see pixel_clock_div in vga_config_t), at least 2
+  uint16_t h_visible;
+  uint16_t h_front_porch;
+  uint16_t h_sync;
+  uint16_t h_back_porch;
+  bool h_sync_negative;
+  uint16_t v_visible;
+  uint16_t v_front_porch;
+  uint16_t v_sync;
+  uint16_t v_back_porch;
+  bool v_sync_negative;
+} vga_mode_t;
+
 typedef enum {
   RES_SCALED_800x600  = 1,
   RES_SCALED_400x300  = 2,
@@ -161,15 +259,97 @@ typedef enum {
   RES_SCALED_512x384  = 2,
 } vga_resolution_scaled_t;
 
+// Framebuffer color depth. At 4 and 2 bits per pixel, colors passed to the draw2d_* functions are palette
+// indices (see vga_set_palette()) and every line gets expanded to 8 bit color right before it's sent out.
+typedef enum {
+  VGA_COLOR_DEPTH_8BPP = 0, // 256 colors, no palette
+  VGA_COLOR_DEPTH_4BPP,     // 16 colors from the palette
+  VGA_COLOR_DEPTH_2BPP,     // 4 colors from the palette
+} vga_color_depth_t;
+
+// Tile mode: instead of a framebuffer, every line is built on the fly from a map of tile indices and a tile set.
+// Uses num_interpolated_lines line buffers of memory instead of a full frame.
+typedef struct {
+  const uint8_t * map;     // map_width * map_height tile indices, row by row. Can be changed at any time.
+  uint16_t map_width;      // Map size, in tiles. Wraps around if smaller than the screen.
+  uint16_t map_height;
+  const vga_color_t * tiles; // Tile set (flash or RAM), PV_TILE_SIZE * PV_TILE_SIZE pixels per tile, row by row
+  uint16_t scroll_x;         // Pixel offset of the top left corner of the screen in the map (wraps around)
+  uint16_t scroll_y;
+} vga_tilemap_t;
+
+// Scroll region: a band of screen rows that shows part of the playfield (see playfield_width/playfield_height).
+// Screen row y in the region shows playfield row src_top + (y - top + scroll_y) % src_height, starting scroll_x pixels in,
+// so the rows src_top to src_top + src_height - 1 of the playfield work as a circular buffer.
+// Rows that aren't in any region show the same row of the playfield, unscrolled.
+typedef struct {
+  uint16_t top;        // First and last screen rows in the region. Disabled if top > bottom.
+  uint16_t bottom;
+  uint16_t src_top;    // Band of playfield rows to scroll through
+  uint16_t src_height;
+  uint16_t scroll_x;   // Rounded down to a multiple of 4 (the DMA reads whole words), max playfield_width - screen width
+  uint16_t scroll_y;
+} vga_scroll_region_t;
+
+// Scanout health counters, see vga_get_scanout_stats(). Everything counts up from vga_init() (or vga_reset_scanout_stats()).
+typedef struct {
+  uint32_t frames;               // Frames sent out
+  uint32_t underrun_frames;      // Frames where the color PIO ran out of data (TX FIFO empty) at least once. The picture is out of sync after this.
+  uint32_t late_irqs;            // DMA IRQs that ran too late: a frame IRQ after the DMA restarted, or a line IRQ that missed a line
+  uint32_t dma_errors;           // Frames where a scanout DMA channel reported a bus error
+  uint32_t late_lines;           // Same as vga_get_interp_late_lines()
+  uint32_t first_underrun_frame; // Frame (see vga_get_frame_count()) of the first underrun, only valid if underrun_frames isn't 0
+  int16_t first_underrun_line;   // Base resolution line the first underrun was noticed on. Only known with line interpolation, -1 otherwise.
+} vga_scanout_stats_t;
+
+// Render time of one type of render queue item, see vga_render_profile_t
+typedef struct {
+  uint32_t count;    // Items of this type rendered
+  uint64_t total_us; // Time spent on them
+  uint32_t max_us;   // Slowest single item
+} vga_render_type_profile_t;
+
+#define VGA_RENDER_PROFILE_BINS 16 // Histogram bins in vga_render_profile_t, 1/8th of a frame each
+
+// render() timing, see vga_get_render_profile(). Everything counts up from vga_init() (or vga_reset_render_profile()).
+typedef struct {
+  uint32_t passes;                             // render() passes (each one redraws the framebuffer)
+  uint32_t over_budget;                        // Passes that took longer than budget_us. The screen can't keep up with the refresh rate if this goes up.
+  uint32_t budget_us;                          // One frame at the current base resolution (~16.6ms at 60Hz)
+  uint32_t last_us;                            // Last pass
+  uint32_t min_us;                             // Fastest, average and slowest of the last PV_RENDER_PROFILE_WINDOW passes
+  uint32_t avg_us;
+  uint32_t max_us;
+  uint32_t clear_us;                           // Time the last pass spent wiping the screen before drawing the render queue
+  uint32_t culled_items;                       // Item draws the last pass skipped because something opaque covered them, summed over bands/tiles
+  uint32_t histogram[VGA_RENDER_PROFILE_BINS]; // Passes that took i/8ths to (i+1)/8ths of budget_us. The last bin also counts anything slower.
+  uint16_t slowest_item;                       // Render queue index of the slowest item in the last pass
+  uint32_t slowest_item_us;
+  vga_render_type_profile_t types[VGA_RENDER_ITEM_SVG + 1]; // Indexed by vga_render_item_type_t
+  uint32_t pixels_written;                     // Pixels every renderer (tile mode and the scanline renderer too) has written since boot, overdraw included. Never reset and wraps, so compare two reads.
+} vga_render_profile_t;
+
 typedef struct {
   PIO pio; // Which PIO to use for color
   vga_resolution_base_t base_resolution;
   vga_resolution_scaled_t scaled_resolution;
+  uint16_t scaled_width;  // Arbitrary scaled resolution (i.e. 320x200 on 800x600), overrides scaled_resolution if both are nonzero.
+  uint16_t scaled_height; // The width gets rounded to the closest one the color PIO clock divider can do exactly.
   vga_render_item_t * render_queue;
-  uint16_t render_queue_len;
+  uint16_t render_queue_len; // Checked by vga_init() (see PV_SCANLINE_MAX_ITEMS, PV_MAX_RENDER_ITEMS), don't make it longer than that afterwards
   bool auto_render;               // Turn on autoRendering (no manual updateDisplay() call required)
   bool antialiasing;              // Turn antialiasing on or off
-  uint8_t num_interpolated_lines; // Override the default number of interpolated frame lines -- used if the frame buffer is not large enough to hold all of the frame data. Default = 2.
+  bool double_buffered;           // Render into a back buffer and flip it onto the screen during vertical blanking. Needs 2 full frames to fit in PV_FRAMEBUFFER_BYTES.
+  bool dual_core_render;          // Let core 0 help the renderer by calling vga_render_help() (see PV_RENDER_BANDS)
+  bool binned_render;             // Draw each damaged area a tile at a time in a scratch buffer, then copy the tile out (see PV_BIN_TILE_WIDTH). 8 bits per pixel only.
+  bool dma_render;                // Hand big fills and opaque sprites to a DMA channel while core 1 keeps drawing (see PV_RENDER_DMA_ROWS)
+  vga_tilemap_t * tilemap;        // Turn on tile mode (render queue is ignored). NULL for normal rendering.
+  bool scanline_render;           // Use the scanline renderer (renderer v2): every line is rendered from the render queue just ahead of the DMA, no framebuffer
+  vga_color_depth_t color_depth;  // Framebuffer color depth. The whole frame has to fit in PV_FRAMEBUFFER_BYTES below 8 bits per pixel.
+  uint16_t playfield_width;       // Framebuffer bigger than the screen for scrolling (see vga_scroll_region_t), drawn in playfield coordinates.
+  uint16_t playfield_height;      // 0 for no playfield. Has to fit in PV_FRAMEBUFFER_BYTES (8 bits per pixel, no double buffering).
+  uint8_t pixel_clock_div;        // System clock cycles per pixel, 0 for the base resolution's default (3, 5, 2). More means a faster system clock and more render time per frame (above 133MHz is overclocking).
+  uint8_t num_interpolated_lines; // Override the default number of interpolated line buffers -- used if the frame buffer is not large enough to hold all of the frame data (see PV_FRAMEBUFFER_BYTES). Default = 2.
   uint16_t color_delay_cycles;
 } vga_config_t;
 
@@ -178,8 +358,20 @@ typedef struct {
   .pio                    = pio0,               \
   .baseResolution         = RES_800x600,        \
   .resolutionScale        = RES_SCALED_400x300, \
+  .scaled_width           = 0,                  \
+  .scaled_height          = 0,                  \
   .auto_render            = true,               \
   .antialiasing           = false,              \
+  .double_buffered        = false,              \
+  .dual_core_render       = false,              \
+  .binned_render          = false,              \
+  .dma_render             = false,              \
+  .tilemap                = NULL,               \
+  .scanline_render        = false,              \
+  .color_depth            = VGA_COLOR_DEPTH_8BPP, \
+  .playfield_width        = 0,                  \
+  .playfield_height       = 0,                  \
+  .pixel_clock_div        = 0,                  \
   .num_interpolated_lines = 2,                  \
   .color_delay_cycles     = 0,                  \
 }
@@ -208,6 +400,20 @@ int vga_init(vga_config_t * config);
  */
 int vga_deinit(vga_config_t * config);
 
+/**
+ * @brief Change the resolution without vga_deinit()/vga_init(). Core 1 switches over between two render passes (and
+ * between two frames). A new scale at the same base resolution only reloads the color signal and takes effect with
+ * the next frame, the sync signals and the system clock keep running. A new base resolution stops the scanout, sets
+ * the clocks up for the new mode and starts again, and the monitor has to resync. Clears scaled_width/scaled_height,
+ * and the whole screen gets redrawn at the new size. Blocks until it's done. Fails from an IRQ, core 1 can't switch
+ * while one is running.
+ *
+ * @param base New base resolution
+ * @param scaled New scaled resolution
+ * @return int 0 on success, nonzero if the new resolution doesn't fit (nothing changes)
+ */
+int vga_set_resolution(vga_resolution_base_t base, vga_resolution_scaled_t scaled);
+
 /**
  * @brief Get the current VGA config
  *
@@ -258,6 +464,273 @@ void vga_refresh();
  */
 uint8_t ** __vga_get_frame_read_addr();
 
+/**
+ * @brief Get the frame address buffer the renderer should draw into. Same as
+ * __vga_get_frame_read_addr() unless double buffering is on (then it's the back buffer).
+ *
+ * @return uint8_t**
+ */
+uint8_t ** __vga_get_frame_draw_addr();
+
+/**
+ * @brief Swap the front and back buffers at the end of the current frame. Blocks until
+ * the flip has happened, then calls the frame done callback. Only call this from the renderer (core 1).
+ *
+ */
+void __vga_flip();
+
+/**
+ * @brief True if vga_set_resolution() is waiting for core 1 to switch over
+ *
+ * @return bool
+ */
+bool __vga_resolution_pending();
+
+/**
+ * @brief Switch to the resolution vga_set_resolution() asked for, if it's waiting. Only call this from core 1 in thread
+ * mode, while nothing is drawing (the render loop between passes).
+ *
+ */
+void __vga_switch_resolution();
+
+/**
+ * @brief Set a function to be called (on core 1) every time a newly rendered
+ * frame is flipped onto the screen. Only used with double buffering.
+ *
+ * @param callback Function to call, or NULL to disable
+ */
+void vga_set_frame_done_callback(void (*callback)());
+
+/**
+ * @brief Get the number of frames sent out so far. Goes up by 1 at the start of every vertical blanking period.
+ *
+ * @return uint32_t
+ */
+uint32_t vga_get_frame_count();
+
+/**
+ * @brief Wait (sleeping, not spinning) for the start of the next vertical blanking period. Anything changed
+ * right after this shows up all at once on the next frame instead of tearing halfway through this one.
+ *
+ */
+void vga_wait_vblank();
+
+/**
+ * @brief Set a function to be called at the start of every vertical blanking period. It runs in a
+ * lowest-priority IRQ on the chosen core, so keep it short.
+ * If core 0 is involved (the new core or the core the callback is on now) this has to be called from core 0.
+ * Core 1 starts calling it within a line.
+ *
+ * @param callback Function to call, or NULL to disable
+ * @param core Core to call it on (0 or 1)
+ * @return int 0 on success, nonzero otherwise
+ */
+int vga_set_vblank_callback(void (*callback)(), uint8_t core);
+
+/**
+ * @brief Get the size of the surface the renderer draws on: the playfield if there is one, otherwise the screen
+ *
+ * @return uint16_t Width/height, in pixels
+ */
+uint16_t vga_get_playfield_width();
+uint16_t vga_get_playfield_height();
+
+/**
+ * @brief Set up a scroll region. Takes effect at the start of the next vertical blanking period.
+ *
+ * @param region Region number, 0 to PV_MAX_SCROLL_REGIONS - 1. Regions are checked in order, so lower numbers win if they overlap.
+ * @param scroll_region Region settings (copied)
+ * @return int 0 on success, nonzero if there's no playfield or the region doesn't fit in it
+ */
+int vga_set_scroll_region(uint8_t region, const vga_scroll_region_t * scroll_region);
+
+/**
+ * @brief Move a scroll region. Takes effect at the start of the next vertical blanking period, only the
+ * pointers to the lines get rewritten (nothing gets redrawn).
+ *
+ * @param region Region number
+ * @param scroll_x Horizontal scroll, in pixels (rounded down to a multiple of 4)
+ * @param scroll_y Vertical scroll, in pixels (wraps around the region's band of the playfield)
+ * @return int 0 on success, nonzero otherwise
+ */
+int vga_set_scroll(uint8_t region, uint16_t scroll_x, uint16_t scroll_y);
+
+/**
+ * @brief Get the playfield (scrolling framebuffer)
+ *
+ * @return uint8_t* NULL if there's no playfield
+ */
+uint8_t * __vga_get_playfield();
+
+/**
+ * @brief Get the first line (index into the frame read address buffer) that shows a row.
+ * Rows are repeated over 1 or more lines (line doubling), not always the same number of times.
+ *
+ * @param y Row, in screen space (vga_get_height() is allowed, gives the first blank line)
+ * @return uint16_t
+ */
+uint16_t __vga_get_row_line(uint16_t y);
+
+/**
+ * @brief Get the number of entries in the frame read address buffer
+ * (the full frame height at the base resolution)
+ *
+ * @return uint16_t
+ */
+uint16_t __vga_get_frame_read_addr_len();
+
+/**
+ * @brief Get the length of one frame (visible and blanking) at the base resolution, in us
+ *
+ * @return uint32_t
+ */
+uint32_t __vga_get_frame_period_us();
+
+/**
+ * @brief Get the start of the interpolated line buffer ring
+ *
+ * @return uint8_t* NULL if the whole frame fits in the framebuffer (no interpolation)
+ */
+uint8_t * __vga_get_interp_ring();
+
+/**
+ * @brief Get the absolute line number (base resolution, counts up forever and wraps)
+ * of the line the DMA is currently sending out
+ *
+ * @return uint32_t
+ */
+uint32_t __vga_get_scanout_abs_line();
+
+/**
+ * @brief Get/set the absolute line number of the line held in an interpolated line buffer
+ *
+ * @param slot Index of the line buffer in the interpolated line ring
+ */
+uint32_t __vga_get_interp_slot_line(uint8_t slot);
+void __vga_set_interp_slot_line(uint8_t slot, uint32_t abs_line);
+
+/**
+ * @brief Set the palette used at 4 and 2 bits per pixel. Takes effect on the next line sent out,
+ * so color cycling and fades don't need a redraw.
+ *
+ * @param colors Colors for palette indices 0, 1, 2...
+ * @param num_colors Number of colors (max 16)
+ */
+void vga_set_palette(const vga_color_t * colors, uint8_t num_colors);
+
+/**
+ * @brief Get the packed (4 or 2 bits per pixel) framebuffer
+ *
+ * @return uint8_t* NULL at 8 bits per pixel
+ */
+uint8_t * __vga_get_packed_framebuffer();
+
+/**
+ * @brief Get the number of bytes per row of the packed framebuffer
+ *
+ * @return uint16_t
+ */
+uint16_t __vga_get_packed_stride();
+
+/**
+ * @brief Get the palette expansion table. Maps one packed framebuffer byte to 2 (4bpp, low half)
+ * or 4 (2bpp) 8 bit colors, leftmost pixel in the lowest byte.
+ *
+ * @return const uint32_t* 256 entries
+ */
+const uint32_t * __vga_get_palette_lut();
+
+/**
+ * @brief Get the number of interpolated lines the DMA sent out before the renderer
+ * finished them (shows up as a glitched line on screen). Should stay at 0.
+ *
+ * @return uint32_t
+ */
+uint32_t vga_get_interp_late_lines();
+
+/**
+ * @brief Get the scanout health counters (color PIO underruns, late DMA IRQs, DMA errors).
+ * Checked once a frame, and every line with line interpolation. All of them should stay at 0.
+ *
+ * @param stats Filled with the current counters
+ */
+void vga_get_scanout_stats(vga_scanout_stats_t * stats);
+
+/**
+ * @brief Reset the scanout health counters to 0.
+ *
+ */
+void vga_reset_scanout_stats();
+
+/**
+ * @brief Lend the calling core (core 0) to the renderer. With dual_core_render, every redraw is split into horizontal bands
+ * that both cores take from until there are none left, so core 0 draws some of them. Sleeps (__wfe()) if there's nothing
+ * to draw, so call it in a loop whenever core 0 has nothing better to do, i.e. while (true) vga_render_help();
+ *
+ */
+void vga_render_help();
+
+/**
+ * @brief Get the render() timing (pass times, frame budget overruns, a histogram, and time per render queue item type).
+ * Needs PV_RENDER_PROFILING, everything is 0 otherwise. Safe to call from core 0 at any time, it doesn't stop the renderer.
+ * Tile mode and the scanline renderer don't use render(), so only pixels_written counts anything there.
+ *
+ * @param profile Filled with a consistent snapshot of the timing
+ */
+void vga_get_render_profile(vga_render_profile_t * profile);
+
+/**
+ * @brief Reset the render() timing to 0. Takes effect at the start of the next render() pass.
+ *
+ */
+void vga_reset_render_profile();
+
+/**
+ * @brief Have render() write the time each render queue item took into an array (needs PV_RENDER_PROFILING).
+ * item_us[i] is how long render_queue[i] took the last time it was drawn, in us.
+ *
+ * @param item_us render_queue_len entries, or NULL to stop
+ */
+void vga_set_render_profile_items(uint32_t * item_us);
+
+/**
+ * @brief Read out the frame the same way the scanout DMA does: every visible line of the base resolution, in order,
+ * from the line pointers the DMA reads (so repeated rows, scrolling and double buffering all come out like they do on
+ * the monitor). Each line is vga_get_width() 8 bit pixels. Good for dumping screenshots (see color_vga_to_rgb()).
+ *
+ * Lines built on the fly (line interpolation, tile mode, the scanline renderer, 4/2 bits per pixel) only exist in the
+ * line buffer ring for a moment, so those lines are whatever happens to be in their buffer.
+ *
+ * @param line_callback Called once per line with the base resolution line number and its pixels
+ * @param ctx Passed to line_callback
+ * @return uint16_t Number of lines that came from the line buffer ring (0 means the capture is exact)
+ */
+uint16_t vga_capture_frame(void (*line_callback)(uint16_t line, const uint8_t * pixels, void * ctx), void * ctx);
+
+/**
+ * @brief Hide every item and clear the screen
+ *
+ */
+void draw_clear();
+
+/**
+ * @brief Show or hide an item
+ *
+ * @param item Render queue item
+ * @param shown True to show it, false to hide it
+ */
+void draw_set_shown(vga_render_item_t * item, bool shown);
+
+/**
+ * @brief Tell AutoRender an item changed so it gets redrawn. All of the draw*_ functions do this, it's only needed
+ * after changing an item by hand. Setting flags.update by hand only works from the item's own animate() function
+ * (the renderer checks it after every call). Anywhere else it does nothing, the renderer sleeps until something
+ * calls this. Safe to call from either core and from IRQs.
+ *
+ * @param item Render queue item, has to be in the render queue
+ */
+void draw_mark_updated(vga_render_item_t * item);
+
 /**
  * @brief Set an item's scale
  *
@@ -449,4 +922,14 @@ const uint8_t * draw2d_get_font();
  * the screen (keep the background color).
  */
 void draw2d_sprite(vga_render_item_t * item, uint16_t x, uint16_t y, vga_color_t * sprite, uint16_t size_x, uint16_t size_y, vga_color_t null_color);
+
+/**
+ * @brief Work out the area of the screen an item covers (item->bbox) from its type and coordinates, and whether it
+ * covers all of it (flags.opaque: fills, filled rectangles, and sprites without any null_color pixels).
+ * All of the draw2d_* functions do this, and the renderer redoes it for every item marked as updated,
+ * so it's only needed to read bbox back after changing an item by hand.
+ *
+ * @param item Render queue item
+ */
+void draw2d_update_bbox(vga_render_item_t * item);
 #endif
\ No newline at end of file